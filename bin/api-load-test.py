@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+"""Load test for the multi-client TCP API server (meshtasticd / native builds).
+
+Opens many simultaneous API connections, has every client download the config and then counts the mesh packets each one
+receives.  Every client that keeps reading should see the same packets.  Only needs the python standard library.
+
+    bin/api-load-test.py --clients 32 --seconds 30 [--host localhost] [--port 4403] [--stalled 2]
+"""
+
+import argparse
+import selectors
+import socket
+import struct
+import sys
+import time
+
+START1 = 0x94
+START2 = 0xC3
+HEADER_LEN = 4
+
+FROMRADIO_PACKET_TAG = 0x12  # field 2, length delimited
+FROMRADIO_CONFIG_COMPLETE_TAG = 0x38  # field 7, varint
+TORADIO_WANT_CONFIG_TAG = 0x18  # field 3, varint
+
+
+def varint(n):
+    out = bytearray()
+    while True:
+        b = n & 0x7F
+        n >>= 7
+        if n:
+            out.append(b | 0x80)
+        else:
+            out.append(b)
+            return bytes(out)
+
+
+def frame(payload):
+    return bytes([START1, START2]) + struct.pack(">H", len(payload)) + payload
+
+
+class Client:
+    def __init__(self, num, host, port, stalled):
+        self.num = num
+        self.stalled = stalled
+        self.sock = socket.create_connection((host, port))
+        self.sock.setblocking(False)
+        self.buf = bytearray()
+        self.frames = 0
+        self.packets = 0
+        self.start = time.monotonic()
+        self.configured_at = None
+        self.closed = False
+        nonce = 1000 + num
+        self.sock.sendall(frame(bytes([TORADIO_WANT_CONFIG_TAG]) + varint(nonce)))
+
+    def on_readable(self):
+        try:
+            data = self.sock.recv(65536)
+        except BlockingIOError:
+            return
+        if not data:
+            self.closed = True
+            return
+        self.buf += data
+        while True:
+            # resync on framing like the firmware does
+            while len(self.buf) >= 2 and (self.buf[0] != START1 or self.buf[1] != START2):
+                del self.buf[0]
+            if len(self.buf) < HEADER_LEN:
+                return
+            length = (self.buf[2] << 8) | self.buf[3]
+            if len(self.buf) < HEADER_LEN + length:
+                return
+            payload = bytes(self.buf[HEADER_LEN : HEADER_LEN + length])
+            del self.buf[: HEADER_LEN + length]
+            self.frames += 1
+            if payload[:1] == bytes([FROMRADIO_CONFIG_COMPLETE_TAG]) and self.configured_at is None:
+                self.configured_at = time.monotonic()
+            elif payload[:1] == bytes([FROMRADIO_PACKET_TAG]):
+                self.packets += 1
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", default="localhost")
+    parser.add_argument("--port", type=int, default=4403)
+    parser.add_argument("--clients", type=int, default=32)
+    parser.add_argument("--seconds", type=float, default=30)
+    parser.add_argument("--stalled", type=int, default=0, help="number of clients that connect but never read after config")
+    args = parser.parse_args()
+
+    sel = selectors.DefaultSelector()
+    clients = []
+    for i in range(args.clients):
+        c = Client(i, args.host, args.port, i < args.stalled)
+        sel.register(c.sock, selectors.EVENT_READ, c)
+        clients.append(c)
+    print(f"connected {len(clients)} clients to {args.host}:{args.port}")
+
+    deadline = time.monotonic() + args.seconds
+    while time.monotonic() < deadline:
+        for key, _ in sel.select(timeout=0.1):
+            c = key.data
+            c.on_readable()
+            if c.closed or (c.stalled and c.configured_at is not None):
+                sel.unregister(c.sock)
+
+    failed = False
+    readers = [c for c in clients if not c.stalled]
+    for c in clients:
+        config_ms = (c.configured_at - c.start) * 1000 if c.configured_at else float("nan")
+        state = "closed" if c.closed else ("stalled" if c.stalled else "ok")
+        print(f"client {c.num:3d}: {state:7s} config {config_ms:8.1f} ms, {c.frames:6d} frames, {c.packets:6d} packets")
+        if c.configured_at is None or c.closed:
+            failed = True
+
+    counts = {c.packets for c in readers}
+    if len(counts) > 1:
+        print(f"reading clients saw different packet counts: {sorted(counts)}")
+        failed = True
+
+    for c in clients:
+        c.sock.close()
+
+    print("FAILED" if failed else "OK")
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -46,13 +46,33 @@
 #define LOG_TRACE(...) SEGGER_RTT_printf(0, __VA_ARGS__)
 #else
 #if defined(DEBUG_PORT) && !defined(DEBUG_MUTE) && !defined(PIO_UNIT_TESTING)
+#if MESHTASTIC_MIN_LOG_LEVEL <= MESHTASTIC_LOG_LEVEL_NUM_DEBUG
 #define LOG_DEBUG(...) DEBUG_PORT.log(MESHTASTIC_LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...)
+#endif
+#if MESHTASTIC_MIN_LOG_LEVEL <= MESHTASTIC_LOG_LEVEL_NUM_INFO
 #define LOG_INFO(...) DEBUG_PORT.log(MESHTASTIC_LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...)
+#endif
+#if MESHTASTIC_MIN_LOG_LEVEL <= MESHTASTIC_LOG_LEVEL_NUM_WARN
 #define LOG_WARN(...) DEBUG_PORT.log(MESHTASTIC_LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...)
+#endif
+#if MESHTASTIC_MIN_LOG_LEVEL <= MESHTASTIC_LOG_LEVEL_NUM_ERROR
 #define LOG_ERROR(...) DEBUG_PORT.log(MESHTASTIC_LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...)
+#endif
 #define LOG_CRIT(...) DEBUG_PORT.log(MESHTASTIC_LOG_LEVEL_CRIT, __VA_ARGS__)
+#if MESHTASTIC_MIN_LOG_LEVEL <= MESHTASTIC_LOG_LEVEL_NUM_TRACE
 #define LOG_TRACE(...) DEBUG_PORT.log(MESHTASTIC_LOG_LEVEL_TRACE, __VA_ARGS__)
 #else
+#define LOG_TRACE(...)
+#endif
+#else
 #define LOG_DEBUG(...)
 #define LOG_INFO(...)
 #define LOG_WARN(...)
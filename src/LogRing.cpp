@@ -0,0 +1,102 @@
+#include "LogRing.h"
+
+#include <assert.h>
+#include <string.h>
+
+/// Record states, the first byte of every record
+enum { RECORD_EMPTY = 0, RECORD_COMMITTED, RECORD_PADDING };
+
+/// Precedes the text of every record in the ring
+struct LogRingHeader {
+    uint8_t state; // only accessed atomically
+    uint8_t level;
+    uint16_t size; // whole record including this header, a multiple of RECORD_ALIGN
+    uint32_t msec;
+    uint16_t len; // of the text
+    char threadName[16];
+};
+
+static const size_t RECORD_ALIGN = 8;
+
+static size_t alignUp(size_t n)
+{
+    return (n + RECORD_ALIGN - 1) & ~(RECORD_ALIGN - 1);
+}
+
+LogRing::LogRing(size_t size) : mask(size - 1), head(0), tail(0)
+{
+    assert(size >= MAX_RECORD && (size & (size - 1)) == 0);
+    buf = new uint8_t[size];
+    memset(buf, 0, size);
+}
+
+LogRing::~LogRing()
+{
+    delete[] buf;
+}
+
+bool LogRing::push(uint8_t level, uint32_t msec, const char *threadName, const char *text, size_t len)
+{
+    if (len > MAX_RECORD - sizeof(LogRingHeader))
+        len = MAX_RECORD - sizeof(LogRingHeader);
+
+    uint32_t size = mask + 1;
+    uint32_t need = alignUp(sizeof(LogRingHeader) + len);
+    uint32_t h = head.load(std::memory_order_relaxed), pad, t;
+    do {
+        // Records never wrap, if this one won't fit before the end we skip over the leftover space
+        uint32_t offset = h & mask;
+        pad = (size - offset < need) ? size - offset : 0;
+        t = tail.load(std::memory_order_acquire);
+        if (h + pad + need - t > size)
+            return false;
+    } while (!head.compare_exchange_weak(h, h + pad + need, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+    if (pad) {
+        LogRingHeader *padding = (LogRingHeader *)(buf + (h & mask));
+        padding->size = pad;
+        __atomic_store_n(&padding->state, RECORD_PADDING, __ATOMIC_RELEASE);
+    }
+
+    LogRingHeader *r = (LogRingHeader *)(buf + ((h + pad) & mask));
+    r->level = level;
+    r->size = need;
+    r->msec = msec;
+    r->len = len;
+    strncpy(r->threadName, threadName ? threadName : "", sizeof(r->threadName) - 1);
+    r->threadName[sizeof(r->threadName) - 1] = 0;
+    memcpy(r + 1, text, len);
+    __atomic_store_n(&r->state, RECORD_COMMITTED, __ATOMIC_RELEASE);
+    return true;
+}
+
+bool LogRing::pop(LogRingEntry &entry, char *text, size_t textLen)
+{
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    for (;;) {
+        if (t == head.load(std::memory_order_acquire))
+            return false;
+
+        LogRingHeader *r = (LogRingHeader *)(buf + (t & mask));
+        uint8_t state = __atomic_load_n(&r->state, __ATOMIC_ACQUIRE);
+        if (state == RECORD_EMPTY)
+            return false; // reserved, but the producer hasn't finished writing it yet
+
+        uint32_t size = r->size;
+        if (state == RECORD_COMMITTED) {
+            entry.level = r->level;
+            entry.msec = r->msec;
+            memcpy(entry.threadName, r->threadName, sizeof(entry.threadName));
+            size_t len = (r->len < textLen) ? r->len : textLen - 1;
+            memcpy(text, r + 1, len);
+            text[len] = 0;
+        }
+
+        // Later records can start anywhere in here, so they must not find a stale state byte
+        memset(r, 0, size);
+        t += size;
+        tail.store(t, std::memory_order_release);
+        if (state == RECORD_COMMITTED)
+            return true;
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+/// Bytes of log messages we can hold while waiting for the console thread to print them, 0 logs synchronously as before
+#ifndef LOG_RING_SIZE
+#if defined(ARCH_STM32WL)
+#define LOG_RING_SIZE 0
+#elif defined(ARCH_PORTDUINO)
+#define LOG_RING_SIZE 32768
+#else
+#define LOG_RING_SIZE 4096
+#endif
+#endif
+
+/// Who logged a record and when, filled in by LogRing::pop()
+struct LogRingEntry {
+    uint8_t level; // a meshtastic_LogRecord_Level
+    uint32_t msec; // millis() when the record was logged
+    char threadName[16];
+};
+
+/**
+ * A lock free buffer of log messages, already formatted by whoever logged them.
+ *
+ * Any thread can push() a message: producers only reserve space with a compare and swap and copy the text in, so logging from
+ * the radio or router paths never waits for a serial port.  A single consumer pops the messages and does the port I/O later.
+ */
+class LogRing
+{
+  public:
+    /// Largest record we will store, longer messages are truncated to fit
+    static const size_t MAX_RECORD = 512;
+
+    /// 'size' must be a power of two
+    explicit LogRing(size_t size);
+    ~LogRing();
+
+    /// Store a formatted message (which needn't be NUL terminated).  Returns false if the ring is too full to take it.
+    bool push(uint8_t level, uint32_t msec, const char *threadName, const char *text, size_t len);
+
+    /// Copy out the oldest complete message (always NUL terminated), returns false if there is nothing to pop
+    bool pop(LogRingEntry &entry, char *text, size_t textLen);
+
+    /// True if no records (not even ones still being written) are waiting for pop()
+    bool isEmpty() const { return tail.load(std::memory_order_relaxed) == head.load(std::memory_order_acquire); }
+
+  private:
+    uint8_t *buf;
+    uint32_t mask;
+
+    /// Bytes reserved by producers so far, and bytes released by the consumer (both only ever increase, modulo 2^32)
+    std::atomic<uint32_t> head;
+    std::atomic<uint32_t> tail;
+};
@@ -654,6 +654,10 @@ void Power::readPowerStatus()
         LOG_DEBUG("\n");
         LOG_DEBUG("Heap status: %d/%d bytes free (%d), running %d/%d threads\n", memGet.getFreeHeap(), memGet.getHeapSize(),
                   memGet.getFreeHeap() - lastheap, running, concurrency::mainController.size(false));
+        AllocatorStats poolStats;
+        packetPool.getStats(poolStats);
+        LOG_DEBUG("Packet pool: %u/%u in use, high water %u, exhausted %u times\n", poolStats.inUse, poolStats.capacity,
+                  poolStats.highWater, poolStats.exhausted);
         lastheap = memGet.getFreeHeap();
     }
 #ifdef DEBUG_HEAP_MQTT
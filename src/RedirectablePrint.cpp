@@ -19,11 +19,39 @@
 #if HAS_NETWORKING
 extern Syslog syslog;
 #endif
+
+// Longest log message we print, anything more is cut off
+#if ENABLE_JSON_LOGGING || ARCH_PORTDUINO
+#define LOG_TEXT_LEN 512
+#else
+#define LOG_TEXT_LEN 160
+#endif
+
 void RedirectablePrint::rpInit()
 {
 #ifdef HAS_FREE_RTOS
     inDebugPrint = xSemaphoreCreateMutexStatic(&this->_MutexStorageSpace);
 #endif
+#ifdef ARCH_PORTDUINO
+    // Look the configured level up once, rather than in settingsMap on every log call
+    switch (settingsMap[logoutputlevel]) {
+    case level_error:
+        minLogLevel = meshtastic_LogRecord_Level_ERROR;
+        break;
+    case level_warn:
+        minLogLevel = meshtastic_LogRecord_Level_WARNING;
+        break;
+    case level_info:
+        minLogLevel = meshtastic_LogRecord_Level_INFO;
+        break;
+    case level_debug:
+        minLogLevel = meshtastic_LogRecord_Level_DEBUG;
+        break;
+    default:
+        minLogLevel = meshtastic_LogRecord_Level_TRACE;
+        break;
+    }
+#endif
 }
 
 void RedirectablePrint::setDestination(Print *_dest)
@@ -50,11 +78,7 @@ size_t RedirectablePrint::write(uint8_t c)
 size_t RedirectablePrint::vprintf(const char *logLevel, const char *format, va_list arg)
 {
     va_list copy;
-#if ENABLE_JSON_LOGGING || ARCH_PORTDUINO
-    static char printBuf[512];
-#else
-    static char printBuf[160];
-#endif
+    static char printBuf[LOG_TEXT_LEN];
 
 #ifdef ARCH_PORTDUINO
     bool color = !settingsMap[ascii_logs];
@@ -78,14 +102,22 @@ size_t RedirectablePrint::vprintf(const char *logLevel, const char *format, va_l
             printBuf[f] = '#';
     }
     if (color && logLevel != nullptr) {
-        if (strcmp(logLevel, MESHTASTIC_LOG_LEVEL_DEBUG) == 0)
+        switch (getLogLevel(logLevel)) {
+        case meshtastic_LogRecord_Level_DEBUG:
             Print::write("\u001b[34m", 6);
-        if (strcmp(logLevel, MESHTASTIC_LOG_LEVEL_INFO) == 0)
+            break;
+        case meshtastic_LogRecord_Level_INFO:
             Print::write("\u001b[32m", 6);
-        if (strcmp(logLevel, MESHTASTIC_LOG_LEVEL_WARN) == 0)
+            break;
+        case meshtastic_LogRecord_Level_WARNING:
             Print::write("\u001b[33m", 6);
-        if (strcmp(logLevel, MESHTASTIC_LOG_LEVEL_ERROR) == 0)
+            break;
+        case meshtastic_LogRecord_Level_ERROR:
             Print::write("\u001b[31m", 6);
+            break;
+        default:
+            break;
+        }
     }
     len = Print::write(printBuf, len);
     if (color && logLevel != nullptr) {
@@ -109,20 +141,31 @@ void RedirectablePrint::log_to_serial(const char *logLevel, const char *format,
     // If we are the first message on a report, include the header
     if (!isContinuationMessage) {
         if (color) {
-            if (strcmp(logLevel, MESHTASTIC_LOG_LEVEL_DEBUG) == 0)
+            switch (getLogLevel(logLevel)) {
+            case meshtastic_LogRecord_Level_DEBUG:
                 Print::write("\u001b[34m", 6);
-            if (strcmp(logLevel, MESHTASTIC_LOG_LEVEL_INFO) == 0)
+                break;
+            case meshtastic_LogRecord_Level_INFO:
                 Print::write("\u001b[32m", 6);
-            if (strcmp(logLevel, MESHTASTIC_LOG_LEVEL_WARN) == 0)
+                break;
+            case meshtastic_LogRecord_Level_WARNING:
                 Print::write("\u001b[33m", 6);
-            if (strcmp(logLevel, MESHTASTIC_LOG_LEVEL_ERROR) == 0)
+                break;
+            case meshtastic_LogRecord_Level_ERROR:
                 Print::write("\u001b[31m", 6);
-            if (strcmp(logLevel, MESHTASTIC_LOG_LEVEL_TRACE) == 0)
+                break;
+            case meshtastic_LogRecord_Level_TRACE:
                 Print::write("\u001b[35m", 6);
+                break;
+            default:
+                break;
+            }
         }
 
+        uint32_t logMsec = getLogMsec();
         uint32_t rtc_sec = getValidTime(RTCQuality::RTCQualityDevice, true); // display local time on logfile
         if (rtc_sec > 0) {
+            rtc_sec -= (millis() - logMsec) / 1000; // when it was logged, not when we got around to printing it
             long hms = rtc_sec % SEC_PER_DAY;
             // hms += tz.tz_dsttime * SEC_PER_HOUR;
             // hms -= tz.tz_minuteswest * SEC_PER_MIN;
@@ -138,13 +181,13 @@ void RedirectablePrint::log_to_serial(const char *logLevel, const char *format,
             if (color) {
                 ::printf("\u001b[0m");
             }
-            ::printf("| %02d:%02d:%02d %u ", hour, min, sec, millis() / 1000);
+            ::printf("| %02d:%02d:%02d %u ", hour, min, sec, logMsec / 1000);
 #else
             printf("%s ", logLevel);
             if (color) {
                 printf("\u001b[0m");
             }
-            printf("| %02d:%02d:%02d %u ", hour, min, sec, millis() / 1000);
+            printf("| %02d:%02d:%02d %u ", hour, min, sec, logMsec / 1000);
 #endif
         } else {
 #ifdef ARCH_PORTDUINO
@@ -152,21 +195,19 @@ void RedirectablePrint::log_to_serial(const char *logLevel, const char *format,
             if (color) {
                 ::printf("\u001b[0m");
             }
-            ::printf("| ??:??:?? %u ", millis() / 1000);
+            ::printf("| ??:??:?? %u ", logMsec / 1000);
 #else
             printf("%s ", logLevel);
             if (color) {
                 printf("\u001b[0m");
             }
-            printf("| ??:??:?? %u ", millis() / 1000);
+            printf("| ??:??:?? %u ", logMsec / 1000);
 #endif
         }
-        auto thread = concurrency::OSThread::currentThread;
-        if (thread) {
+        const char *threadName = getLogThreadName();
+        if (threadName) {
             print("[");
-            // printf("%p ", thread);
-            // assert(thread->ThreadName.length());
-            print(thread->ThreadName);
+            print(threadName);
             print("] ");
         }
     }
@@ -200,9 +241,9 @@ void RedirectablePrint::log_to_syslog(const char *logLevel, const char *format,
         default:
             ll = 0;
         }
-        auto thread = concurrency::OSThread::currentThread;
-        if (thread) {
-            syslog.vlogf(ll, thread->ThreadName.c_str(), format, arg);
+        const char *threadName = getLogThreadName();
+        if (threadName) {
+            syslog.vlogf(ll, threadName, format, arg);
         } else {
             syslog.vlogf(ll, format, arg);
         }
@@ -232,12 +273,12 @@ void RedirectablePrint::log_to_ble(const char *logLevel, const char *format, va_
                 message = new char[len + 1];
                 vsnprintf(message, len + 1, format, arg);
             }
-            auto thread = concurrency::OSThread::currentThread;
+            const char *threadName = getLogThreadName();
             meshtastic_LogRecord logRecord = meshtastic_LogRecord_init_zero;
             logRecord.level = getLogLevel(logLevel);
             strcpy(logRecord.message, message);
-            if (thread)
-                strcpy(logRecord.source, thread->ThreadName.c_str());
+            if (threadName)
+                strcpy(logRecord.source, threadName);
             logRecord.time = getValidTime(RTCQuality::RTCQualityDevice, true);
 
             uint8_t *buffer = new uint8_t[meshtastic_LogRecord_size];
@@ -277,15 +318,113 @@ meshtastic_LogRecord_Level RedirectablePrint::getLogLevel(const char *logLevel)
     case 'C':
         ll = meshtastic_LogRecord_Level_CRITICAL;
         break;
+    case 'T':
+        ll = meshtastic_LogRecord_Level_TRACE;
+        break;
     }
     return ll;
 }
 
+/// The MESHTASTIC_LOG_LEVEL_xxx string for a level captured in the log ring
+static const char *getLogLevelName(uint8_t level)
+{
+    switch (level) {
+    case meshtastic_LogRecord_Level_DEBUG:
+        return MESHTASTIC_LOG_LEVEL_DEBUG;
+    case meshtastic_LogRecord_Level_INFO:
+        return MESHTASTIC_LOG_LEVEL_INFO;
+    case meshtastic_LogRecord_Level_WARNING:
+        return MESHTASTIC_LOG_LEVEL_WARN;
+    case meshtastic_LogRecord_Level_ERROR:
+        return MESHTASTIC_LOG_LEVEL_ERROR;
+    case meshtastic_LogRecord_Level_CRITICAL:
+        return MESHTASTIC_LOG_LEVEL_CRIT;
+    case meshtastic_LogRecord_Level_TRACE:
+        return MESHTASTIC_LOG_LEVEL_TRACE;
+    default:
+        return "";
+    }
+}
+
+const char *RedirectablePrint::getLogThreadName()
+{
+    if (drainingLog)
+        return drainEntry.threadName[0] ? drainEntry.threadName : nullptr;
+    auto thread = concurrency::OSThread::currentThread;
+    return thread ? thread->ThreadName.c_str() : nullptr;
+}
+
+uint32_t RedirectablePrint::getLogMsec()
+{
+    return drainingLog ? drainEntry.msec : millis();
+}
+
+void RedirectablePrint::logToSinks(const char *logLevel, const char *format, ...)
+{
+    va_list arg;
+    va_start(arg, format);
+    log_to_serial(logLevel, format, arg);
+    va_end(arg);
+    va_start(arg, format);
+    log_to_syslog(logLevel, format, arg);
+    va_end(arg);
+    va_start(arg, format);
+    log_to_ble(logLevel, format, arg);
+    va_end(arg);
+}
+
+void RedirectablePrint::enableLogRing()
+{
+#if LOG_RING_SIZE
+    if (!logRing)
+        logRing = new LogRing(LOG_RING_SIZE);
+#endif
+}
+
+void RedirectablePrint::drainLog()
+{
+    if (!logRing || logRing->isEmpty())
+        return;
+
+#ifdef HAS_FREE_RTOS
+    if (inDebugPrint != nullptr && xSemaphoreTake(inDebugPrint, portMAX_DELAY) == pdTRUE) {
+#else
+    if (!inDebugPrint) {
+        inDebugPrint = true;
+#endif
+        drainLogLocked();
+#ifdef HAS_FREE_RTOS
+        xSemaphoreGive(inDebugPrint);
+#else
+        inDebugPrint = false;
+#endif
+    }
+}
+
+void RedirectablePrint::drainLogLocked()
+{
+    if (!logRing)
+        return;
+
+    static char text[LOG_TEXT_LEN];
+    while (logRing->pop(drainEntry, text, sizeof(text))) {
+        // The sinks look at the format to see if this is the end of a line, so give them one that says so
+        size_t len = strlen(text);
+        bool hasNewline = len && text[len - 1] == '\n';
+        if (hasNewline)
+            text[len - 1] = 0;
+        drainingLog = true;
+        logToSinks(getLogLevelName(drainEntry.level), hasNewline ? "%s\n" : "%s", text);
+        drainingLog = false;
+    }
+}
+
 void RedirectablePrint::log(const char *logLevel, const char *format, ...)
 {
+    meshtastic_LogRecord_Level level = getLogLevel(logLevel);
 #if ARCH_PORTDUINO
     // level trace is special, two possible ways to handle it.
-    if (strcmp(logLevel, MESHTASTIC_LOG_LEVEL_TRACE) == 0) {
+    if (level == meshtastic_LogRecord_Level_TRACE) {
         if (settingsStrings[traceFilename] != "") {
             va_list arg;
             va_start(arg, format);
@@ -295,18 +434,31 @@ void RedirectablePrint::log(const char *logLevel, const char *format, ...)
             }
             va_end(arg);
         }
-        if (settingsMap[logoutputlevel] < level_trace && strcmp(logLevel, MESHTASTIC_LOG_LEVEL_TRACE) == 0)
-            return;
     }
-    if (settingsMap[logoutputlevel] < level_debug && strcmp(logLevel, MESHTASTIC_LOG_LEVEL_DEBUG) == 0)
-        return;
-    else if (settingsMap[logoutputlevel] < level_info && strcmp(logLevel, MESHTASTIC_LOG_LEVEL_INFO) == 0)
-        return;
-    else if (settingsMap[logoutputlevel] < level_warn && strcmp(logLevel, MESHTASTIC_LOG_LEVEL_WARN) == 0)
-        return;
 #endif
-    if (moduleConfig.serial.override_console_serial_port && strcmp(logLevel, MESHTASTIC_LOG_LEVEL_DEBUG) == 0) {
+    if (!isLevelEnabled(level))
         return;
+
+    // Debug and info messages are formatted into the ring for drainLog().  Warnings and worse go out right now (after whatever is
+    // in the ring), so the lines leading up to a crash aren't stuck in a buffer
+    if (logRing && level < meshtastic_LogRecord_Level_WARNING) {
+        char text[LOG_TEXT_LEN];
+        va_list arg;
+        va_start(arg, format);
+        int n = vsnprintf(text, sizeof(text), format, arg);
+        va_end(arg);
+
+        size_t len = (n < 0) ? 0 : n;
+        if (len > sizeof(text) - 1) {
+            len = sizeof(text) - 1;
+            if (*format && format[strlen(format) - 1] == '\n')
+                text[len - 1] = '\n'; // a truncated line must still end the line
+        }
+
+        auto thread = concurrency::OSThread::currentThread;
+        if (logRing->push(level, millis(), thread ? thread->ThreadName.c_str() : nullptr, text, len))
+            return;
+        // The ring is full, print this one (and everything before it) ourselves
     }
 
 #ifdef HAS_FREE_RTOS
@@ -316,6 +468,8 @@ void RedirectablePrint::log(const char *logLevel, const char *format, ...)
         inDebugPrint = true;
 #endif
 
+        drainLogLocked(); // anything captured earlier goes first
+
         va_list arg;
         va_start(arg, format);
 
@@ -336,6 +490,9 @@ void RedirectablePrint::log(const char *logLevel, const char *format, ...)
 
 void RedirectablePrint::hexDump(const char *logLevel, unsigned char *buf, uint16_t len)
 {
+    if (!isLevelEnabled(getLogLevel(logLevel)))
+        return;
+
     const char alphabet[17] = "0123456789abcdef";
     log(logLevel, "    +------------------------------------------------+ +----------------+\n");
     log(logLevel, "    |.0 .1 .2 .3 .4 .5 .6 .7 .8 .9 .a .b .c .d .e .f | |      ASCII     |\n");
@@ -361,7 +518,7 @@ void RedirectablePrint::hexDump(const char *logLevel, unsigned char *buf, uint16
             log(logLevel, " ");
         log(logLevel, "%02x", index);
         log(logLevel, ".");
-        log(logLevel, s);
+        log(logLevel, "%s", s);
     }
     log(logLevel, "    +------------------------------------------------+ +----------------+\n");
 }
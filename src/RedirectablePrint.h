@@ -1,11 +1,28 @@
 #pragma once
 
 #include "../freertosinc.h"
+#include "LogRing.h"
+#include "mesh/generated/meshtastic/localonly.pb.h"
 #include "mesh/generated/meshtastic/mesh.pb.h"
 #include <Print.h>
 #include <stdarg.h>
 #include <string>
 
+// The log levels as numbers (matching meshtastic_LogRecord_Level), so the preprocessor can compare them
+#define MESHTASTIC_LOG_LEVEL_NUM_TRACE 5
+#define MESHTASTIC_LOG_LEVEL_NUM_DEBUG 10
+#define MESHTASTIC_LOG_LEVEL_NUM_INFO 20
+#define MESHTASTIC_LOG_LEVEL_NUM_WARN 30
+#define MESHTASTIC_LOG_LEVEL_NUM_ERROR 40
+#define MESHTASTIC_LOG_LEVEL_NUM_CRIT 50
+
+// Log calls below this level are compiled out entirely (arguments and all), e.g. -DMESHTASTIC_MIN_LOG_LEVEL=20 for INFO and up
+#ifndef MESHTASTIC_MIN_LOG_LEVEL
+#define MESHTASTIC_MIN_LOG_LEVEL MESHTASTIC_LOG_LEVEL_NUM_TRACE
+#endif
+
+extern meshtastic_LocalModuleConfig moduleConfig;
+
 /**
  * A Printable that can be switched to squirt its bytes to a different sink.
  * This class is mostly useful to allow debug printing to be redirected away from Serial
@@ -24,6 +41,17 @@ class RedirectablePrint : public Print
 #else
     volatile bool inDebugPrint = false;
 #endif
+
+    /// Once enabled, debug and info messages are formatted into here and printed later by drainLog()
+    LogRing *logRing = nullptr;
+
+    /// Messages below this level (a meshtastic_LogRecord_Level) are thrown away at runtime
+    uint8_t minLogLevel = meshtastic_LogRecord_Level_TRACE;
+
+    /// The record drainLog() is currently printing, so the sinks show when and where it was logged rather than now
+    bool drainingLog = false;
+    LogRingEntry drainEntry;
+
   public:
     explicit RedirectablePrint(Print *_dest) : dest(_dest) {}
 
@@ -49,14 +77,48 @@ class RedirectablePrint : public Print
 
     void hexDump(const char *logLevel, unsigned char *buf, uint16_t len);
 
+    /**
+     * Would a message at this level be printed?  Cheap enough to check before building an expensive log message, and
+     * constant false for levels compiled out by MESHTASTIC_MIN_LOG_LEVEL.
+     */
+    bool isLevelEnabled(meshtastic_LogRecord_Level level) const
+    {
+        if (level < MESHTASTIC_MIN_LOG_LEVEL || level < minLogLevel)
+            return false;
+        // The console port belongs to the serial module, keep the chatty stuff off it
+        return level != meshtastic_LogRecord_Level_DEBUG || !moduleConfig.serial.override_console_serial_port;
+    }
+
+    /**
+     * From now on put formatted debug and info messages in a ring buffer instead of printing them on the calling thread
+     * (warnings and worse are still printed right away).  Whoever owns us must then call drainLog() regularly.
+     */
+    void enableLogRing();
+
+    /// Print any log messages waiting in the ring
+    void drainLog();
+
     std::string mt_sprintf(const std::string fmt_str, ...);
 
   protected:
     /// Subclasses can override if they need to change how we format over the serial port
     virtual void log_to_serial(const char *logLevel, const char *format, va_list arg);
 
+    /// Name of the thread that logged the message we are printing, or NULL
+    const char *getLogThreadName();
+
+    /// millis() when the message we are printing was logged
+    uint32_t getLogMsec();
+
+    meshtastic_LogRecord_Level getLogLevel(const char *logLevel);
+
   private:
     void log_to_syslog(const char *logLevel, const char *format, va_list arg);
     void log_to_ble(const char *logLevel, const char *format, va_list arg);
-    meshtastic_LogRecord_Level getLogLevel(const char *logLevel);
+
+    /// Send one message to every sink, the caller must hold inDebugPrint
+    void logToSinks(const char *logLevel, const char *format, ...) __attribute__((format(printf, 3, 4)));
+
+    /// drainLog() for callers that already hold inDebugPrint
+    void drainLogLocked();
 };
\ No newline at end of file
@@ -2,6 +2,12 @@
 
 #ifdef FSCom
 
+#include <ErriezCRC32.h>
+#include <new>
+#include <string.h>
+
+SafeFileStats SafeFile::stats;
+
 // Only way to work on both esp32 and nrf52
 static File openFile(const char *filename, bool fullAtomic)
 {
@@ -18,29 +24,62 @@ static File openFile(const char *filename, bool fullAtomic)
 }
 
 SafeFile::SafeFile(const char *_filename, bool fullAtomic)
-    : filename(_filename), f(openFile(_filename, fullAtomic)), fullAtomic(fullAtomic)
+    : filename(_filename), f(openFile(_filename, fullAtomic)), fullAtomic(fullAtomic), crc(CRC32_INITIAL),
+      buffer(new (std::nothrow) uint8_t[SAFEFILE_BUFFER_SIZE])
 {
 }
 
 size_t SafeFile::write(uint8_t ch)
 {
-    if (!f)
-        return 0;
-
-    hash ^= ch;
-    return f.write(ch);
+    return write(&ch, 1);
 }
 
-size_t SafeFile::write(const uint8_t *buffer, size_t size)
+size_t SafeFile::write(const uint8_t *data, size_t size)
 {
-    if (!f)
+    if (!f || writeFailed)
         return 0;
 
-    for (size_t i = 0; i < size; i++) {
-        hash ^= buffer[i];
+    crc = crc32Update(data, size, crc);
+    stats.bytes += size;
+
+    size_t done = 0;
+    while (done < size) {
+        // Nothing buffered and at least a chunk to write, it can go straight through
+        if (!buffer || (buffered == 0 && size - done >= SAFEFILE_BUFFER_SIZE)) {
+            size_t n = buffer ? size - done - (size - done) % SAFEFILE_BUFFER_SIZE : size - done;
+            stats.fsWrites++;
+            // This nasty cast is _IMPORTANT_ otherwise the correct adafruit method does not get used (they made a mistake in
+            // their typing)
+            size_t written = f.write((uint8_t const *)data + done, n);
+            if (written != n) {
+                writeFailed = true;
+                return done + written;
+            }
+            done += n;
+            continue;
+        }
+
+        size_t n = min(size - done, (size_t)SAFEFILE_BUFFER_SIZE - buffered);
+        memcpy(buffer.get() + buffered, data + done, n);
+        buffered += n;
+        done += n;
+        if (buffered == SAFEFILE_BUFFER_SIZE && !flush())
+            return done;
     }
-    return f.write((uint8_t const *)buffer, size); // This nasty cast is _IMPORTANT_ otherwise the correct adafruit method does
-                                                   // not get used (they made a mistake in their typing)
+    return size;
+}
+
+bool SafeFile::flush()
+{
+    if (buffered == 0)
+        return !writeFailed;
+
+    stats.fsWrites++;
+    size_t written = f.write((uint8_t const *)buffer.get(), buffered);
+    if (written != buffered)
+        writeFailed = true;
+    buffered = 0;
+    return !writeFailed;
 }
 
 /**
@@ -53,8 +92,16 @@ bool SafeFile::close()
     if (!f)
         return false;
 
+    bool flushed = flush();
     f.close();
-    if (!testReadback())
+    stats.files++;
+    if (!flushed) {
+        LOG_ERROR("Can't write %s\n", filename.c_str());
+        return false;
+    }
+    bool readbackOkay = testReadback();
+    buffer.reset();
+    if (!readbackOkay)
         return false;
 
     // brief window of risk here ;-)
@@ -87,14 +134,20 @@ bool SafeFile::testReadback()
         return false;
     }
 
-    int c = 0;
-    uint8_t test_hash = 0;
-    while ((c = f2.read()) >= 0) {
-        test_hash ^= (uint8_t)c;
+    // Read back in big blocks, using the write buffer now that it's empty
+    uint32_t start = micros();
+    uint8_t block[64];
+    uint8_t *readBuf = buffer ? buffer.get() : block;
+    size_t readSize = buffer ? SAFEFILE_BUFFER_SIZE : sizeof(block);
+    uint32_t test_crc = CRC32_INITIAL;
+    int n;
+    while ((n = f2.read(readBuf, readSize)) > 0) {
+        test_crc = crc32Update(readBuf, n, test_crc);
     }
     f2.close();
+    stats.readbackMicros += micros() - start;
 
-    if (test_hash != hash) {
+    if (test_crc != crc) {
         LOG_ERROR("Readback failed hash mismatch\n");
         return false;
     }
@@ -5,6 +5,21 @@
 
 #ifdef FSCom
 
+#include <memory>
+
+// Writes are collected into chunks of this size before they go to the filesystem, one flash page on nrf52 and esp32
+#ifndef SAFEFILE_BUFFER_SIZE
+#define SAFEFILE_BUFFER_SIZE 4096
+#endif
+
+/// Totals over every SafeFile since boot
+struct SafeFileStats {
+    uint32_t files;          // closed
+    uint32_t bytes;          // given to write()
+    uint32_t fsWrites;       // writes passed on to the filesystem
+    uint32_t readbackMicros; // spent verifying what we wrote
+};
+
 /**
  * This class provides 'safe'/paranoid file writing.
  *
@@ -12,8 +27,10 @@
  * be very careful about how we write files.  This class provides a restricted (Stream only) writing API for writing to files.
  *
  * Notably:
- * - we keep a simple xor hash of all characters that were written.
+ * - we keep a CRC32 of all characters that were written, updated as they arrive.
  * - We do not allow seeking (because we want to maintain our hash)
+ * - writes are buffered into SAFEFILE_BUFFER_SIZE chunks, nanopb otherwise gives us a few bytes at a time and each of those
+ * would be a separate filesystem write
  * - we provide an close() method which is similar to close but returns false if we were unable to successfully write the
  * file.  Also this method
  * - atomically replaces any old version of the file on the disk with our new file (after first rereading the file from the disk
@@ -36,14 +53,25 @@ class SafeFile : public Print
      */
     bool close();
 
+    static const SafeFileStats &getStats() { return stats; }
+
   private:
+    /// Write out what we have buffered, @return false if the filesystem didn't take all of it
+    bool flush();
+
     /// Read our (closed) tempfile back in and compare the hash
     bool testReadback();
 
     String filename;
     File f;
     bool fullAtomic;
-    uint8_t hash = 0;
+    bool writeFailed = false;
+    uint32_t crc;
+
+    std::unique_ptr<uint8_t[]> buffer; // null if we couldn't spare the RAM, then every write goes straight through
+    size_t buffered = 0;
+
+    static SafeFileStats stats;
 };
 
-#endif
\ No newline at end of file
+#endif
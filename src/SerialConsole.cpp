@@ -37,6 +37,7 @@ SerialConsole::SerialConsole() : StreamAPI(&Port), RedirectablePrint(&Port), con
 {
     assert(!console);
     console = this;
+    readerThread = this;
     canWrite = false; // We don't send packets to our port until it has talked to us first
 
 #ifdef RP2040_SLOW_CLOCK
@@ -44,6 +45,10 @@ SerialConsole::SerialConsole() : StreamAPI(&Port), RedirectablePrint(&Port), con
     Port.setRX(SERIAL2_RX);
 #endif
     Port.begin(SERIAL_BAUD);
+#if defined(ARCH_ESP32) && !ARDUINO_USB_CDC_ON_BOOT && !defined(USER_DEBUG_PORT)
+    // The UART driver tells us when bytes arrive, so we don't add up to a poll interval of latency to each request
+    Port.onReceive([]() { console->wake(); });
+#endif
 #if defined(ARCH_NRF52) || defined(CONFIG_IDF_TARGET_ESP32S2) || defined(CONFIG_IDF_TARGET_ESP32S3) || defined(ARCH_RP2040)
     time_t timeout = millis();
     while (!Port) {
@@ -61,11 +66,16 @@ SerialConsole::SerialConsole() : StreamAPI(&Port), RedirectablePrint(&Port), con
 
 int32_t SerialConsole::runOnce()
 {
+    // setup() is done once we get here, from now on log messages can wait for us instead of being printed by whoever logs them
+    enableLogRing();
+    drainLog();
+
     return runOncePart();
 }
 
 void SerialConsole::flush()
 {
+    drainLog();
     Port.flush();
 }
 
@@ -116,8 +126,8 @@ void SerialConsole::log_to_serial(const char *logLevel, const char *format, va_l
             break;
         }
 
-        auto thread = concurrency::OSThread::currentThread;
-        emitLogRecord(ll, thread ? thread->ThreadName.c_str() : "", format, arg);
+        const char *threadName = getLogThreadName();
+        emitLogRecord(ll, threadName ? threadName : "", format, arg);
     } else
         RedirectablePrint::log_to_serial(logLevel, format, arg);
 }
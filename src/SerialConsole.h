@@ -31,6 +31,10 @@ class SerialConsole : public StreamAPI, public RedirectablePrint, private concur
 
     virtual int32_t runOnce() override;
 
+    /// Run early if StreamAPI::wake() was called
+    virtual bool shouldRun(unsigned long time) override { return (takeWake() && enabled) || OSThread::shouldRun(time); }
+
+    /// Print any log messages still waiting in the log ring and wait for the port to send them
     void flush();
 
   protected:
@@ -781,6 +781,9 @@ bool GPS::setup()
                 // BBR will survive a restart, and power off for a while, but modules with small backup
                 // batteries or super caps will not retain the config for a long power off time.
             }
+#ifdef GPS_UBX_NAV_PVT
+            enableNavPvt();
+#endif
             msglen = makeUBXPacket(0x06, 0x09, sizeof(_message_SAVE), _message_SAVE);
             _serial_gps->write(UBXscratch, msglen);
             if (getACK(0x06, 0x09, 2000) != GNSS_RESPONSE_OK) {
@@ -1561,6 +1564,19 @@ bool GPS::lookForTime()
         return false;
     }
 #endif
+    if (navPvtLen && millis() - navPvtMsec < GPS_SOL_EXPIRY_MS) {
+        meshtastic_Position fix = meshtastic_Position_init_default;
+        decodeNavPvt(navPvt, navPvtLen, fix);
+        if (!fix.timestamp)
+            return false;
+        LOG_DEBUG("UBX GPS time %u\n", fix.timestamp);
+        struct timeval tv;
+        tv.tv_sec = fix.timestamp;
+        tv.tv_usec = 0;
+        perhapsSetRTC(RTCQualityGPS, &tv);
+        return true;
+    }
+
     auto ti = reader.time;
     auto d = reader.date;
     if (ti.isValid() && d.isValid()) { // Note: we don't check for updated, because we'll only be called if needed
@@ -1615,6 +1631,29 @@ bool GPS::lookForLocation()
         }
     }
 #endif
+    if (navPvtUpdated) {
+        // The receiver sends UBX-NAV-PVT, it has everything we would otherwise piece together from GGA, RMC and GSA
+        navPvtUpdated = false;
+        meshtastic_Position fix = p;
+        decodeNavPvt(navPvt, navPvtLen, fix);
+        fixQual = fix.fix_quality;
+#ifndef TINYGPS_OPTION_NO_CUSTOM_FIELDS
+        fixType = fix.fix_type;
+#endif
+        if (!hasLock())
+            return false;
+        if (fix.PDOP == 0 || !fix.timestamp) {
+            LOG_WARN("BOGUS NAV-PVT REJECTED: pDOP %u, time %u\n", fix.PDOP, fix.timestamp);
+            return false;
+        }
+        if (abs(fix.latitude_i) > 900000000 || abs(fix.longitude_i) > 1800000000)
+            return false;
+
+        p = fix;
+        p.location_source = meshtastic_Position_LocSource_LOC_INTERNAL;
+        return true;
+    }
+
     // By default, TinyGPS++ does not parse GPGSA lines, which give us
     //   the 2D/3D fixType (see NMEAGPS.h)
     // At a minimum, use the fixQuality indicator in GPGGA (FIXME?)
@@ -1760,44 +1799,166 @@ bool GPS::hasLock()
 
 bool GPS::hasFlow()
 {
-    return reader.passedChecksum() > 0;
+    return reader.passedChecksum() > 0 || ingestStats.navPvtFrames > 0;
 }
 
 bool GPS::whileActive()
 {
-    unsigned int charsInBuf = 0;
     bool isValid = false;
     if (powerState != GPS_ACTIVE) {
         clearBuffer();
+        nmeaBuffer.clear();
         return false;
     }
 #ifdef SERIAL_BUFFER_SIZE
     if (_serial_gps->available() >= SERIAL_BUFFER_SIZE - 1) {
         LOG_WARN("GPS Buffer full with %u bytes waiting. Flushing to avoid corruption.\n", _serial_gps->available());
+        ingestStats.droppedBytes += _serial_gps->available();
         clearBuffer();
     }
 #endif
     // if (_serial_gps->available() > 0)
     // LOG_DEBUG("GPS Bytes Waiting: %u\n", _serial_gps->available());
-    // First consume any chars that have piled up at the receiver
-    while (_serial_gps->available() > 0) {
-        int c = _serial_gps->read();
-        UBXscratch[charsInBuf] = c;
+    // First consume any chars that have piled up at the receiver, in blocks.  We only ask for what available() promised, so
+    // this never waits for the stream timeout.
+    int avail;
+    while ((avail = _serial_gps->available()) > 0) {
+        size_t space;
+        uint8_t *dest = nmeaBuffer.reserve(space);
+        size_t want = min((size_t)avail, space);
+#ifdef ARCH_NRF52
+        // available() can over-report on rf52 adafruit arduino, so don't let readBytes() sit waiting for the stream timeout
+        size_t n = 0;
+        int c;
+        while (n < want && (c = _serial_gps->read()) >= 0)
+            dest[n++] = (uint8_t)c;
+#else
+        size_t n = _serial_gps->readBytes(dest, want);
+#endif
+        if (n == 0)
+            break; // We ran out of characters (even though available said otherwise)
 #ifdef GPS_DEBUG
-        LOG_DEBUG("%c", c);
+        LOG_DEBUG("%.*s", (int)n, dest);
 #endif
-        isValid |= reader.encode(c);
-        if (charsInBuf > sizeof(UBXscratch) - 10 || c == '\r') {
-            if (strnstr((char *)UBXscratch, "$GPTXT,01,01,02,u-blox ag - www.u-blox.com*50", charsInBuf)) {
-                rebootsSeen++;
+        nmeaBuffer.commit(n);
+        ingestStats.bytesRead += n;
+        isValid |= parseSentences();
+    }
+    ingestStats.droppedBytes += nmeaBuffer.takeDroppedBytes();
+    reportIngestStats();
+    return isValid;
+}
+
+bool GPS::parseSentences()
+{
+    bool isValid = false;
+    const uint8_t *message;
+    size_t len;
+    NMEASentenceBuffer::Message type;
+    while ((type = nmeaBuffer.next(message, len)) != NMEASentenceBuffer::NO_MESSAGE) {
+        if (type == NMEASentenceBuffer::UBX_FRAME) {
+            // Class, id and payload length follow the sync chars, the checksum has been checked
+            size_t payloadLen = len - 8;
+            if (message[2] == UBX_CLASS_NAV && message[3] == UBX_ID_NAV_PVT && payloadLen >= UBX_NAV_PVT_MIN_LEN) {
+                navPvtLen = min(payloadLen, sizeof(navPvt));
+                memcpy(navPvt, message + 6, navPvtLen);
+                navPvtMsec = millis();
+                navPvtUpdated = true;
+                ingestStats.navPvtFrames++;
+                isValid = true;
+            } else {
+                ingestStats.sentencesSkipped++;
             }
-            charsInBuf = 0;
+            continue;
+        }
+
+        const char *sentence = (const char *)message;
+        // Only what lookForTime() and lookForLocation() use, TinyGPS++ would just throw the rest away a char at a time
+        if (NMEASentenceBuffer::isType(sentence, len, "GGA") || NMEASentenceBuffer::isType(sentence, len, "RMC") ||
+            NMEASentenceBuffer::isType(sentence, len, "GSA")) {
+            uint32_t start = micros();
+            for (size_t i = 0; i < len; i++)
+                isValid |= reader.encode(sentence[i]);
+            ingestStats.parseMicros += micros() - start;
+            ingestStats.sentencesParsed++;
         } else {
-            charsInBuf++;
+            static const char ubloxBanner[] = "$GPTXT,01,01,02,u-blox ag - www.u-blox.com*50";
+            if (len > sizeof(ubloxBanner) - 1 && memcmp(sentence, ubloxBanner, sizeof(ubloxBanner) - 1) == 0)
+                rebootsSeen++;
+            ingestStats.sentencesSkipped++;
         }
     }
     return isValid;
 }
+
+bool GPS::enableNavPvt()
+{
+    uint8_t msglen;
+    if (strncmp(info.hwVersion, "000A0000", 8) == 0) {
+        // M10: one VALSET per layer turns NAV-PVT on and GGA/RMC/GSA off together, or NAKs and changes nothing
+        msglen = makeUBXPacket(0x06, 0x8A, sizeof(_message_VALSET_ENABLE_NAV_PVT_RAM), _message_VALSET_ENABLE_NAV_PVT_RAM);
+        clearBuffer();
+        _serial_gps->write(UBXscratch, msglen);
+        if (getACK(0x06, 0x8A, 300) != GNSS_RESPONSE_OK) {
+            LOG_WARN("Unable to enable UBX-NAV-PVT for M10 GPS, staying with NMEA.\n");
+            return false;
+        }
+        delay(250);
+        msglen = makeUBXPacket(0x06, 0x8A, sizeof(_message_VALSET_ENABLE_NAV_PVT_BBR), _message_VALSET_ENABLE_NAV_PVT_BBR);
+        _serial_gps->write(UBXscratch, msglen);
+        if (getACK(0x06, 0x8A, 300) != GNSS_RESPONSE_OK) {
+            LOG_WARN("Unable to enable UBX-NAV-PVT for M10 GPS BBR.\n");
+        }
+    } else {
+        // Only turn NMEA off once we know NAV-PVT is coming, the Neo-6 doesn't have it
+        msglen = makeUBXPacket(0x06, 0x01, sizeof(_message_NAV_PVT), _message_NAV_PVT);
+        clearBuffer();
+        _serial_gps->write(UBXscratch, msglen);
+        if (getACK(0x06, 0x01, 500) != GNSS_RESPONSE_OK) {
+            LOG_WARN("Unable to enable UBX-NAV-PVT, staying with NMEA.\n");
+            return false;
+        }
+
+        msglen = makeUBXPacket(0x06, 0x01, sizeof(_message_DISABLE_GGA), _message_DISABLE_GGA);
+        _serial_gps->write(UBXscratch, msglen);
+        if (getACK(0x06, 0x01, 500) != GNSS_RESPONSE_OK) {
+            LOG_WARN("Unable to disable NMEA GGA.\n");
+        }
+
+        msglen = makeUBXPacket(0x06, 0x01, sizeof(_message_DISABLE_RMC), _message_DISABLE_RMC);
+        _serial_gps->write(UBXscratch, msglen);
+        if (getACK(0x06, 0x01, 500) != GNSS_RESPONSE_OK) {
+            LOG_WARN("Unable to disable NMEA RMC.\n");
+        }
+
+        msglen = makeUBXPacket(0x06, 0x01, sizeof(_message_DISABLE_GSA), _message_DISABLE_GSA);
+        _serial_gps->write(UBXscratch, msglen);
+        if (getACK(0x06, 0x01, 500) != GNSS_RESPONSE_OK) {
+            LOG_WARN("Unable to disable NMEA GSA.\n");
+        }
+    }
+    LOG_INFO("GPS sends UBX-NAV-PVT instead of NMEA.\n");
+    return true;
+}
+
+void GPS::reportIngestStats()
+{
+    uint32_t now = millis();
+    uint32_t elapsed = now - lastStatsReportMsec;
+    if (elapsed < 60 * 1000)
+        return;
+
+    const GPSIngestStats &was = reportedStats;
+    if (lastStatsReportMsec)
+        LOG_DEBUG("GPS: %u bytes/s, %u sentences parsed and %u skipped, %u NAV-PVT, %u us/s parsing, %u bytes dropped\n",
+                  (ingestStats.bytesRead - was.bytesRead) * 1000 / elapsed, ingestStats.sentencesParsed - was.sentencesParsed,
+                  ingestStats.sentencesSkipped - was.sentencesSkipped, ingestStats.navPvtFrames - was.navPvtFrames,
+                  (uint32_t)((uint64_t)(ingestStats.parseMicros - was.parseMicros) * 1000 / elapsed),
+                  ingestStats.droppedBytes - was.droppedBytes);
+    reportedStats = ingestStats;
+    lastStatsReportMsec = now;
+}
+
 void GPS::enable()
 {
     // Clear the old scheduling info (reset the lock-time prediction)
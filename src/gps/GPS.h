@@ -3,8 +3,10 @@
 #if !MESHTASTIC_EXCLUDE_GPS
 
 #include "GPSStatus.h"
+#include "NMEASentenceBuffer.h"
 #include "Observer.h"
 #include "TinyGPS++.h"
+#include "UBXNavPvt.h"
 #include "concurrency/OSThread.h"
 #include "input/RotaryEncoderInterruptImpl1.h"
 #include "input/UpDownInterruptImpl1.h"
@@ -47,6 +49,16 @@ enum GPSPowerState : uint8_t {
     GPS_OFF        // Powered off indefinitely
 };
 
+/// What whileActive() has read from the GPS, and what it cost
+struct GPSIngestStats {
+    uint32_t bytesRead;
+    uint32_t sentencesParsed;  // GGA, RMC and GSA, given to TinyGPS++
+    uint32_t sentencesSkipped; // the other sentences and UBX frames, which nothing uses
+    uint32_t droppedBytes;     // lost to a full UART buffer, or not part of any sentence
+    uint32_t parseMicros;      // time spent in TinyGPS++
+    uint32_t navPvtFrames;     // UBX-NAV-PVT solutions, instead of GGA/RMC/GSA
+};
+
 // Generate a string representation of DOP
 const char *getDOPString(uint32_t dop);
 
@@ -97,6 +109,16 @@ class GPS : private concurrency::OSThread
 
     uint8_t numSatellites = 0;
 
+    NMEASentenceBuffer nmeaBuffer; // what we have read from the UART, until it makes a whole sentence or UBX frame
+    GPSIngestStats ingestStats = {};
+    GPSIngestStats reportedStats = {}; // ingestStats when we last logged them
+    uint32_t lastStatsReportMsec = 0;
+
+    uint8_t navPvt[UBX_NAV_PVT_LEN]; // the last UBX-NAV-PVT payload, if the receiver sends them
+    size_t navPvtLen = 0;
+    uint32_t navPvtMsec = 0;    // when it arrived
+    bool navPvtUpdated = false; // not yet looked at by lookForLocation()
+
     CallbackObserver<GPS, void *> notifyDeepSleepObserver = CallbackObserver<GPS, void *>(this, &GPS::prepareDeepSleep);
 
   public:
@@ -127,6 +149,10 @@ class GPS : private concurrency::OSThread
     static const uint8_t _message_RMC[];
     static const uint8_t _message_AID[];
     static const uint8_t _message_GGA[];
+    static const uint8_t _message_NAV_PVT[];
+    static const uint8_t _message_DISABLE_GGA[];
+    static const uint8_t _message_DISABLE_RMC[];
+    static const uint8_t _message_DISABLE_GSA[];
     static const uint8_t _message_PMS[];
     static const uint8_t _message_SAVE[];
 
@@ -144,6 +170,8 @@ class GPS : private concurrency::OSThread
     static const uint8_t _message_VALSET_ENABLE_NMEA_BBR[];
     static const uint8_t _message_VALSET_DISABLE_SBAS_RAM[];
     static const uint8_t _message_VALSET_DISABLE_SBAS_BBR[];
+    static const uint8_t _message_VALSET_ENABLE_NAV_PVT_RAM[];
+    static const uint8_t _message_VALSET_ENABLE_NAV_PVT_BBR[];
 
     // CASIC commands for ATGM336H
     static const uint8_t _message_CAS_CFG_RST_FACTORY[];
@@ -185,6 +213,8 @@ class GPS : private concurrency::OSThread
     /// Return true if we are connected to a GPS
     bool isConnected() const { return hasGPS; }
 
+    const GPSIngestStats &getIngestStats() const { return ingestStats; }
+
     bool isPowerSaving() const { return config.position.gps_mode != meshtastic_Config_PositionConfig_GpsMode_ENABLED; }
 
     // Empty the input buffer as quickly as possible
@@ -287,6 +317,24 @@ class GPS : private concurrency::OSThread
      */
     void publishUpdate();
 
+    /**
+     * Give the complete sentences in nmeaBuffer to the parser, and keep any UBX-NAV-PVT
+     *
+     * @return true if one completed a valid fix or time
+     */
+    bool parseSentences();
+
+    /**
+     * Ask a u-blox receiver for one binary UBX-NAV-PVT per epoch instead of GGA/RMC/GSA, when built with GPS_UBX_NAV_PVT.
+     * A receiver that doesn't ACK it keeps sending NMEA.
+     *
+     * @return true if the receiver accepted
+     */
+    bool enableNavPvt();
+
+    /// Log bytes, dropped bytes and parse time per second, every so often
+    void reportIngestStats();
+
     virtual int32_t runOnce() override;
 
     // Get GNSS model
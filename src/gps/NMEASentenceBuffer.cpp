@@ -0,0 +1,107 @@
+#include "NMEASentenceBuffer.h"
+
+#include <string.h>
+
+const size_t NMEASentenceBuffer::BUFFER_SIZE;
+
+#define UBX_SYNC1 0xB5
+#define UBX_SYNC2 0x62
+#define UBX_HEADER_LEN 6 // sync chars, class, id and payload length
+#define UBX_CHECKSUM_LEN 2
+
+uint8_t *NMEASentenceBuffer::reserve(size_t &space)
+{
+    // Move what we haven't looked at yet to the front
+    if (start > 0) {
+        memmove(buf, buf + start, len - start);
+        len -= start;
+        start = 0;
+    }
+
+    // Full, and next() found no message in it: the one starting at buf[0] can't fit, so drop it and keep everything from the
+    // first '$' or sync char after it, which might be the beginning of the next one (the scan goes up from buf[1])
+    if (len == BUFFER_SIZE) {
+        size_t keep = len - 1;
+        while (keep > 0 && buf[len - keep] != '$' && buf[len - keep] != UBX_SYNC1)
+            keep--;
+        droppedBytes += len - keep;
+        memmove(buf, buf + len - keep, keep);
+        len = keep;
+    }
+
+    space = BUFFER_SIZE - len;
+    return buf + len;
+}
+
+const uint8_t *NMEASentenceBuffer::findStart(const uint8_t *from, size_t n)
+{
+    // NMEA is plain ASCII, so a sync char before the next '$' can only be a UBX frame (or noise)
+    const uint8_t *dollar = (const uint8_t *)memchr(from, '$', n);
+    const uint8_t *sync = (const uint8_t *)memchr(from, UBX_SYNC1, dollar ? dollar - from : n);
+    return sync ? sync : dollar;
+}
+
+NMEASentenceBuffer::Message NMEASentenceBuffer::next(const uint8_t *&message, size_t &messageLen)
+{
+    while (start < len) {
+        const uint8_t *first = findStart(buf + start, len - start);
+        if (!first) {
+            droppedBytes += len - start;
+            start = len = 0;
+            return NO_MESSAGE;
+        }
+        drop(first - (buf + start));
+        size_t avail = len - start;
+
+        if (*first == UBX_SYNC1) {
+            if (avail < UBX_HEADER_LEN)
+                return NO_MESSAGE; // wait for the rest of the header
+            size_t frameLen = UBX_HEADER_LEN + (first[4] | (first[5] << 8)) + UBX_CHECKSUM_LEN;
+            if (first[1] != UBX_SYNC2 || frameLen > BUFFER_SIZE) {
+                drop(1);
+                continue;
+            }
+            if (avail < frameLen)
+                return NO_MESSAGE; // wait for the rest
+
+            // 8-bit Fletcher over class, id, length and payload
+            uint8_t ckA = 0, ckB = 0;
+            for (size_t i = 2; i < frameLen - UBX_CHECKSUM_LEN; i++) {
+                ckA += first[i];
+                ckB += ckA;
+            }
+            if (ckA != first[frameLen - 2] || ckB != first[frameLen - 1]) {
+                drop(1);
+                continue;
+            }
+
+            message = first;
+            messageLen = frameLen;
+            start += frameLen;
+            return UBX_FRAME;
+        }
+
+        const uint8_t *end = (const uint8_t *)memchr(first, '\n', avail);
+
+        // A sentence cut short by the start of the next message
+        const uint8_t *another = findStart(first + 1, (end ? end : buf + len) - first - 1);
+        if (another) {
+            drop(another - first);
+            continue;
+        }
+        if (!end)
+            return NO_MESSAGE; // wait for the rest
+
+        message = first;
+        messageLen = end - first + 1;
+        start += messageLen;
+        return NMEA_SENTENCE;
+    }
+    return NO_MESSAGE;
+}
+
+bool NMEASentenceBuffer::isType(const char *sentence, size_t sentenceLen, const char *type)
+{
+    // $ttSSS, where tt is the talker (GP, GN, BD...) and SSS the sentence type
+    return sentenceLen >= 7 && memcmp(sentence + 3, type, 3) == 0 && sentence[6] == ',';
+}
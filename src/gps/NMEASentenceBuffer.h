@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Collects what we read from the GPS UART, in blocks, and splits it into NMEA sentences and UBX frames.
+ *
+ * Message boundaries are found with memchr rather than by looking at each byte, so the only bytes we touch one at a time
+ * are those of the messages we hand to a parser.  Anything that isn't part of a message (the end of a sentence we joined
+ * half way, a sentence too long to be NMEA, a UBX frame with a bad checksum) is skipped and counted as dropped.
+ */
+class NMEASentenceBuffer
+{
+  public:
+    /// The longest NMEA sentence is 82 characters and a UBX-NAV-PVT frame 100 bytes, this holds a few
+    static const size_t BUFFER_SIZE = 256;
+
+    enum Message { NO_MESSAGE, NMEA_SENTENCE, UBX_FRAME };
+
+    /**
+     * Where to put the next bytes read from the UART.  There is always room for at least some, if the buffer is full of
+     * something that isn't a message we drop it.
+     *
+     * @param space set to the number of bytes that fit
+     */
+    uint8_t *reserve(size_t &space);
+
+    /// n bytes were put where reserve() said
+    void commit(size_t n) { len += n; }
+
+    /**
+     * Find the next complete message: a sentence from its '$' to its '\n', or a UBX frame from its sync chars to its
+     * checksum, which has been checked.
+     *
+     * @return NO_MESSAGE if there isn't one yet.  The message stays valid until the next reserve().
+     */
+    Message next(const uint8_t *&message, size_t &messageLen);
+
+    /// Is this a sentence of the given type ("GGA", "RMC"...), from any talker?
+    static bool isType(const char *sentence, size_t sentenceLen, const char *type);
+
+    /// Forget anything we have, e.g. when the GPS goes to sleep
+    void clear() { start = len = 0; }
+
+    /// Bytes dropped since we were last asked
+    uint32_t takeDroppedBytes()
+    {
+        uint32_t n = droppedBytes;
+        droppedBytes = 0;
+        return n;
+    }
+
+  private:
+    /// The first byte that could start a message, or nullptr
+    static const uint8_t *findStart(const uint8_t *from, size_t n);
+
+    /// Skip n bytes that aren't part of a message
+    void drop(size_t n)
+    {
+        droppedBytes += n;
+        start += n;
+    }
+
+    uint8_t buf[BUFFER_SIZE];
+    size_t start = 0; // where we look for the next message
+    size_t len = 0;   // bytes in buf
+    uint32_t droppedBytes = 0;
+};
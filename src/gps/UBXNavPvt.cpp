@@ -0,0 +1,85 @@
+#include "UBXNavPvt.h"
+#include "RTC.h"
+
+#include <time.h>
+
+// NAV-PVT fields we use, by offset into the payload (little endian)
+#define PVT_YEAR 4
+#define PVT_MONTH 6
+#define PVT_DAY 7
+#define PVT_HOUR 8
+#define PVT_MIN 9
+#define PVT_SEC 10
+#define PVT_VALID 11 // bit 0 validDate, bit 1 validTime
+#define PVT_FIX_TYPE 20
+#define PVT_FLAGS 21 // bit 0 gnssFixOK, bit 1 diffSoln
+#define PVT_NUM_SV 23
+#define PVT_LON 24      // 1e-7 deg
+#define PVT_LAT 28      // 1e-7 deg
+#define PVT_HEIGHT 32   // above the ellipsoid, mm
+#define PVT_HMSL 36     // above mean sea level, mm
+#define PVT_GSPEED 60   // mm/s
+#define PVT_HEAD_MOT 64 // 1e-5 deg
+#define PVT_PDOP 76     // 0.01
+#define PVT_FLAGS3 78   // bit 0 invalidLlh, M8 and later only
+
+static uint16_t u2(const uint8_t *b)
+{
+    return b[0] | (b[1] << 8);
+}
+
+static int32_t i4(const uint8_t *b)
+{
+    return (int32_t)((uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24));
+}
+
+bool decodeNavPvt(const uint8_t *payload, size_t len, meshtastic_Position &p)
+{
+    if (len < UBX_NAV_PVT_MIN_LEN)
+        return false;
+
+    uint8_t fixType = payload[PVT_FIX_TYPE];
+    uint8_t flags = payload[PVT_FLAGS];
+    bool fixOK = (flags & 0x01) && (fixType == 2 || fixType == 3 || fixType == 4); // not dead reckoning or time only
+    if (len >= UBX_NAV_PVT_LEN && (payload[PVT_FLAGS3] & 0x01))
+        fixOK = false; // the receiver says lat, lon and height are not valid
+
+    // What GGA and GSA would have said
+    p.fix_quality = fixOK ? ((flags & 0x02) ? 2 : 1) : 0;
+    p.fix_type = fixOK ? (fixType == 2 ? 2 : 3) : 1;
+
+    p.latitude_i = i4(payload + PVT_LAT);
+    p.longitude_i = i4(payload + PVT_LON);
+
+    int32_t height = i4(payload + PVT_HEIGHT) / 1000;
+    p.altitude = i4(payload + PVT_HMSL) / 1000;
+    p.altitude_hae = height;
+    p.altitude_geoidal_separation = height - p.altitude;
+
+    // NAV-PVT has no HDOP, undo the naive emulation used for NMEA receivers without GSA (assumes VDOP==HDOP)
+    p.PDOP = u2(payload + PVT_PDOP);
+    p.HDOP = p.PDOP / 1.41;
+
+    p.sats_in_view = payload[PVT_NUM_SV];
+    int32_t speed = i4(payload + PVT_GSPEED);
+    p.ground_speed = speed > 0 ? (uint32_t)speed * 36 / 10000 : 0; // mm/s to km/h
+    int32_t heading = i4(payload + PVT_HEAD_MOT);
+    if (heading >= 0 && heading < 36000000) // sanity check
+        p.ground_track = heading;
+
+    if ((payload[PVT_VALID] & 0x03) == 0x03) {
+        struct tm t;
+        t.tm_sec = payload[PVT_SEC];
+        t.tm_min = payload[PVT_MIN];
+        t.tm_hour = payload[PVT_HOUR];
+        t.tm_mday = payload[PVT_DAY];
+        t.tm_mon = payload[PVT_MONTH] - 1;
+        t.tm_year = u2(payload + PVT_YEAR) - 1900;
+        t.tm_isdst = false;
+        p.timestamp = gm_mktime(&t);
+    } else {
+        p.timestamp = 0;
+    }
+
+    return true;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "mesh/generated/meshtastic/mesh.pb.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// UBX-NAV-PVT, the receiver's whole navigation solution for an epoch in one binary message
+#define UBX_CLASS_NAV 0x01
+#define UBX_ID_NAV_PVT 0x07
+
+// u-blox 7 sends 84 bytes, M8 and later 92.  We only need the fields both have.
+#define UBX_NAV_PVT_MIN_LEN 84
+#define UBX_NAV_PVT_LEN 92
+
+/**
+ * Decode a UBX-NAV-PVT payload into the fields GPS::lookForLocation() fills from NMEA, in the same units.
+ *
+ * fix_quality and fix_type are given the GGA and GSA meanings, so GPS::hasLock() can judge them the same way.  timestamp
+ * is zeroed unless the receiver says date and time are valid.  Fields NAV-PVT doesn't have are left alone.
+ *
+ * @return false if the payload is too short to be NAV-PVT, p is then untouched
+ */
+bool decodeNavPvt(const uint8_t *payload, size_t len, meshtastic_Position &p);
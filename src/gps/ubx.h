@@ -263,6 +263,49 @@ const uint8_t GPS::_message_GGA[] = {
     0x00        // Reserved
 };
 
+// Enable UBX-NAV-PVT. One binary message with position, velocity, time, fix type and DOP for every epoch, used instead of
+// GGA/RMC/GSA when built with GPS_UBX_NAV_PVT
+const uint8_t GPS::_message_NAV_PVT[] = {
+    0x01, 0x07, // UBX ID for NAV-PVT
+    0x00,       // Rate for DDC
+    0x01,       // Rate for UART1
+    0x00,       // Rate for UART2
+    0x01,       // Rate for USB, usefull for native linux
+    0x00,       // Rate for SPI
+    0x00        // Reserved
+};
+
+// Disable GGA and RMC once NAV-PVT has been accepted (GSA is already off, but might have been left on by older firmware)
+const uint8_t GPS::_message_DISABLE_GGA[] = {
+    0xF0, 0x00, // NMEA ID for GGA
+    0x00,       // Rate for DDC
+    0x00,       // Rate for UART1
+    0x00,       // Rate for UART2
+    0x00,       // Rate for USB
+    0x00,       // Rate for SPI
+    0x00        // Reserved
+};
+
+const uint8_t GPS::_message_DISABLE_GSA[] = {
+    0xF0, 0x02, // NMEA ID for GSA
+    0x00,       // Rate for DDC
+    0x00,       // Rate for UART1
+    0x00,       // Rate for UART2
+    0x00,       // Rate for USB
+    0x00,       // Rate for SPI
+    0x00        // Reserved
+};
+
+const uint8_t GPS::_message_DISABLE_RMC[] = {
+    0xF0, 0x04, // NMEA ID for RMC
+    0x00,       // Rate for DDC
+    0x00,       // Rate for UART1
+    0x00,       // Rate for UART2
+    0x00,       // Rate for USB
+    0x00,       // Rate for SPI
+    0x00        // Reserved
+};
+
 // Disable UBX-AID-ALPSRV as it may confuse TinyGPS. The Neo-6 seems to send this message
 // whether the AID Autonomous is enabled or not
 const uint8_t GPS::_message_AID[] = {
@@ -428,6 +471,15 @@ const uint8_t GPS::_message_VALSET_DISABLE_SBAS_RAM[] = {0x00, 0x01, 0x00, 0x00,
 const uint8_t GPS::_message_VALSET_DISABLE_SBAS_BBR[] = {0x00, 0x02, 0x00, 0x00, 0x20, 0x00, 0x31,
                                                          0x10, 0x00, 0x05, 0x00, 0x31, 0x10, 0x00};
 
+// Enable UBX-NAV-PVT (CFG-MSGOUT-UBX_NAV_PVT_UART1 0x20910007) and disable GGA, RMC and GSA in the same message, so a
+// receiver that NAKs any of it keeps sending NMEA
+const uint8_t GPS::_message_VALSET_ENABLE_NAV_PVT_RAM[] = {0x00, 0x01, 0x00, 0x00, 0x07, 0x00, 0x91, 0x20, 0x01, 0xbb, 0x00,
+                                                           0x91, 0x20, 0x00, 0xac, 0x00, 0x91, 0x20, 0x00, 0xc0, 0x00, 0x91,
+                                                           0x20, 0x00};
+const uint8_t GPS::_message_VALSET_ENABLE_NAV_PVT_BBR[] = {0x00, 0x02, 0x00, 0x00, 0x07, 0x00, 0x91, 0x20, 0x01, 0xbb, 0x00,
+                                                           0x91, 0x20, 0x00, 0xac, 0x00, 0x91, 0x20, 0x00, 0xc0, 0x00, 0x91,
+                                                           0x20, 0x00};
+
 /*
 Operational issues with the M10:
 
@@ -7,6 +7,9 @@
 EInkDynamicDisplay::EInkDynamicDisplay(uint8_t address, int sda, int scl, OLEDDISPLAY_GEOMETRY geometry, HW_I2C i2cBus)
     : EInkDisplay(address, sda, scl, geometry, i2cBus), NotifiedWorkerThread("EInkDynamicDisplay")
 {
+    // A copy of the frame on the panel, to find what changed
+    previousBuffer = new uint8_t[EInkDisplay::displayBufferSize](); // Init with zeros
+
     // If tracking ghost pixels, grab memory
 #ifdef EINK_LIMIT_GHOSTING_PX
     dirtyPixels = new uint8_t[EInkDisplay::displayBufferSize](); // Init with zeros
@@ -16,6 +19,8 @@ EInkDynamicDisplay::EInkDynamicDisplay(uint8_t address, int sda, int scl, OLEDDI
 // Destructor
 EInkDynamicDisplay::~EInkDynamicDisplay()
 {
+    delete[] previousBuffer;
+
     // If we were tracking ghost pixels, free the memory
 #ifdef EINK_LIMIT_GHOSTING_PX
     delete[] dirtyPixels;
@@ -46,11 +51,26 @@ void EInkDynamicDisplay::addFrameFlag(frameFlagTypes flag)
 // GxEPD2 code to set fast refresh
 void EInkDynamicDisplay::configForFastRefresh()
 {
+    refreshArea = (uint32_t)displayWidth * displayHeight;
+
     // Variant-specific code can go here
 #if defined(PRIVATE_HW)
 #else
     // Otherwise:
-    adafruitDisplay->setPartialWindow(0, 0, adafruitDisplay->width(), adafruitDisplay->height());
+    // If only a small part of the frame changed, only send and refresh that part of the panel
+    const Region &r = dirtyRegion;
+    uint32_t area = (uint32_t)r.w * r.h;
+    if (r.w && area * 100 <= refreshArea * EINK_PARTIAL_WINDOW_PERCENT) {
+        // Flipped the same way as the pixels, in EInkDisplay::forceDisplay()
+        const bool flipped = config.display.flip_screen;
+        uint16_t x = flipped ? displayWidth - r.x - r.w : r.x;
+        uint16_t y = flipped ? displayHeight - r.y - r.h : r.y;
+        adafruitDisplay->setPartialWindow(x, y, r.w, r.h);
+        refreshArea = area;
+        refreshStats.partialWindows++;
+        LOG_DEBUG("partial window %ux%u at (%u, %u)\n", r.w, r.h, x, y);
+    } else
+        adafruitDisplay->setPartialWindow(0, 0, adafruitDisplay->width(), adafruitDisplay->height());
 #endif
 }
 
@@ -68,8 +88,8 @@ void EInkDynamicDisplay::configForFullRefresh()
 // Run any relevant GxEPD2 code, so next update will use correct refresh type
 void EInkDynamicDisplay::applyRefreshMode()
 {
-    // Change from FULL to FAST
-    if (currentConfig == FULL && refresh == FAST) {
+    // Change from FULL to FAST, or to this frame's dirty region
+    if (refresh == FAST) {
         configForFastRefresh();
         currentConfig = FAST;
     }
@@ -84,11 +104,17 @@ void EInkDynamicDisplay::applyRefreshMode()
 // Update fastRefreshCount
 void EInkDynamicDisplay::adjustRefreshCounters()
 {
-    if (refresh == FAST)
+    if (refresh == FAST) {
         fastRefreshCount++;
+        refreshStats.fastRefreshes++;
+        refreshStats.pixelsRefreshed += refreshArea;
+    }
 
-    else if (refresh == FULL)
+    else if (refresh == FULL) {
         fastRefreshCount = 0;
+        refreshStats.fullRefreshes++;
+        refreshStats.pixelsRefreshed += (uint32_t)displayWidth * displayHeight;
+    }
 }
 
 // Trigger the display update by calling base class
@@ -155,7 +181,7 @@ bool EInkDynamicDisplay::determineMode()
     // -- New frame is due --
 
     resetRateLimiting(); // Once determineMode() ends, will have to wait again
-    hashImage();         // Generate here, so we can still copy it to previousImageHash, even if we skip the comparison check
+    findDirtyRegion();   // Generate here, used both to skip unchanged frames and to size a fast refresh
     LOG_DEBUG("determineMode(): "); // Begin log entry
 
     // Once mode determined, any remaining checks will bypass
@@ -176,9 +202,11 @@ bool EInkDynamicDisplay::determineMode()
     adjustRefreshCounters();
 
 #ifdef EINK_LIMIT_GHOSTING_PX
-    // Full refresh clears any ghosting
+    // Full refresh clears any ghosting, fast refresh may add some in the dirty region
     if (refresh == FULL)
         resetGhostPixelTracking();
+    else if (refresh == FAST)
+        ghostPixelCount += countGhostPixels(true);
 #endif
 
     // Return - call a refresh or not?
@@ -197,6 +225,7 @@ void EInkDynamicDisplay::checkInitialized()
 
         // Clear any existing image, so we can draw logo with fast-refresh, but also to set GxEPD2_EPD::_initial_write
         adafruitDisplay->clearScreen();
+        redrawAll = true;
 
         LOG_DEBUG("initialized, ");
         initialized = true;
@@ -299,7 +328,7 @@ void EInkDynamicDisplay::checkFrameMatchesPrevious()
         return;
 
     // If frame is *not* a duplicate, abort the check
-    if (imageHash != previousImageHash)
+    if (dirtyRegion.w != 0)
         return;
 
 #if !defined(EINK_BACKGROUND_USES_FAST)
@@ -368,15 +397,46 @@ void EInkDynamicDisplay::resetRateLimiting()
     previousRunMs = millis();
 }
 
-// Generate a hash of this frame, to compare against previous update
-void EInkDynamicDisplay::hashImage()
+// Compare this frame with the one on the panel, find the rectangle that changed
+void EInkDynamicDisplay::findDirtyRegion()
 {
-    imageHash = 0;
+    if (redrawAll) {
+        dirtyRegion = {0, 0, displayWidth, displayHeight};
+        return;
+    }
+
+    // The OLED lib keeps the image as pages of 8 rows with a byte per column, so we compare 8 pixels at a time
+    const uint16_t pages = (displayHeight + 7) / 8;
+    uint16_t minX = displayWidth, maxX = 0, minPage = pages, maxPage = 0;
+    for (uint16_t page = 0; page < pages; page++) {
+        const uint8_t *now = buffer + page * displayWidth;
+        const uint8_t *shown = previousBuffer + page * displayWidth;
+        if (memcmp(now, shown, displayWidth) == 0)
+            continue;
+
+        uint16_t first = 0, last = displayWidth - 1;
+        while (now[first] == shown[first])
+            first++;
+        while (now[last] == shown[last])
+            last--;
+
+        if (first < minX)
+            minX = first;
+        if (last > maxX)
+            maxX = last;
+        if (minPage == pages)
+            minPage = page;
+        maxPage = page;
+    }
 
-    // Sum all bytes of the image buffer together
-    for (uint16_t b = 0; b < (displayWidth / 8) * displayHeight; b++) {
-        imageHash ^= buffer[b] << b;
+    if (minPage == pages) {
+        dirtyRegion = {};
+        return;
     }
+    dirtyRegion.x = minX;
+    dirtyRegion.w = maxX - minX + 1;
+    dirtyRegion.y = minPage * 8;
+    dirtyRegion.h = ((maxPage + 1) * 8 > displayHeight ? displayHeight : (maxPage + 1) * 8) - dirtyRegion.y;
 }
 
 // Store the results of determineMode() for future use, and reset for next call
@@ -386,9 +446,10 @@ void EInkDynamicDisplay::storeAndReset()
     previousRefresh = refresh;
     previousReason = reason;
 
-    // Only store image hash if the display will update
+    // Only store the frame if the display will update
     if (refresh != SKIPPED) {
-        previousImageHash = imageHash;
+        memcpy(previousBuffer, buffer, displayBufferSize);
+        redrawAll = false;
     }
 
     frameFlags = BACKGROUND;
@@ -396,34 +457,27 @@ void EInkDynamicDisplay::storeAndReset()
 }
 
 #ifdef EINK_LIMIT_GHOSTING_PX
-// Count how many ghost pixels the new image will display
-void EInkDynamicDisplay::countGhostPixels()
+// How many more (or fewer) ghost pixels the new image will display. If apply, record its black pixels as dirty
+int32_t EInkDynamicDisplay::countGhostPixels(bool apply)
 {
-    // If a decision was already reached, don't run the check
-    if (refresh != UNSPECIFIED)
-        return;
-
-    // Start a new count
-    ghostPixelCount = 0;
-
-    // Check new image, bit by bit, for any white pixels at locations marked "dirty"
-    for (uint16_t i = 0; i < displayBufferSize; i++) {
-        for (uint8_t bit = 0; bit < 7; bit++) {
-
-            const bool dirty = (dirtyPixels[i] >> bit) & 1;       // Has pixel location been drawn to since full-refresh?
-            const bool shouldBeBlank = !((buffer[i] >> bit) & 1); // Is pixel location white in the new image?
+    // Outside the dirty region the panel keeps its image, and its ghosts, so we only count inside it
+    int32_t change = 0;
+    const Region &r = dirtyRegion;
+    const uint16_t lastPage = (r.y + r.h + 7) / 8;
+    for (uint16_t page = r.y / 8; r.w && page < lastPage; page++) {
+        for (uint16_t x = r.x; x < r.x + r.w; x++) {
+            const uint16_t i = x + page * displayWidth;
 
             // If pixel is (or has been) black since last full-refresh, and now is white: ghosting
-            if (dirty && shouldBeBlank)
-                ghostPixelCount++;
+            change += __builtin_popcount(dirtyPixels[i] & ~buffer[i]);
+            change -= __builtin_popcount(dirtyPixels[i] & ~previousBuffer[i]);
 
-            // Update the dirty status for this pixel - will this location become a ghost if set white in future?
-            if (!dirty && !shouldBeBlank)
-                dirtyPixels[i] |= (1 << bit);
+            // Will these locations become ghosts if set white in future?
+            if (apply)
+                dirtyPixels[i] |= buffer[i];
         }
     }
-
-    LOG_DEBUG("ghostPixels=%hu, ", ghostPixelCount);
+    return change;
 }
 
 // Check if ghost pixel count exceeds the defined limit
@@ -433,10 +487,11 @@ void EInkDynamicDisplay::checkExcessiveGhosting()
     if (refresh != UNSPECIFIED)
         return;
 
-    countGhostPixels();
+    const int32_t ghosts = ghostPixelCount + countGhostPixels(false);
+    LOG_DEBUG("ghostPixels=%d, ", ghosts);
 
     // If too many ghost pixels, select full refresh
-    if (ghostPixelCount > EINK_LIMIT_GHOSTING_PX) {
+    if (ghosts > EINK_LIMIT_GHOSTING_PX) {
         refresh = FULL;
         reason = EXCEEDED_GHOSTINGLIMIT;
         LOG_DEBUG("refresh=FULL, reason=EXCEEDED_GHOSTINGLIMIT, frameFlags=0x%x\n", frameFlags);
@@ -448,6 +503,7 @@ void EInkDynamicDisplay::resetGhostPixelTracking()
 {
     // Copy the current frame into dirtyPixels[] from the display buffer
     memcpy(dirtyPixels, EInkDisplay::buffer, EInkDisplay::displayBufferSize);
+    ghostPixelCount = 0;
 }
 #endif // EINK_LIMIT_GHOSTING_PX
 
@@ -473,8 +529,10 @@ void EInkDynamicDisplay::joinAsyncRefresh()
     LOG_DEBUG("Joining an async refresh in progress\n");
 
     // Continually poll the BUSY pin
+    uint32_t start = millis();
     while (adafruitDisplay->epd2.isBusy())
         yield();
+    refreshStats.awaitMsec += millis() - start;
 
     // If asyncRefreshRunning flag is still set, but display's BUSY pin reports the refresh is done
     adafruitDisplay->endAsyncFull(); // Run the end of nextPage() code
@@ -544,8 +602,10 @@ void EInkDynamicDisplay::checkBusyAsyncRefresh()
 void EInkDynamicDisplay::awaitRefresh()
 {
     // Continually poll the BUSY pin
+    uint32_t start = millis();
     while (adafruitDisplay->epd2.isBusy())
         yield();
+    refreshStats.awaitMsec += millis() - start;
 
     // End the full-refresh process
     adafruitDisplay->endAsyncFull(); // Run the end of nextPage() code
@@ -8,6 +8,20 @@
 #include "GxEPD2_BW.h"
 #include "concurrency/NotifiedWorkerThread.h"
 
+// A fast refresh only updates the part of the panel that changed, if that is no more than this percentage of the screen
+#ifndef EINK_PARTIAL_WINDOW_PERCENT
+#define EINK_PARTIAL_WINDOW_PERCENT 50
+#endif
+
+// How much of the panel we have refreshed, and how long we have waited for it
+struct EInkRefreshStats {
+    uint32_t fullRefreshes;
+    uint32_t fastRefreshes;
+    uint32_t partialWindows;  // fast refreshes of just the changed region
+    uint64_t pixelsRefreshed; // area of every refresh, added up
+    uint32_t awaitMsec;       // time blocked in awaitRefresh() and joinAsyncRefresh()
+};
+
 /*
     Derives from the EInkDisplay adapter class.
     Accepts suggestions from Screen class about frame type.
@@ -37,6 +51,8 @@ class EInkDynamicDisplay : public EInkDisplay, protected concurrency::NotifiedWo
     void display() override;
     bool forceDisplay(uint32_t msecLimit) override; // Shadows base class. Parameter and return val unused.
 
+    const EInkRefreshStats &getRefreshStats() const { return refreshStats; }
+
   protected:
     enum refreshTypes : uint8_t { // Which refresh operation will be used
         UNSPECIFIED,
@@ -69,7 +85,7 @@ class EInkDynamicDisplay : public EInkDisplay, protected concurrency::NotifiedWo
     const uint32_t intervalPollAsyncRefresh = 100;
 
     void onNotify(uint32_t notification) override; // Handle any async tasks - overrides NotifiedWorkerThread
-    void configForFastRefresh();                   // GxEPD2 code to set fast-refresh
+    void configForFastRefresh();                   // GxEPD2 code to set fast-refresh, of just the dirty region if small
     void configForFullRefresh();                   // GxEPD2 code to set full-refresh
     bool determineMode();                          // Assess situation, pick a refresh type
     void applyRefreshMode();                       // Run any relevant GxEPD2 code, so next update will use correct refresh type
@@ -88,7 +104,7 @@ class EInkDynamicDisplay : public EInkDisplay, protected concurrency::NotifiedWo
     void checkFastRequested();            // Was the flag set for RESPONSIVE, or only BACKGROUND?
 
     void resetRateLimiting(); // Set previousRunMs - this now counts as an update, for rate-limiting
-    void hashImage();         // Generate a hashed version of this frame, to compare against previous update
+    void findDirtyRegion();   // Compare this frame with the one on the panel, find the rectangle that changed
     void storeAndReset();     // Keep results of determineMode() for later, tidy-up for next call
 
     // What we are determining for this frame
@@ -101,21 +117,29 @@ class EInkDynamicDisplay : public EInkDisplay, protected concurrency::NotifiedWo
     refreshTypes previousRefresh = UNSPECIFIED;     // (Previous) Outcome
     reasonTypes previousReason = NO_OBJECTIONS;     // (Previous) Reason
 
+    // Part of the frame that differs from what is on the panel, in buffer coordinates (empty if w == 0)
+    struct Region {
+        uint16_t x, y, w, h;
+    };
+
     bool initialized = false;          // Have we drawn at least one frame yet?
     uint32_t previousRunMs = -1;       // When did determineMode() last run (rather than rejecting for rate-limiting)
-    uint32_t imageHash = 0;            // Hash of the current frame. Don't bother updating if nothing has changed!
-    uint32_t previousImageHash = 0;    // Hash of the previous update's frame
+    uint8_t *previousBuffer;           // The frame on the panel now (dynamically allocated mem)
+    bool redrawAll = true;             // Panel was cleared, treat the whole frame as dirty
+    Region dirtyRegion = {};           // What changed since previousBuffer. Don't bother updating if nothing has changed!
+    uint32_t refreshArea = 0;          // Pixels the refresh for this frame covers
     uint32_t fastRefreshCount = 0;     // How many fast-refreshes consecutively since last full refresh?
     refreshTypes currentConfig = FULL; // Which refresh type is GxEPD2 currently configured for
+    EInkRefreshStats refreshStats = {};
 
     // Optional - track ghosting, pixel by pixel
     // May 2024: no longer used by any display. Kept for possible future use.
 #ifdef EINK_LIMIT_GHOSTING_PX
-    void countGhostPixels();        // Count any pixels which have moved from black to white since last full-refresh
-    void checkExcessiveGhosting();  // Check if ghosting exceeds defined limit
-    void resetGhostPixelTracking(); // Clear the dirty pixels array. Call when full-refresh cleans the display.
-    uint8_t *dirtyPixels;           // Any pixels that have been black since last full-refresh (dynamically allocated mem)
-    uint32_t ghostPixelCount = 0;   // Number of pixels with problematic ghosting. Retained here for LOG_DEBUG use
+    int32_t countGhostPixels(bool apply); // Change in ghost pixels within the dirty region. If apply, mark its pixels dirty
+    void checkExcessiveGhosting();        // Check if ghosting exceeds defined limit
+    void resetGhostPixelTracking();       // Clear the dirty pixels array. Call when full-refresh cleans the display.
+    uint8_t *dirtyPixels;                 // Any pixels that have been black since last full-refresh (dynamically allocated mem)
+    uint32_t ghostPixelCount = 0;         // Number of pixels showing ghosting now, kept up to date region by region
 #endif
 
     // Conditional - async full refresh - only with modified meshtastic/GxEPD2
@@ -515,6 +515,7 @@ static LGFX *tft = nullptr;
 #include "SPILock.h"
 #include "TFTDisplay.h"
 #include <SPI.h>
+#include <algorithm>
 
 #ifdef UNPHONE
 #include "unPhone.h"
@@ -538,37 +539,66 @@ TFTDisplay::TFTDisplay(uint8_t address, int sda, int scl, OLEDDISPLAY_GEOMETRY g
 #endif
 }
 
+/// One page (8 rows) of the screen as RGB565, what display() pushes to the TFT for each run of changed columns
+static uint16_t *pagePixels = nullptr;
+
 // Write the buffer to the display memory
 void TFTDisplay::display(bool fromBlank)
 {
-    if (fromBlank)
-        tft->fillScreen(TFT_BLACK);
-    // tft->clear();
-    concurrency::LockGuard g(spiLock);
-
-    uint16_t x, y;
-
-    for (y = 0; y < displayHeight; y++) {
-        for (x = 0; x < displayWidth; x++) {
-            auto isset = buffer[x + (y / 8) * displayWidth] & (1 << (y & 7));
-            if (!fromBlank) {
-                // get src pixel in the page based ordering the OLED lib uses FIXME, super inefficent
-                auto dblbuf_isset = buffer_back[x + (y / 8) * displayWidth] & (1 << (y & 7));
-                if (isset != dblbuf_isset) {
-                    tft->drawPixel(x, y, isset ? TFT_MESH : TFT_BLACK);
-                }
-            } else if (isset) {
-                tft->drawPixel(x, y, TFT_MESH);
+    uint32_t start = micros(), lockMicros = 0, maxLockMicros = 0;
+
+    if (!pagePixels)
+        pagePixels = new uint16_t[displayWidth * 8];
+
+    // The OLED lib keeps the screen as pages of 8 rows, one byte per column, so a byte that differs from buffer_back is 8
+    // pixels to redraw.  Each run of changed columns in a page goes out as a single window write (not a drawPixel for every
+    // pixel) and we only hold spiLock while it is being sent, so the radio can get in between runs.
+    uint16_t pages = std::min((displayHeight + 7) / 8, displayBufferSize / displayWidth);
+    for (uint16_t page = 0; page < pages; page++) {
+        const uint8_t *src = buffer + page * displayWidth;
+        uint8_t *back = buffer_back + page * displayWidth;
+        uint16_t y = page * 8, rows = std::min(8, displayHeight - y);
+
+        uint16_t x = 0;
+        while (x < displayWidth) {
+            if (!fromBlank && src[x] == back[x]) {
+                x++;
+                continue;
             }
+            uint16_t first = x;
+            while (x < displayWidth && (fromBlank || src[x] != back[x]))
+                x++;
+            uint16_t width = x - first;
+
+            uint16_t *p = pagePixels;
+            for (uint16_t row = 0; row < rows; row++)
+                for (uint16_t col = first; col < x; col++)
+                    *p++ = (src[col] & (1 << row)) ? TFT_MESH : TFT_BLACK;
+            memcpy(back + first, src + first, width);
+
+            uint32_t lockStart = micros();
+            {
+                concurrency::LockGuard g(spiLock);
+                tft->pushImage(first, y, width, rows, pagePixels);
+            }
+            uint32_t held = micros() - lockStart;
+            lockMicros += held;
+            maxLockMicros = std::max(maxLockMicros, held);
         }
     }
-    // Copy the Buffer to the Back Buffer
-    for (y = 0; y < (displayHeight / 8); y++) {
-        for (x = 0; x < displayWidth; x++) {
-            uint16_t pos = x + y * displayWidth;
-            buffer_back[pos] = buffer[pos];
-        }
-    }
+
+    uint32_t elapsed = micros() - start;
+    stats.frames++;
+    stats.totalMicros += elapsed;
+    stats.maxMicros = std::max(stats.maxMicros, elapsed);
+    stats.lockMicros += lockMicros;
+    stats.maxLockMicros = std::max(stats.maxLockMicros, maxLockMicros);
+#ifdef DEBUG_TFT
+    if (stats.frames % 100 == 0)
+        LOG_DEBUG("TFT: %u frames, average %u us (max %u us), spiLock held %u us per frame (max %u us at a time)\n",
+                  stats.frames, stats.totalMicros / stats.frames, stats.maxMicros, stats.lockMicros / stats.frames,
+                  stats.maxLockMicros);
+#endif
 }
 
 // Send a command to the display (low level function)
@@ -732,12 +762,12 @@ bool TFTDisplay::connect()
 #endif
 
     tft->init();
+    tft->setSwapBytes(true); // display() pushes pixels as native RGB565 values
 
 #if defined(M5STACK)
     tft->setRotation(0);
 #elif defined(RAK14014)
     tft->setRotation(1);
-    tft->setSwapBytes(true);
     //    tft->fillScreen(TFT_BLACK);
     ft6336u.begin();
     pinMode(SCREEN_TOUCH_INT, INPUT_PULLUP);
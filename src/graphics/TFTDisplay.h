@@ -2,11 +2,19 @@
 
 #include <OLEDDisplay.h>
 
+/// How long display() takes and how long it holds spiLock (which the radio needs too)
+struct TFTDisplayStats {
+    uint32_t frames;
+    uint32_t totalMicros;
+    uint32_t maxMicros;
+    uint32_t lockMicros;    // total time spiLock was held
+    uint32_t maxLockMicros; // longest we held it at once
+};
+
 /**
  * An adapter class that allows using the LovyanGFX library as if it was an OLEDDisplay implementation.
  *
  * Remaining TODO:
- * optimize display() to only draw changed pixels (see other OLED subclasses for examples)
  * Use the fast NRF52 SPI API rather than the slow standard arduino version
  *
  * turn radio back on - currently with both on spi bus is fucked? or are we leaving chip select asserted?
@@ -39,6 +47,8 @@ class TFTDisplay : public OLEDDisplay
      */
     void setDetected(uint8_t detected);
 
+    const TFTDisplayStats &getStats() const { return stats; }
+
   protected:
     // the header size of the buffer used, e.g. for the SPI command header
     virtual int getBufferOffset(void) override { return 0; }
@@ -48,4 +58,7 @@ class TFTDisplay : public OLEDDisplay
 
     // Connect to the display
     virtual bool connect() override;
+
+  private:
+    TFTDisplayStats stats = {};
 };
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include "CryptoEngine.h"
 #include "Default.h"
 #include "DisplayFormatters.h"
+#include "MeshModule.h"
 #include "NodeDB.h"
 #include "RadioInterface.h"
 #include "configuration.h"
@@ -197,13 +198,11 @@ CryptoKey Channels::getKey(ChannelIndex chIndex)
  */
 int16_t Channels::setCrypto(ChannelIndex chIndex)
 {
-    CryptoKey k = getKey(chIndex);
-
-    if (k.length < 0)
+    // The hash is only invalid if the key is, and the engine already has the key schedule from onConfigChanged
+    if (chIndex >= getNumChannels() || getHash(chIndex) < 0)
         return -1;
     else {
-        // Tell our crypto engine about the psk
-        crypto->setKey(k);
+        crypto->useChannelKey(chIndex);
         return getHash(chIndex);
     }
 }
@@ -225,6 +224,21 @@ void Channels::onConfigChanged()
         if (ch.role == meshtastic_Channel_Role_PRIMARY)
             primaryIndex = i;
     }
+
+    // Now that primaryIndex is known (secondary channels without a PSK borrow its key), expand each channel's key once here
+    // rather than for every packet
+    static_assert(MAX_NUM_CHANNELS <= 8, "channelsByHash holds one bit per channel");
+    memset(channelsByHash, 0, sizeof(channelsByHash));
+    for (int i = 0; i < channelFile.channels_count; i++) {
+        hashes[i] = generateHash(i);
+        crypto->setChannelKey(i, getKey(i));
+        if (hashes[i] >= 0)
+            channelsByHash[hashes[i]] |= 1 << i;
+    }
+
+    // Channel names may have changed, modules bound to a channel look theirs up again
+    MeshModule::onChannelsChanged();
+
 #if !MESHTASTIC_EXCLUDE_MQTT
     if (channels.anyMqttEnabled() && mqtt && !mqtt->isEnabled()) {
         LOG_DEBUG("MQTT is enabled on at least one channel, so set MQTT thread to run immediately\n");
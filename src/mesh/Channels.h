@@ -28,6 +28,12 @@ class Channels
     /// the precomputed hashes for each of our channels, or -1 for invalid
     int16_t hashes[MAX_NUM_CHANNELS] = {};
 
+    /// for each possible channel hash, a bitmask of the channels which have that hash (rebuilt by onConfigChanged)
+    uint8_t channelsByHash[256] = {};
+
+    /// how many times a channel's key was tried on a packet with a matching hash but the result didn't decode
+    uint32_t wastedDecrypts[MAX_NUM_CHANNELS] = {};
+
   public:
     Channels() {}
 
@@ -75,6 +81,17 @@ class Channels
      */
     bool decryptForHash(ChannelIndex chIndex, ChannelHash channelHash);
 
+    /** Return a bitmask (bit n set for channel index n) of the channels that could have sent a packet with this hash
+     *
+     * Lets inbound packet decoding skip straight to the candidate channels instead of checking every channel
+     */
+    uint8_t getChannelsForHash(ChannelHash channelHash) const { return channelsByHash[channelHash]; }
+
+    /// Note that decrypting a packet with this channel's key gave garbage, i.e. its hash collided with the real sender's channel
+    void countWastedDecrypt(ChannelIndex chIndex) { wastedDecrypts[chIndex]++; }
+
+    uint32_t getWastedDecrypts(ChannelIndex chIndex) const { return wastedDecrypts[chIndex]; }
+
     /** Given a channel index setup crypto for encoding that channel (or the primary channel if that channel is unsecured)
      *
      * This method is called before encoding outbound packets
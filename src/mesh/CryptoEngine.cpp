@@ -21,6 +21,7 @@ void CryptoEngine::generateKeyPair(uint8_t *pubKey, uint8_t *privKey)
 {
     LOG_DEBUG("Generating Curve25519 key pair...\n");
     Curve25519::dh1(public_key, private_key);
+    clearDHKeyCache(); // all our shared secrets depended on the old private key
     memcpy(pubKey, public_key, sizeof(public_key));
     memcpy(privKey, private_key, sizeof(private_key));
 }
@@ -29,6 +30,7 @@ void CryptoEngine::clearKeys()
 {
     memset(public_key, 0, sizeof(public_key));
     memset(private_key, 0, sizeof(private_key));
+    clearDHKeyCache();
 }
 
 /**
@@ -98,6 +100,8 @@ bool CryptoEngine::decryptCurve25519(uint32_t fromNode, uint64_t packetNum, size
 
 void CryptoEngine::setDHPrivateKey(uint8_t *_private_key)
 {
+    if (memcmp(private_key, _private_key, 32) != 0)
+        clearDHKeyCache(); // all our shared secrets depended on the old private key
     memcpy(private_key, _private_key, 32);
 }
 /**
@@ -113,7 +117,28 @@ bool CryptoEngine::setDHKey(uint32_t nodeNum)
         return false;
     }
 
-    if (!setDHPublicKey(node->user.public_key.bytes))
+    return setDHKey(nodeNum, node->user.public_key.bytes);
+}
+
+bool CryptoEngine::setDHKey(uint32_t nodeNum, const uint8_t *publicKey)
+{
+    DHKeyCacheEntry *victim = &dhKeyCache[0];
+    for (int i = 0; i < DH_KEY_CACHE_SIZE; i++) {
+        DHKeyCacheEntry &e = dhKeyCache[i];
+        if (e.nodeNum == nodeNum && memcmp(e.publicKey, publicKey, 32) == 0) {
+            dhKeyCacheHits++;
+            e.lastUsed = ++dhKeyCacheClock;
+            memcpy(shared_key, e.sharedKey, 32);
+            return true;
+        }
+        if (e.nodeNum == 0 || (victim->nodeNum != 0 && e.lastUsed < victim->lastUsed))
+            victim = &e; // prefer a free slot, otherwise the least recently used one
+    }
+    dhKeyCacheMisses++;
+
+    uint8_t pubKey[32];
+    memcpy(pubKey, publicKey, 32);
+    if (!setDHPublicKey(pubKey))
         return false;
 
     printBytes("DH Output: ", shared_key, 32);
@@ -129,9 +154,22 @@ bool CryptoEngine::setDHKey(uint32_t nodeNum)
      * it around as needed.
      */
     crypto->hash(shared_key, 32);
+
+    victim->nodeNum = nodeNum;
+    memcpy(victim->publicKey, publicKey, 32);
+    memcpy(victim->sharedKey, shared_key, 32);
+    victim->lastUsed = ++dhKeyCacheClock;
     return true;
 }
 
+void CryptoEngine::clearDHKeyCache(uint32_t nodeNum)
+{
+    for (int i = 0; i < DH_KEY_CACHE_SIZE; i++) {
+        if (nodeNum == 0 || dhKeyCache[i].nodeNum == nodeNum)
+            memset(&dhKeyCache[i], 0, sizeof(dhKeyCache[i]));
+    }
+}
+
 /**
  * Hash arbitrary data using SHA256.
  *
@@ -192,6 +230,33 @@ void CryptoEngine::setKey(const CryptoKey &k)
 {
     LOG_DEBUG("Using AES%d key!\n", k.length * 8);
     key = k;
+    keyChannel = -1;
+}
+
+void CryptoEngine::setChannelKey(uint8_t chIndex, const CryptoKey &k)
+{
+    assert(chIndex < MAX_NUM_CHANNELS);
+    channelKeys[chIndex] = k;
+
+    if (channelCtr[chIndex]) {
+        delete channelCtr[chIndex];
+        channelCtr[chIndex] = nullptr;
+    }
+    if (k.length > 0) {
+        if (k.length == 16)
+            channelCtr[chIndex] = new CTR<AES128>();
+        else
+            channelCtr[chIndex] = new CTR<AES256>();
+        channelCtr[chIndex]->setKey(k.bytes, k.length);
+        channelCtr[chIndex]->setCounterSize(4);
+    }
+}
+
+void CryptoEngine::useChannelKey(uint8_t chIndex)
+{
+    assert(chIndex < MAX_NUM_CHANNELS);
+    key = channelKeys[chIndex];
+    keyChannel = chIndex;
 }
 
 /**
@@ -204,7 +269,10 @@ void CryptoEngine::encryptPacket(uint32_t fromNode, uint64_t packetId, size_t nu
     if (key.length > 0) {
         initNonce(fromNode, packetId);
         if (numBytes <= MAX_BLOCKSIZE) {
-            encryptAESCtr(key, nonce, numBytes, bytes);
+            if (keyChannel >= 0)
+                encryptChannelAESCtr(keyChannel, nonce, numBytes, bytes);
+            else
+                encryptAESCtr(key, nonce, numBytes, bytes);
         } else {
             LOG_ERROR("Packet too large for crypto engine: %d. noop encryption!\n", numBytes);
         }
@@ -229,14 +297,18 @@ void CryptoEngine::encryptAESCtr(CryptoKey _key, uint8_t *_nonce, size_t numByte
     else
         ctr = new CTR<AES256>();
     ctr->setKey(_key.bytes, _key.length);
-    static uint8_t scratch[MAX_BLOCKSIZE];
-    memcpy(scratch, bytes, numBytes);
-    memset(scratch + numBytes, 0,
-           sizeof(scratch) - numBytes); // Fill rest of buffer with zero (in case cypher looks at it)
-
     ctr->setIV(_nonce, 16);
     ctr->setCounterSize(4);
-    ctr->encrypt(bytes, scratch, numBytes);
+    ctr->encrypt(bytes, bytes, numBytes); // CTR only XORs the keystream into the data, so this is safe in place
+}
+
+void CryptoEngine::encryptChannelAESCtr(uint8_t chIndex, uint8_t *_nonce, size_t numBytes, uint8_t *bytes)
+{
+    CTRCommon *c = channelCtr[chIndex];
+    if (c) {
+        c->setIV(_nonce, 16); // Only resets the counter, the key schedule was done by setChannelKey
+        c->encrypt(bytes, bytes, numBytes);
+    }
 }
 
 /**
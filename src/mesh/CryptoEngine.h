@@ -22,6 +22,24 @@ struct CryptoKey {
 
 #define MAX_BLOCKSIZE 256
 
+#if !(MESHTASTIC_EXCLUDE_PKI)
+/// How many peers we remember the (hashed) Curve25519 shared secret for
+#ifndef DH_KEY_CACHE_SIZE
+#define DH_KEY_CACHE_SIZE 8
+#endif
+
+/**
+ * A hashed shared secret, remembered so we don't redo the scalar multiplication for every PKI packet.
+ * The peer's public key is part of the entry, so a peer changing keys can never pick up a stale secret.
+ */
+struct DHKeyCacheEntry {
+    uint32_t nodeNum; // 0 means unused
+    uint8_t publicKey[32];
+    uint8_t sharedKey[32];
+    uint32_t lastUsed; // value of dhKeyCacheClock when this entry was last hit, for LRU replacement
+};
+#endif
+
 class CryptoEngine
 {
   public:
@@ -40,7 +58,13 @@ class CryptoEngine
                                    uint8_t *bytesOut);
     virtual bool decryptCurve25519(uint32_t fromNode, uint64_t packetNum, size_t numBytes, uint8_t *bytes, uint8_t *bytesOut);
     bool setDHKey(uint32_t nodeNum);
+    /// Set shared_key to the hashed shared secret for nodeNum, using our cache if we've talked to them with this key before
+    bool setDHKey(uint32_t nodeNum, const uint8_t *publicKey);
     virtual bool setDHPublicKey(uint8_t *publicKey);
+    /// Forget any cached shared secret for nodeNum, or for all peers if nodeNum is 0
+    void clearDHKeyCache(uint32_t nodeNum = 0);
+    uint32_t getDHKeyCacheHits() const { return dhKeyCacheHits; }
+    uint32_t getDHKeyCacheMisses() const { return dhKeyCacheMisses; }
     virtual void hash(uint8_t *bytes, size_t numBytes);
 
     virtual void aesSetKey(const uint8_t *key, size_t key_len);
@@ -61,6 +85,18 @@ class CryptoEngine
      */
     virtual void setKey(const CryptoKey &k);
 
+    /**
+     * Remember the key for a channel and expand its key schedule now, so packets on that channel don't have to.
+     *
+     * Called by Channels whenever the channel config changes.
+     */
+    virtual void setChannelKey(uint8_t chIndex, const CryptoKey &k);
+
+    /**
+     * Use the key previously given to setChannelKey() for the following encryptPacket()/decrypt() calls
+     */
+    void useChannelKey(uint8_t chIndex);
+
     /**
      * Encrypt a packet
      *
@@ -69,6 +105,8 @@ class CryptoEngine
     virtual void encryptPacket(uint32_t fromNode, uint64_t packetId, size_t numBytes, uint8_t *bytes);
     virtual void decrypt(uint32_t fromNode, uint64_t packetId, size_t numBytes, uint8_t *bytes);
     virtual void encryptAESCtr(CryptoKey key, uint8_t *nonce, size_t numBytes, uint8_t *bytes);
+    /// Like encryptAESCtr(), but using the precomputed key schedule for a channel (see setChannelKey)
+    virtual void encryptChannelAESCtr(uint8_t chIndex, uint8_t *nonce, size_t numBytes, uint8_t *bytes);
 #ifndef PIO_UNIT_TESTING
   protected:
 #endif
@@ -76,9 +114,17 @@ class CryptoEngine
     uint8_t nonce[16] = {0};
     CryptoKey key = {};
     CTRCommon *ctr = NULL;
+    /// The channel whose key is in use, or -1 if the key was set directly with setKey()
+    int8_t keyChannel = -1;
+    CryptoKey channelKeys[MAX_NUM_CHANNELS] = {};
+    /// Expanded key schedules for each channel, only used by engines that don't override setChannelKey
+    CTRCommon *channelCtr[MAX_NUM_CHANNELS] = {};
 #if !(MESHTASTIC_EXCLUDE_PKI)
     uint8_t shared_key[32] = {0};
     uint8_t private_key[32] = {0};
+
+    DHKeyCacheEntry dhKeyCache[DH_KEY_CACHE_SIZE] = {};
+    uint32_t dhKeyCacheClock = 0, dhKeyCacheHits = 0, dhKeyCacheMisses = 0;
 #endif
     /**
      * Init our 128 bit nonce for a new packet
@@ -0,0 +1,58 @@
+#include "DecodeCache.h"
+
+#include <string.h>
+
+DecodeCache decodeCache;
+
+DecodeCache::DecodeCache()
+{
+    memset(entries, 0, sizeof(entries));
+}
+
+DecodeCache::~DecodeCache()
+{
+    for (int i = 0; i < NUM_ENTRIES; i++)
+        delete[] entries[i].decoded;
+}
+
+bool DecodeCache::decode(const meshtastic_MeshPacket &mp, const pb_msgdesc_t *fields, void *dest, size_t destSize)
+{
+    auto &p = mp.decoded;
+    useCounter++;
+
+    Entry *victim = &entries[0];
+    for (int i = 0; i < NUM_ENTRIES; i++) {
+        Entry &e = entries[i];
+        if (e.fields == fields && e.portnum == p.portnum && e.decodedSize == destSize && e.payload.size == p.payload.size &&
+            memcmp(e.payload.bytes, p.payload.bytes, p.payload.size) == 0) {
+            // Each consumer gets its own copy, handlers are allowed to scribble on what we give them
+            if (e.ok)
+                memcpy(dest, e.decoded, destSize);
+            e.lastUsed = useCounter;
+            stats.hits++;
+            return e.ok;
+        }
+        if (e.lastUsed < victim->lastUsed)
+            victim = &e;
+    }
+
+    stats.decodes++;
+    memset(dest, 0, destSize);
+    bool ok = pb_decode_from_bytes(p.payload.bytes, p.payload.size, fields, dest);
+
+    if (victim->capacity < destSize) {
+        delete[] victim->decoded;
+        victim->decoded = new uint8_t[destSize];
+        victim->capacity = destSize;
+    }
+    victim->fields = fields;
+    victim->portnum = p.portnum;
+    victim->ok = ok;
+    victim->payload.size = p.payload.size;
+    memcpy(victim->payload.bytes, p.payload.bytes, p.payload.size);
+    if (ok)
+        memcpy(victim->decoded, dest, destSize);
+    victim->decodedSize = destSize;
+    victim->lastUsed = useCounter;
+    return ok;
+}
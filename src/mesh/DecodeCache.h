@@ -0,0 +1,56 @@
+#pragma once
+
+#include "MeshTypes.h"
+#include "mesh-pb-constants.h"
+
+/// Counters showing how much decoding the cache saved
+struct DecodeCacheStats {
+    uint32_t decodes; // payloads we actually ran through pb_decode
+    uint32_t hits;    // decodes answered from the cache
+};
+
+/**
+ * The same received payload gets decoded by several consumers in turn: handleReceived and alterReceived of every
+ * ProtobufModule for the port, then MQTT's JSON output.  This remembers the last few decoded payloads, so only the first
+ * consumer pays for pb_decode and the rest get a copy of the result.
+ *
+ * Entries are matched on port, message type and the exact payload bytes, so a module that rewrites the payload (e.g.
+ * alterReceived in TraceRouteModule) just causes a fresh decode.  Only for use from the main thread.
+ */
+class DecodeCache
+{
+  public:
+    DecodeCache();
+    ~DecodeCache();
+
+    /// Decode the payload of mp as 'fields' into dest (destSize bytes), returns false if it doesn't decode
+    bool decode(const meshtastic_MeshPacket &mp, const pb_msgdesc_t *fields, void *dest, size_t destSize);
+
+    template <class T> bool decode(const meshtastic_MeshPacket &mp, const pb_msgdesc_t *fields, T *dest)
+    {
+        return decode(mp, fields, dest, sizeof(T));
+    }
+
+    const DecodeCacheStats &getStats() const { return stats; }
+
+  private:
+    static const int NUM_ENTRIES = 2;
+
+    struct Entry {
+        const pb_msgdesc_t *fields;
+        meshtastic_PortNum portnum;
+        bool ok;
+        meshtastic_Data_payload_t payload;
+        uint8_t *decoded;   // the decoded struct
+        size_t decodedSize; // bytes of it we have filled
+        size_t capacity;    // bytes allocated for it
+        uint32_t lastUsed;
+    };
+
+    Entry entries[NUM_ENTRIES];
+    uint32_t useCounter = 0;
+
+    DecodeCacheStats stats = {};
+};
+
+extern DecodeCache decodeCache;
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "MeshTypes.h"
+
+/// What we look packets up by: the node that sent them and the id it gave them
+struct PacketKey {
+    NodeNum from;
+    PacketId id;
+};
+
+/**
+ * An open addressed (linear probing) hash table from a packet's (from, id) to a uint16_t reference - usually the index of a
+ * slot in some array of records the owner keeps.
+ *
+ * Only the references are stored, so lookups and deletes take a 'keyOf' function mapping a reference back to the PacketKey it
+ * was inserted with.  The table is kept at most half full so probe sequences stay short, and it only allocates in resize().
+ */
+class IdHashTable
+{
+  public:
+    /// Marks an empty bucket, and is what the lookups return when there is no match
+    static const uint16_t NONE = UINT16_MAX;
+
+    IdHashTable() {}
+
+    ~IdHashTable() { delete[] buckets; }
+
+    IdHashTable(const IdHashTable &) = delete;
+    IdHashTable &operator=(const IdHashTable &) = delete;
+
+    /// Drop all entries and make room for up to maxEntries of them (which must be less than NONE)
+    void resize(size_t maxEntries)
+    {
+        size_t n = 1;
+        while (n < 2 * maxEntries)
+            n <<= 1;
+
+        delete[] buckets;
+        buckets = new uint16_t[n];
+        mask = n - 1;
+        for (size_t i = 0; i < n; i++)
+            buckets[i] = NONE;
+    }
+
+    /// Exchange contents with another table, so a bigger one can be filled and then swapped in
+    void swap(IdHashTable &other)
+    {
+        uint16_t *b = buckets;
+        buckets = other.buckets;
+        other.buckets = b;
+
+        uint16_t m = mask;
+        mask = other.mask;
+        other.mask = m;
+    }
+
+    /// The reference stored in a bucket returned by find()
+    uint16_t get(uint16_t bucket) const { return buckets[bucket]; }
+
+    void insert(uint16_t ref, NodeNum from, PacketId id)
+    {
+        uint16_t b = home(from, id);
+        while (buckets[b] != NONE)
+            b = (b + 1) & mask;
+        buckets[b] = ref;
+    }
+
+    /// Return the bucket of an entry with key (from, id), or NONE if there is none
+    template <typename KeyOf> uint16_t find(NodeNum from, PacketId id, KeyOf keyOf) const
+    {
+        for (uint16_t b = home(from, id); buckets[b] != NONE; b = (b + 1) & mask) {
+            PacketKey k = keyOf(buckets[b]);
+            if (k.from == from && k.id == id)
+                return b;
+        }
+        return NONE;
+    }
+
+    /// Return the bucket holding exactly 'ref' (inserted with key (from, id)), or NONE if it isn't in the table
+    uint16_t findRef(uint16_t ref, NodeNum from, PacketId id) const
+    {
+        for (uint16_t b = home(from, id); buckets[b] != NONE; b = (b + 1) & mask)
+            if (buckets[b] == ref)
+                return b;
+        return NONE;
+    }
+
+    /// Empty a bucket, shifting back any entries that probed past it so lookups still find them
+    template <typename KeyOf> void remove(uint16_t bucket, KeyOf keyOf)
+    {
+        uint16_t hole = bucket;
+        uint16_t next = (hole + 1) & mask;
+        while (buckets[next] != NONE) {
+            PacketKey k = keyOf(buckets[next]);
+            uint16_t h = home(k.from, k.id);
+
+            // Move the entry back into the hole unless its home bucket lies cyclically between the hole and where it is now
+            if (((next - h) & mask) >= ((next - hole) & mask)) {
+                buckets[hole] = buckets[next];
+                hole = next;
+            }
+            next = (next + 1) & mask;
+        }
+        buckets[hole] = NONE;
+    }
+
+    static uint32_t hash(NodeNum from, PacketId id)
+    {
+        // Packet ids from one sender are often sequential, so mix all the bits (murmur3 finalizer) rather than just XORing
+        uint32_t h = from * 0x9E3779B1u ^ id;
+        h ^= h >> 16;
+        h *= 0x85EBCA6Bu;
+        h ^= h >> 13;
+        h *= 0xC2B2AE35u;
+        h ^= h >> 16;
+        return h;
+    }
+
+  private:
+    uint16_t *buckets = NULL;
+    uint16_t mask = 0; // number of buckets - 1 (always a power of two)
+
+    uint16_t home(NodeNum from, PacketId id) const { return hash(from, id) & mask; }
+};
@@ -5,12 +5,23 @@
 
 #include "PointerQueue.h"
 
+/// Usage counters reported by allocators that track them
+struct AllocatorStats {
+    uint32_t capacity;  // number of objects in the fixed slab (0 for purely dynamic allocators)
+    uint32_t inUse;     // objects currently handed out from the slab
+    uint32_t highWater; // most objects ever handed out from the slab at once
+    uint32_t exhausted; // allocations that found the slab empty and had to fall back to the heap
+};
+
 template <class T> class Allocator
 {
 
   public:
     virtual ~Allocator() {}
 
+    /// Fill in usage counters, allocators which don't track them report all zeros
+    virtual void getStats(AllocatorStats &stats) { memset(&stats, 0, sizeof(stats)); }
+
     /// Return a queable object which has been prefilled with zeros.  Panic if no buffer is available
     /// Note: this method is safe to call from regular OR ISR code
     T *allocZeroed()
@@ -73,3 +84,78 @@ template <class T> class MemoryDynamic : public Allocator<T>
         return p;
     }
 };
+
+#ifdef HAS_FREE_RTOS
+/**
+ * A fixed capacity slab allocator.  All MaxElements objects live in one statically allocated block, free objects are kept in a
+ * FreeRTOS queue (which does the locking for us, across cores too).  If the slab ever runs dry we fall back to the heap rather
+ * than panicking, and count it so the pool can be sized properly.
+ *
+ * Only available with FreeRTOS, elsewhere the queue would be an unlocked std::queue - use MemoryDynamic there.
+ */
+template <class T, size_t MaxElements> class MemoryPool : public Allocator<T>
+{
+    PointerQueue<T> dead;
+
+    T buf[MaxElements]; // our large raw block of memory
+
+    volatile uint32_t highWater = 0, exhausted = 0;
+
+  public:
+    MemoryPool() : dead(MaxElements)
+    {
+        // prefill dead
+        for (size_t i = 0; i < MaxElements; i++)
+            release(&buf[i]);
+    }
+
+    /// Return a buffer for use by others
+    virtual void release(T *p) override
+    {
+        assert(p);
+        if (!isFromSlab(p)) {
+            free(p);
+            return;
+        }
+        bool ok = dead.enqueue(p, 0);
+        assert(ok); // the queue is sized to hold every slab entry, so this can only fail on a double free
+        (void)ok;
+    }
+
+    virtual void getStats(AllocatorStats &stats) override
+    {
+        stats.capacity = MaxElements;
+        stats.inUse = numInUse();
+        stats.highWater = highWater;
+        stats.exhausted = exhausted;
+    }
+
+  protected:
+    /// Alloc some storage, we never wait for a slab entry to be freed - if we are out we use the heap instead
+    virtual T *alloc(TickType_t maxWait) override
+    {
+        T *p = dead.dequeuePtr(0);
+        if (p) {
+            noteAlloc();
+            return p;
+        }
+
+        exhausted = exhausted + 1;
+        p = (T *)malloc(sizeof(T));
+        assert(p);
+        return p;
+    }
+
+  private:
+    bool isFromSlab(const T *p) const { return p >= buf && p < buf + MaxElements; }
+
+    uint32_t numInUse() { return MaxElements - dead.numUsed(); }
+
+    void noteAlloc()
+    {
+        uint32_t used = numInUse();
+        if (used > highWater)
+            highWater = used;
+    }
+};
+#endif
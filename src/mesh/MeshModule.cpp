@@ -8,6 +8,10 @@
 
 std::vector<MeshModule *> *MeshModule::modules;
 
+ModuleDispatch MeshModule::dispatch;
+bool MeshModule::dispatchDirty = true;
+bool MeshModule::boundChannelsDirty = true;
+
 const meshtastic_MeshPacket *MeshModule::currentRequest;
 
 /**
@@ -23,6 +27,8 @@ MeshModule::MeshModule(const char *_name) : name(_name)
         modules = new std::vector<MeshModule *>();
 
     modules->push_back(this);
+    dispatchDirty = true;
+    boundChannelsDirty = true;
 }
 
 void MeshModule::setup() {}
@@ -72,6 +78,31 @@ meshtastic_MeshPacket *MeshModule::allocErrorResponse(meshtastic_Routing_Error e
     return r;
 }
 
+void MeshModule::rebuildDispatch()
+{
+    dispatch.clear();
+    for (size_t i = 0; i < modules->size(); i++) {
+        auto &pi = *(*modules)[i];
+        dispatch.add(i, pi.getPortNums(), pi.encryptedOk);
+    }
+    dispatchDirty = false;
+}
+
+void MeshModule::resolveBoundChannels()
+{
+    static_assert(MAX_NUM_CHANNELS <= 8, "boundChannelMask holds one bit per channel");
+    for (auto pi : *modules) {
+        pi->boundChannelMask = 0;
+        if (!pi->boundChannel)
+            continue;
+        for (ChannelIndex i = 0; i < channels.getNumChannels(); i++) {
+            if (strcasecmp(channels.getByIndex(i).settings.name, pi->boundChannel) == 0)
+                pi->boundChannelMask |= 1 << i;
+        }
+    }
+    boundChannelsDirty = false;
+}
+
 void MeshModule::callModules(meshtastic_MeshPacket &mp, RxSource src)
 {
     // LOG_DEBUG("In call modules\n");
@@ -88,8 +119,17 @@ void MeshModule::callModules(meshtastic_MeshPacket &mp, RxSource src)
     auto ourNodeNum = nodeDB->getNodeNum();
     bool toUs = mp.to == NODENUM_BROADCAST || mp.to == ourNodeNum;
 
-    for (auto i = modules->begin(); i != modules->end(); ++i) {
-        auto &pi = **i;
+    if (dispatchDirty)
+        rebuildDispatch();
+    if (boundChannelsDirty)
+        resolveBoundChannels();
+
+    // Only the modules registered for this portnum (and the few that look at everything) need to be asked.  Note: this is
+    // decided by the portnum the packet arrived with, even if a module's alterReceived() changes it.
+    ModuleDispatch::Cursor cursor = isDecoded ? dispatch.lookup(mp.decoded.portnum) : dispatch.lookupEncrypted();
+    uint16_t index;
+    while (cursor.next(index)) {
+        auto &pi = *(*modules)[index];
 
         pi.currentRequest = &mp;
 
@@ -108,16 +148,14 @@ void MeshModule::callModules(meshtastic_MeshPacket &mp, RxSource src)
 
             moduleFound = true;
 
-            /// received channel (or NULL if not decoded)
-            meshtastic_Channel *ch = isDecoded ? &channels.getByIndex(mp.channel) : NULL;
-
             /// Is the channel this packet arrived on acceptable? (security check)
             /// Note: we can't know channel names for encrypted packets, so those are NEVER sent to boundChannel modules
 
             /// Also: if a packet comes in on the local PC interface, we don't check for bound channels, because it is TRUSTED and
             /// it needs to to be able to fetch the initial admin packets without yet knowing any channels.
 
-            bool rxChannelOk = !pi.boundChannel || (mp.from == 0) || (ch && strcasecmp(ch->settings.name, pi.boundChannel) == 0);
+            bool rxChannelOk = !pi.boundChannel || (mp.from == 0) ||
+                               (isDecoded && mp.channel < MAX_NUM_CHANNELS && (pi.boundChannelMask & (1 << mp.channel)));
 
             if (!rxChannelOk) {
                 // no one should have already replied!
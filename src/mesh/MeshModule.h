@@ -2,6 +2,7 @@
 
 #include "mesh/Channels.h"
 #include "mesh/MeshTypes.h"
+#include "mesh/ModuleDispatch.h"
 #include <vector>
 
 #if HAS_SCREEN
@@ -60,6 +61,13 @@ class MeshModule
 {
     static std::vector<MeshModule *> *modules;
 
+    /// Which modules want which portnums, rebuilt the first time a packet arrives after a module was added
+    static ModuleDispatch dispatch;
+    static bool dispatchDirty;
+
+    /// Set when channels or modules change, so boundChannelMask gets looked up again before the next packet
+    static bool boundChannelsDirty;
+
   public:
     /** Constructor
      * name is for debugging output
@@ -72,6 +80,9 @@ class MeshModule
      */
     static void callModules(meshtastic_MeshPacket &mp, RxSource src = RX_SRC_RADIO);
 
+    /// Called by Channels when the channel settings (and so possibly the channel names) have changed
+    static void onChannelsChanged() { boundChannelsDirty = true; }
+
     static std::vector<MeshModule *> GetMeshModulesWithUIFrames();
     static void observeUIEvents(Observer<const UIFrameEvent *> *observer);
     static AdminMessageHandleResult handleAdminMessageForAllModules(const meshtastic_MeshPacket &mp,
@@ -109,6 +120,9 @@ class MeshModule
      */
     const char *boundChannel = NULL;
 
+    /** The channel indices whose name matches boundChannel (one bit per channel), so we don't compare names per packet */
+    uint8_t boundChannelMask = 0;
+
     /**
      * If this module is currently handling a request currentRequest will be preset
      * to the packet with the request.  This is mostly useful for reply handlers.
@@ -134,6 +148,12 @@ class MeshModule
      */
     virtual bool wantPacket(const meshtastic_MeshPacket *p) = 0;
 
+    /**
+     * The portnums this module might want, so callModules only needs to ask wantPacket() about packets with those portnums.
+     * Return an empty list (the default) to be asked about every decoded packet.  Called once, before the first packet arrives.
+     */
+    virtual std::vector<meshtastic_PortNum> getPortNums() { return {}; }
+
     /** Called to handle a particular incoming message
 
     @return ProcessMessage::STOP if you've guaranteed you've handled this message and no other handlers should be considered for
@@ -210,6 +230,12 @@ class MeshModule
      * to generate the reply message, and if !NULL that message will be delivered to whoever sent req
      */
     void sendResponse(const meshtastic_MeshPacket &req);
+
+    /// Register every module's portnums in dispatch
+    static void rebuildDispatch();
+
+    /// Look up each module's boundChannel in the current channel settings
+    static void resolveBoundChannels();
 };
 
 /** set the destination and packet parameters of packet p intended as a reply to a particular "to" packet
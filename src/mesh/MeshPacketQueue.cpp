@@ -2,8 +2,6 @@
 #include "configuration.h"
 #include <assert.h>
 
-#include <algorithm>
-
 /// @return the priority of the specified packet
 inline uint32_t getPriority(const meshtastic_MeshPacket *p)
 {
@@ -11,7 +9,7 @@ inline uint32_t getPriority(const meshtastic_MeshPacket *p)
     return pri;
 }
 
-/// @return "true" if "p1" is ordered before "p2"
+/// @return "true" if "p1" is ordered before "p2" (i.e. "p1" is the less urgent packet)
 bool CompareMeshPacketFunc(const meshtastic_MeshPacket *p1, const meshtastic_MeshPacket *p2)
 {
     assert(p1 && p2);
@@ -20,15 +18,35 @@ bool CompareMeshPacketFunc(const meshtastic_MeshPacket *p1, const meshtastic_Mes
     // If priorities differ, use that
     // for equal priorities, order by id (older packets have higher priority - this will briefly be wrong when IDs roll over but
     // no big deal)
-    return (p1p != p2p) ? (p1p < p2p)         // prefer bigger priorities
-                        : (p1->id >= p2->id); // prefer smaller packet ids
+    return (p1p != p2p) ? (p1p < p2p)        // prefer bigger priorities
+                        : (p1->id > p2->id); // prefer smaller packet ids
+}
+
+MeshPacketQueue::MeshPacketQueue(size_t _maxLen) : maxLen(_maxLen)
+{
+    assert(maxLen > 0 && maxLen < IdHashTable::NONE);
+
+    slots = new Slot[maxLen];
+    freeSlots = new uint16_t[maxLen];
+    highHeap = new uint16_t[maxLen];
+    lowHeap = new uint16_t[maxLen];
+    index.resize(maxLen);
+
+    for (size_t i = 0; i < maxLen; i++)
+        freeSlots[i] = maxLen - 1 - i;
 }
 
-MeshPacketQueue::MeshPacketQueue(size_t _maxLen) : maxLen(_maxLen) {}
+MeshPacketQueue::~MeshPacketQueue()
+{
+    delete[] slots;
+    delete[] freeSlots;
+    delete[] highHeap;
+    delete[] lowHeap;
+}
 
 bool MeshPacketQueue::empty()
 {
-    return queue.empty();
+    return count == 0;
 }
 
 /**
@@ -47,18 +65,32 @@ void fixPriority(meshtastic_MeshPacket *p)
     }
 }
 
+MeshPacketQueuePriorityClass MeshPacketQueue::getPriorityClass(uint32_t pri)
+{
+    if (pri >= meshtastic_MeshPacket_Priority_MAX)
+        return QUEUE_PRI_MAX;
+    if (pri >= meshtastic_MeshPacket_Priority_ACK)
+        return QUEUE_PRI_ACK;
+    if (pri >= meshtastic_MeshPacket_Priority_RELIABLE)
+        return QUEUE_PRI_RELIABLE;
+    if (pri >= meshtastic_MeshPacket_Priority_DEFAULT)
+        return QUEUE_PRI_DEFAULT;
+    if (pri >= meshtastic_MeshPacket_Priority_BACKGROUND)
+        return QUEUE_PRI_BACKGROUND;
+    return QUEUE_PRI_MIN;
+}
+
 /** enqueue a packet, return false if full */
 bool MeshPacketQueue::enqueue(meshtastic_MeshPacket *p)
 {
     fixPriority(p);
 
     // no space - try to replace a lower priority packet in the queue
-    if (queue.size() >= maxLen) {
+    if (count >= maxLen) {
         return replaceLowerPriorityPacket(p);
     }
 
-    queue.push_back(p);
-    std::push_heap(queue.begin(), queue.end(), &CompareMeshPacketFunc);
+    insert(p);
     return true;
 }
 
@@ -68,11 +100,7 @@ meshtastic_MeshPacket *MeshPacketQueue::dequeue()
         return NULL;
     }
 
-    auto *p = queue.front();
-    std::pop_heap(queue.begin(), queue.end(), &CompareMeshPacketFunc);
-    queue.pop_back();
-
-    return p;
+    return removeSlot(highHeap[0]);
 }
 
 meshtastic_MeshPacket *MeshPacketQueue::getFront()
@@ -81,50 +109,139 @@ meshtastic_MeshPacket *MeshPacketQueue::getFront()
         return NULL;
     }
 
-    auto *p = queue.front();
-    return p;
+    return slots[highHeap[0]].p;
 }
 
 /** Attempt to find and remove a packet from this queue.  Returns a pointer to the removed packet, or NULL if not found */
 meshtastic_MeshPacket *MeshPacketQueue::remove(NodeNum from, PacketId id)
 {
-    for (auto it = queue.begin(); it != queue.end(); it++) {
-        auto p = (*it);
-        if (getFrom(p) == from && p->id == id) {
-            queue.erase(it);
-            std::make_heap(queue.begin(), queue.end(), &CompareMeshPacketFunc);
-            return p;
-        }
-    }
+    uint16_t bucket = index.find(from, id, [this](uint16_t slot) { return keyOf(slot); });
+    if (bucket == IdHashTable::NONE)
+        return NULL;
 
-    return NULL;
+    stats.cancelled++;
+    return removeSlot(index.get(bucket));
 }
 
 /** Attempt to find and remove a packet from this queue.  Returns the packet which was removed from the queue */
 bool MeshPacketQueue::replaceLowerPriorityPacket(meshtastic_MeshPacket *p)
 {
-    std::sort_heap(queue.begin(), queue.end(), &CompareMeshPacketFunc); // sort ascending based on priority (0 -> 127)
-
-    // find first packet which does not compare less (in priority) than parameter packet
-    auto low = std::lower_bound(queue.begin(), queue.end(), p, &CompareMeshPacketFunc);
+    // The least urgent packet we have is on top of lowHeap
+    meshtastic_MeshPacket *low = slots[lowHeap[0]].p;
 
-    if (low == queue.begin()) { // if already at start, there are no packets with lower priority
+    // Only make room for strictly higher priorities, otherwise the caller must drop the new packet
+    if (getPriority(p) <= getPriority(low)) {
+        stats.rejected++;
         return false;
     }
 
-    if (low == queue.end()) {
-        // all priorities in the vector are smaller than the incoming packet. Replace the lowest priority (first) element
-        low = queue.begin();
+    LOG_DEBUG("TX queue full, dropping id=0x%x pri=%d for id=0x%x pri=%d\n", low->id, low->priority, p->id, p->priority);
+    stats.dropped[getPriorityClass(getPriority(low))]++;
+    packetPool.release(removeSlot(lowHeap[0])); // deallocate and drop the packet we're replacing
+
+    insert(p);
+    return true;
+}
+
+void MeshPacketQueue::insert(meshtastic_MeshPacket *p)
+{
+    assert(count < maxLen);
+    uint16_t slot = freeSlots[maxLen - 1 - count];
+
+    Slot &s = slots[slot];
+    s.p = p;
+    s.from = getFrom(p);
+    s.id = p->id;
+
+    size_t pos = count++;
+    setHeapPos(false, pos, slot);
+    siftUp(false, pos);
+    setHeapPos(true, pos, slot);
+    siftUp(true, pos);
+
+    index.insert(slot, s.from, s.id);
+}
+
+meshtastic_MeshPacket *MeshPacketQueue::removeSlot(uint16_t slot)
+{
+    Slot &s = slots[slot];
+
+    // The same packet may be queued more than once (e.g. a retransmission), so find the bucket for this exact slot
+    uint16_t b = index.findRef(slot, s.from, s.id);
+    assert(b != IdHashTable::NONE);
+    index.remove(b, [this](uint16_t i) { return keyOf(i); });
+
+    heapRemove(false, s.highPos);
+    heapRemove(true, s.lowPos);
+    count--;
+    freeSlots[maxLen - 1 - count] = slot;
+
+    return s.p;
+}
+
+bool MeshPacketQueue::outranks(bool low, uint16_t a, uint16_t b) const
+{
+    return low ? CompareMeshPacketFunc(slots[a].p, slots[b].p) : CompareMeshPacketFunc(slots[b].p, slots[a].p);
+}
+
+void MeshPacketQueue::setHeapPos(bool low, size_t pos, uint16_t slot)
+{
+    if (low) {
+        lowHeap[pos] = slot;
+        slots[slot].lowPos = pos;
     } else {
-        // 'low' iterator points to first packet which does not compare less than parameter
-        --low; // iterate to lower priority packet
+        highHeap[pos] = slot;
+        slots[slot].highPos = pos;
     }
+}
 
-    if (getPriority(p) > getPriority(*low)) {
-        packetPool.release(*low); // deallocate and drop the packet we're replacing
-        *low = p;                 // replace low-pri packet at this position with incoming packet with higher priority
+void MeshPacketQueue::siftUp(bool low, size_t pos)
+{
+    uint16_t *heap = low ? lowHeap : highHeap;
+    uint16_t slot = heap[pos];
+    while (pos > 0) {
+        size_t parent = (pos - 1) / 2;
+        if (!outranks(low, slot, heap[parent]))
+            break;
+        setHeapPos(low, pos, heap[parent]);
+        pos = parent;
     }
+    setHeapPos(low, pos, slot);
+}
 
-    std::make_heap(queue.begin(), queue.end(), &CompareMeshPacketFunc);
-    return true;
+void MeshPacketQueue::siftDown(bool low, size_t pos)
+{
+    uint16_t *heap = low ? lowHeap : highHeap;
+    uint16_t slot = heap[pos];
+    for (;;) {
+        size_t child = 2 * pos + 1;
+        if (child >= count)
+            break;
+        if (child + 1 < count && outranks(low, heap[child + 1], heap[child]))
+            child++;
+        if (!outranks(low, heap[child], slot))
+            break;
+        setHeapPos(low, pos, heap[child]);
+        pos = child;
+    }
+    setHeapPos(low, pos, slot);
+}
+
+/// Remove the entry at 'pos', must be called before count is decremented
+void MeshPacketQueue::heapRemove(bool low, size_t pos)
+{
+    uint16_t *heap = low ? lowHeap : highHeap;
+    size_t last = count - 1;
+    if (pos == last)
+        return;
+
+    // Move the last entry into the hole, it may need to go either way
+    setHeapPos(low, pos, heap[last]);
+    if (pos > 0 && outranks(low, heap[pos], heap[(pos - 1) / 2]))
+        siftUp(low, pos);
+    else {
+        count--; // siftDown must not look at the old last entry
+        siftDown(low, pos);
+        count++;
+    }
 }
@@ -1,24 +1,82 @@
 #pragma once
 
+#include "IdHashTable.h"
 #include "MeshTypes.h"
 
-#include <queue>
+/// Drop counters are kept per priority band, these are the bands (named after the lowest priority they contain)
+enum MeshPacketQueuePriorityClass {
+    QUEUE_PRI_MIN,
+    QUEUE_PRI_BACKGROUND,
+    QUEUE_PRI_DEFAULT,
+    QUEUE_PRI_RELIABLE,
+    QUEUE_PRI_ACK,
+    QUEUE_PRI_MAX,
+    NUM_QUEUE_PRI_CLASSES
+};
+
+/// Counters so we can see what a full queue is costing us
+struct MeshPacketQueueStats {
+    uint32_t dropped[NUM_QUEUE_PRI_CLASSES]; // queued packets thrown away to make room for a higher priority one
+    uint32_t rejected;                       // packets refused because the queue was full of equal or higher priority ones
+    uint32_t cancelled;                      // packets removed by remove()
+};
 
 /**
  * A priority queue of packets
+ *
+ * Every queued packet lives in a fixed slot which is referenced from two binary heaps - one with the next packet to send on
+ * top and one with the packet we would drop first on top - plus a small hash table from (from, id) to slot.  That makes
+ * enqueue, dequeue, remove and dropping the lowest priority packet all O(log n) without ever re-sorting the whole queue.
+ * All storage is allocated once in the constructor.
  */
 class MeshPacketQueue
 {
-    size_t maxLen;
-    std::vector<meshtastic_MeshPacket *> queue;
+    struct Slot {
+        meshtastic_MeshPacket *p;
+        NodeNum from; // (from, id) key at the time we queued the packet
+        PacketId id;
+        uint16_t highPos, lowPos; // where this slot is in highHeap and lowHeap
+    };
+
+    size_t maxLen, count = 0;
+
+    Slot *slots;
+    uint16_t *freeSlots; // stack of unused slot numbers, the first maxLen - count are valid
+    uint16_t *highHeap;  // slot numbers, highest priority (next to send) on top
+    uint16_t *lowHeap;   // slot numbers, lowest priority (next to drop) on top
+
+    IdHashTable index; // slot numbers keyed on (from, id)
+
+    MeshPacketQueueStats stats = {};
 
     /** Replace a lower priority package in the queue with 'mp' (provided there are lower pri packages). Return true if replaced.
      */
     bool replaceLowerPriorityPacket(meshtastic_MeshPacket *mp);
 
+    /// Put 'p' in a free slot and link it into both heaps and the index
+    void insert(meshtastic_MeshPacket *p);
+
+    /// Unlink a slot from both heaps and the index and return its packet
+    meshtastic_MeshPacket *removeSlot(uint16_t slot);
+
+    // Heap helpers, 'low' selects lowHeap instead of highHeap
+    bool outranks(bool low, uint16_t a, uint16_t b) const;
+    void setHeapPos(bool low, size_t pos, uint16_t slot);
+    void siftUp(bool low, size_t pos);
+    void siftDown(bool low, size_t pos);
+    void heapRemove(bool low, size_t pos);
+
+    /// For index, the key a slot was queued with
+    PacketKey keyOf(uint16_t slot) const { return {slots[slot].from, slots[slot].id}; }
+
   public:
     explicit MeshPacketQueue(size_t _maxLen);
 
+    ~MeshPacketQueue();
+
+    MeshPacketQueue(const MeshPacketQueue &) = delete;
+    MeshPacketQueue &operator=(const MeshPacketQueue &) = delete;
+
     /** enqueue a packet, return false if full */
     bool enqueue(meshtastic_MeshPacket *p);
 
@@ -26,7 +84,7 @@ class MeshPacketQueue
     bool empty();
 
     /** return amount of free packets in Queue */
-    size_t getFree() { return maxLen - queue.size(); }
+    size_t getFree() { return maxLen - count; }
 
     /** return total size of the Queue */
     size_t getMaxLen() { return maxLen; }
@@ -37,4 +95,9 @@ class MeshPacketQueue
 
     /** Attempt to find and remove a packet from this queue.  Returns the packet which was removed from the queue */
     meshtastic_MeshPacket *remove(NodeNum from, PacketId id);
+
+    const MeshPacketQueueStats &getStats() const { return stats; }
+
+    /// Which drop counter a packet of priority 'pri' is counted in
+    static MeshPacketQueuePriorityClass getPriorityClass(uint32_t pri);
 };
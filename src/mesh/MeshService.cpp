@@ -46,9 +46,17 @@ MeshService *service;
 
 static MemoryDynamic<meshtastic_MqttClientProxyMessage> staticMqttClientProxyMessagePool;
 
+// These only ever back their matching toPhone queue (plus one being assembled), so size the slabs to match (see packetPool for
+// why the targets without FreeRTOS use the heap)
+#ifdef HAS_FREE_RTOS
+static MemoryPool<meshtastic_QueueStatus, MAX_RX_TOPHONE + 1> staticQueueStatusPool;
+
+static MemoryPool<meshtastic_ClientNotification, MAX_RX_TOPHONE / 2 + 1> staticClientNotificationPool;
+#else
 static MemoryDynamic<meshtastic_QueueStatus> staticQueueStatusPool;
 
 static MemoryDynamic<meshtastic_ClientNotification> staticClientNotificationPool;
+#endif
 
 Allocator<meshtastic_MqttClientProxyMessage> &mqttClientProxyMessagePool = staticMqttClientProxyMessagePool;
 
@@ -285,7 +293,7 @@ void MeshService::sendToPhone(meshtastic_MeshPacket *p)
 {
     perhapsDecode(p);
 
-#ifdef ARCH_ESP32
+#if defined(ARCH_ESP32) || defined(ARCH_PORTDUINO)
 #if !MESHTASTIC_EXCLUDE_STOREFORWARD
     if (moduleConfig.store_forward.enabled && storeForwardModule->isServer() &&
         p->decoded.portnum == meshtastic_PortNum_TEXT_MESSAGE_APP) {
@@ -3,6 +3,7 @@
 #include <Arduino.h>
 #include <assert.h>
 #include <string>
+#include <vector>
 
 #include "GPSStatus.h"
 #include "MemoryPool.h"
@@ -13,7 +14,7 @@
 #if defined(ARCH_PORTDUINO) && !HAS_RADIO
 #include "../platform/portduino/SimRadio.h"
 #endif
-#ifdef ARCH_ESP32
+#if defined(ARCH_ESP32) || defined(ARCH_PORTDUINO)
 #if !MESHTASTIC_EXCLUDE_STOREFORWARD
 #include "modules/esp32/StoreForwardModule.h"
 #endif
@@ -66,6 +67,12 @@ class MeshService
         return p->decoded.portnum == meshtastic_PortNum_TEXT_MESSAGE_APP ||
                p->decoded.portnum == meshtastic_PortNum_DETECTION_SENSOR_APP;
     }
+
+    /// Every portnum isTextPayload() might accept
+    static std::vector<meshtastic_PortNum> getTextPortNums()
+    {
+        return {meshtastic_PortNum_TEXT_MESSAGE_APP, meshtastic_PortNum_DETECTION_SENSOR_APP, meshtastic_PortNum_RANGE_TEST_APP};
+    }
     /// Called when some new packets have arrived from one of the radios
     Observable<uint32_t> fromNumChanged;
 
@@ -0,0 +1,42 @@
+#include "ModuleDispatch.h"
+
+#include <algorithm>
+
+void ModuleDispatch::clear()
+{
+    byPort.clear();
+    byPortIndices.clear();
+    wildcard.clear();
+    encrypted.clear();
+}
+
+void ModuleDispatch::add(uint16_t index, const std::vector<meshtastic_PortNum> &portnums, bool encryptedOk)
+{
+    if (portnums.empty())
+        wildcard.push_back(index);
+    for (auto p : portnums) {
+        PortEntry e = {(uint16_t)p, index};
+        auto pos = std::upper_bound(byPort.begin(), byPort.end(), e, [](const PortEntry &x, const PortEntry &y) {
+            return x.portnum < y.portnum || (x.portnum == y.portnum && x.index < y.index);
+        });
+        // A module listing the same portnum twice should still only be called once
+        if (pos != byPort.begin() && (pos - 1)->portnum == e.portnum && (pos - 1)->index == index)
+            continue;
+        byPort.insert(pos, e);
+    }
+    if (encryptedOk)
+        encrypted.push_back(index);
+
+    byPortIndices.resize(byPort.size());
+    for (size_t i = 0; i < byPort.size(); i++)
+        byPortIndices[i] = byPort[i].index;
+}
+
+ModuleDispatch::Cursor ModuleDispatch::lookup(meshtastic_PortNum portnum) const
+{
+    auto range = std::equal_range(byPort.begin(), byPort.end(), PortEntry{(uint16_t)portnum, 0},
+                                  [](const PortEntry &x, const PortEntry &y) { return x.portnum < y.portnum; });
+    const uint16_t *indices = byPortIndices.data();
+    const uint16_t *w = wildcard.data();
+    return Cursor(indices + (range.first - byPort.begin()), indices + (range.second - byPort.begin()), w, w + wildcard.size());
+}
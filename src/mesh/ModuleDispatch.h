@@ -0,0 +1,77 @@
+#pragma once
+
+#include "mesh/generated/meshtastic/portnums.pb.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * Which modules MeshModule::callModules should offer a packet to, so we don't ask every module in turn.
+ *
+ * Modules are identified by their position in the module list (so the order they are called in never changes).  Each one
+ * is either registered for a set of portnums, or as a wildcard which is offered every decoded packet.  Separately we keep the
+ * modules that also want to see packets we couldn't decrypt.
+ *
+ * Lookups don't allocate, and return the matching modules in module list order by merging the portnum's list with the
+ * wildcard list as they go.
+ */
+class ModuleDispatch
+{
+  public:
+    /// Walks the module indices for one packet, in increasing order
+    class Cursor
+    {
+        const uint16_t *a, *aEnd, *b, *bEnd;
+
+      public:
+        Cursor(const uint16_t *_a, const uint16_t *_aEnd, const uint16_t *_b, const uint16_t *_bEnd)
+            : a(_a), aEnd(_aEnd), b(_b), bEnd(_bEnd)
+        {
+        }
+
+        /// @return false once there are no more modules
+        bool next(uint16_t &index)
+        {
+            if (a != aEnd && (b == bEnd || *a < *b))
+                index = *a++;
+            else if (b != bEnd)
+                index = *b++;
+            else
+                return false;
+            return true;
+        }
+    };
+
+    /// Forget all modules
+    void clear();
+
+    /**
+     * Add the module at 'index' (which must be higher than any added so far).  An empty portnums list means the module wants
+     * to be offered every decoded packet.
+     */
+    void add(uint16_t index, const std::vector<meshtastic_PortNum> &portnums, bool encryptedOk);
+
+    /// The modules to offer a decoded packet with this portnum to
+    Cursor lookup(meshtastic_PortNum portnum) const;
+
+    /// The modules to offer a packet we could not decrypt to
+    Cursor lookupEncrypted() const
+    {
+        const uint16_t *e = encrypted.data();
+        return Cursor(e, e + encrypted.size(), NULL, NULL);
+    }
+
+  private:
+    /// Sorted by portnum, then module index
+    struct PortEntry {
+        uint16_t portnum;
+        uint16_t index;
+    };
+    std::vector<PortEntry> byPort;
+
+    /// The module indices of byPort, so a lookup can hand out a plain run of indices
+    std::vector<uint16_t> byPortIndices;
+
+    std::vector<uint16_t> wildcard;
+    std::vector<uint16_t> encrypted;
+};
@@ -57,16 +57,10 @@ meshtastic_ChannelFile channelFile;
 meshtastic_OEMStore oemStore;
 static bool hasOemStore = false;
 
+/// The nodes are saved in their own journal (see NodeJournal), so we never encode them here, but a DeviceState saved by an
+/// older version still has them and we load those
 bool meshtastic_DeviceState_callback(pb_istream_t *istream, pb_ostream_t *ostream, const pb_field_iter_t *field)
 {
-    if (ostream) {
-        std::vector<meshtastic_NodeInfoLite> const *vec = (std::vector<meshtastic_NodeInfoLite> *)field->pData;
-        for (auto item : *vec) {
-            if (!pb_encode_tag_for_field(ostream, field))
-                return false;
-            pb_encode_submessage(ostream, meshtastic_NodeInfoLite_fields, &item);
-        }
-    }
     if (istream) {
         meshtastic_NodeInfoLite node; // this gets good data
         std::vector<meshtastic_NodeInfoLite> *vec = (std::vector<meshtastic_NodeInfoLite> *)field->pData;
@@ -99,7 +93,9 @@ uint32_t error_address = 0;
 
 static uint8_t ourMacAddr[6];
 
-NodeDB::NodeDB()
+static const char *nodesFileName = "/prefs/nodes.journal";
+
+NodeDB::NodeDB() : nodeJournal(nodesFileName)
 {
     LOG_INFO("Initializing NodeDB\n");
     loadFromDisk();
@@ -519,6 +515,10 @@ void NodeDB::resetNodes()
     clearLocalPosition();
     numMeshNodes = 1;
     std::fill(devicestate.node_db_lite.begin() + 1, devicestate.node_db_lite.end(), meshtastic_NodeInfoLite());
+    rebuildNodeIndex();
+#if !(MESHTASTIC_EXCLUDE_PKI)
+    crypto->clearDHKeyCache();
+#endif
     saveDeviceStateToDisk();
     if (neighborInfoModule && moduleConfig.neighbor_info.enabled)
         neighborInfoModule->resetNeighbors();
@@ -536,6 +536,10 @@ void NodeDB::removeNodeByNum(NodeNum nodeNum)
     numMeshNodes -= removed;
     std::fill(devicestate.node_db_lite.begin() + numMeshNodes, devicestate.node_db_lite.begin() + numMeshNodes + 1,
               meshtastic_NodeInfoLite());
+    rebuildNodeIndex();
+#if !(MESHTASTIC_EXCLUDE_PKI)
+    crypto->clearDHKeyCache(nodeNum);
+#endif
     LOG_DEBUG("NodeDB::removeNodeByNum purged %d entries. Saving changes...\n", removed);
     saveDeviceStateToDisk();
 }
@@ -568,6 +572,7 @@ void NodeDB::cleanupMeshDB()
     numMeshNodes -= removed;
     std::fill(devicestate.node_db_lite.begin() + numMeshNodes, devicestate.node_db_lite.begin() + numMeshNodes + removed,
               meshtastic_NodeInfoLite());
+    rebuildNodeIndex();
     LOG_DEBUG("cleanupMeshDB purged %d entries\n", removed);
 }
 
@@ -578,6 +583,9 @@ void NodeDB::installDefaultDeviceState()
 
     numMeshNodes = 0;
     meshNodes = &devicestate.node_db_lite;
+    rebuildNodeIndex();
+    nodeJournal.clear();
+    savedDeviceStateCRC = 0;
 
     // init our devicestate with valid flags so protobuf writing/reading will work
     devicestate.has_my_node = true;
@@ -696,7 +704,15 @@ void NodeDB::loadFromDisk()
         meshNodes = &devicestate.node_db_lite;
         numMeshNodes = devicestate.node_db_lite.size();
     }
-    meshNodes->resize(MAX_NUM_NODES);
+    if (numMeshNodes > MAX_NUM_NODES)
+        LOG_WARN("Loaded %d nodes, more than MAX_NUM_NODES (%d), keeping them all\n", numMeshNodes, MAX_NUM_NODES);
+    meshNodes->resize(std::max((size_t)MAX_NUM_NODES, (size_t)numMeshNodes));
+
+    // The nodes are in their own journal, unless this DeviceState was saved by an older version (they move on the next save)
+    if (!nodeJournal.load(*meshNodes, numMeshNodes) && numMeshNodes > 0)
+        LOG_INFO("No %s yet, keeping the %d nodes from %s\n", nodesFileName, numMeshNodes, prefFileName);
+    rebuildNodeIndex();
+    lastNodeJournalSave = millis(); // what is on disk is current, so don't write again on the first packet we hear
 
     state = loadProto(configFileName, meshtastic_LocalConfig_size, sizeof(meshtastic_LocalConfig), &meshtastic_LocalConfig_msg,
                       &config);
@@ -800,18 +816,44 @@ bool NodeDB::saveChannelsToDisk()
     return saveProto(channelFileName, meshtastic_ChannelFile_size, &meshtastic_ChannelFile_msg, &channelFile);
 }
 
-bool NodeDB::saveDeviceStateToDisk()
+/// A pb_ostream_t callback which only updates the CRC in stream->state
+static bool crcwritecb(pb_ostream_t *stream, const uint8_t *buf, size_t count)
+{
+    uint32_t *crc = (uint32_t *)stream->state;
+    *crc = crc32Update(buf, count, *crc);
+    return true;
+}
+
+/// CRC of the encoded DeviceState (the struct itself holds the node vector's heap pointers, which say nothing about its content)
+uint32_t NodeDB::deviceStateCRC()
+{
+    uint32_t crc = CRC32_INITIAL;
+    pb_ostream_t stream = {&crcwritecb, &crc, SIZE_MAX};
+    if (!pb_encode(&stream, &meshtastic_DeviceState_msg, &devicestate))
+        return 0; // never matches savedDeviceStateCRC of a successful save, so we'll just save it
+    return crc;
+}
+
+bool NodeDB::saveDeviceStateToDisk(bool includeHeard)
 {
 #ifdef FSCom
     FSCom.mkdir("/prefs");
 #endif
-    // Note: if MAX_NUM_NODES=100 and meshtastic_NodeInfoLite_size=166, so will be approximately 17KB
-    // Because so huge we _must_ not use fullAtomic, because the filesystem is probably too small to hold two copies of this
-    return saveProto(prefFileName, sizeof(devicestate) + numMeshNodes * meshtastic_NodeInfoLite_size, &meshtastic_DeviceState_msg,
-                     &devicestate, false);
+    // Nodes first: until the DeviceState is rewritten without them, a DeviceState from an older version still has them all
+    bool okay = nodeJournal.save(*meshNodes, numMeshNodes, includeHeard);
+
+    // Without the nodes the DeviceState is small, so we can afford to replace it atomically, and only when it changed
+    uint32_t crc = deviceStateCRC();
+    if (crc != savedDeviceStateCRC) {
+        if (saveProto(prefFileName, sizeof(devicestate), &meshtastic_DeviceState_msg, &devicestate))
+            savedDeviceStateCRC = crc;
+        else
+            okay = false;
+    }
+    return okay;
 }
 
-bool NodeDB::saveToDiskNoRetry(int saveWhat)
+bool NodeDB::saveToDiskNoRetry(int saveWhat, bool includeHeard)
 {
     bool success = true;
 
@@ -859,15 +901,15 @@ bool NodeDB::saveToDiskNoRetry(int saveWhat)
     }
 
     if (saveWhat & SEGMENT_DEVICESTATE) {
-        success &= saveDeviceStateToDisk();
+        success &= saveDeviceStateToDisk(includeHeard);
     }
 
     return success;
 }
 
-bool NodeDB::saveToDisk(int saveWhat)
+bool NodeDB::saveToDisk(int saveWhat, bool includeHeard)
 {
-    bool success = saveToDiskNoRetry(saveWhat);
+    bool success = saveToDiskNoRetry(saveWhat, includeHeard);
 
     if (!success) {
         LOG_ERROR("Failed to save to disk, retrying...\n");
@@ -877,7 +919,7 @@ bool NodeDB::saveToDisk(int saveWhat)
         // We need to rewrite the OEM data if we are reformatting the FS
         saveWhat |= SEGMENT_OEM;
 #endif
-        success = saveToDiskNoRetry(saveWhat);
+        success = saveToDiskNoRetry(saveWhat, includeHeard);
 
         RECORD_CRITICALERROR(success ? meshtastic_CriticalErrorCode_FLASH_CORRUPTION_RECOVERABLE
                                      : meshtastic_CriticalErrorCode_FLASH_CORRUPTION_UNRECOVERABLE);
@@ -1030,10 +1072,20 @@ bool NodeDB::updateUser(uint32_t nodeId, meshtastic_User &p, uint8_t channelInde
     // Both of info->user and p start as filled with zero so I think this is okay
     bool changed = memcmp(&info->user, &p, sizeof(info->user)) || (info->channel != channelIndex);
 
+#if !(MESHTASTIC_EXCLUDE_PKI)
+    bool keyChanged = info->user.public_key.size != p.public_key.size ||
+                      memcmp(info->user.public_key.bytes, p.public_key.bytes, info->user.public_key.size) != 0;
+#endif
     info->user = TypeConversions::ConvertToUserLite(p);
     if (info->user.public_key.size == 32) {
         printBytes("Saved Pubkey: ", info->user.public_key.bytes, 32);
     }
+#if !(MESHTASTIC_EXCLUDE_PKI)
+    if (keyChanged) {
+        crypto->clearDHKeyCache(nodeId);
+        touchNode(info - &meshNodes->at(0)); // nodes with keys are evicted last
+    }
+#endif
     if (nodeId != getNodeNum())
         info->channel = channelIndex; // Set channel we need to use to reach this node (but don't set our own channel)
     LOG_DEBUG("updating changed=%d user %s/%s, channel=%d\n", changed, info->user.long_name, info->user.short_name,
@@ -1045,9 +1097,9 @@ bool NodeDB::updateUser(uint32_t nodeId, meshtastic_User &p, uint8_t channelInde
         powerFSM.trigger(EVENT_NODEDB_UPDATED);
         notifyObservers(true); // Force an update whether or not our node counts have changed
 
-        // We just changed something about the user, store our DB
+        // We just changed something about the user, store it (just this node, and any others whose user changed)
         Throttle::execute(
-            &lastNodeDbSave, ONE_MINUTE_MS, []() { nodeDB->saveToDisk(SEGMENT_DEVICESTATE); },
+            &lastNodeDbSave, ONE_MINUTE_MS, []() { nodeDB->saveToDisk(SEGMENT_DEVICESTATE, false); },
             []() { LOG_DEBUG("Deferring NodeDB saveToDisk for now, since we saved less than a minute ago\n"); });
     }
 
@@ -1066,8 +1118,10 @@ void NodeDB::updateFrom(const meshtastic_MeshPacket &mp)
             return;
         }
 
-        if (mp.rx_time) // if the packet has a valid timestamp use it to update our last_heard
+        if (mp.rx_time) { // if the packet has a valid timestamp use it to update our last_heard
             info->last_heard = mp.rx_time;
+            touchNode(info - &meshNodes->at(0));
+        }
 
         if (mp.rx_snr)
             info->snr = mp.rx_snr; // keep the most recent SNR we received for this node.
@@ -1077,6 +1131,9 @@ void NodeDB::updateFrom(const meshtastic_MeshPacket &mp)
         // If hopStart was set and there wasn't someone messing with the limit in the middle, add hopsAway
         if (mp.hop_start != 0 && mp.hop_limit <= mp.hop_start)
             info->hops_away = mp.hop_start - mp.hop_limit;
+
+        // These change with nearly every packet, so they are only written out now and then (just the nodes that changed)
+        Throttle::execute(&lastNodeJournalSave, NODE_JOURNAL_SAVE_MSEC, []() { nodeDB->saveToDisk(SEGMENT_DEVICESTATE); });
     }
 }
 
@@ -1093,13 +1150,122 @@ uint8_t NodeDB::getMeshNodeChannel(NodeNum n)
 /// NOTE: This function might be called from an ISR
 meshtastic_NodeInfoLite *NodeDB::getMeshNode(NodeNum n)
 {
-    for (int i = 0; i < numMeshNodes; i++)
-        if (meshNodes->at(i).num == n)
-            return &meshNodes->at(i);
+    uint16_t i = nodeIndex.find(n);
+    if (i < numMeshNodes)
+        return &meshNodes->at(i);
 
     return NULL;
 }
 
+void NodeDB::rebuildNodeIndex()
+{
+    // Sized for every slot in meshNodes, so each node always fits and the index never has to drop any of them
+    size_t maxNodes = std::max((size_t)MAX_NUM_NODES, meshNodes->size());
+    if (numMeshNodes > meshNodes->size())
+        LOG_ERROR("NodeDB count %u is past the end of the %u node array\n", numMeshNodes, (unsigned)meshNodes->size());
+    assert(numMeshNodes <= meshNodes->size());
+    nodeIndex.reset(maxNodes);
+    for (int i = 0; i < numMeshNodes; i++)
+        nodeIndex.insert(meshNodes->at(i).num, i);
+
+    evictPrev.assign(maxNodes, NodeIndex::NOT_FOUND);
+    evictNext.assign(maxNodes, NodeIndex::NOT_FOUND);
+    evictClass.assign(maxNodes, EVICT_BORING);
+    for (int c = 0; c < NUM_EVICTION_CLASSES; c++)
+        evictHead[c] = evictTail[c] = NodeIndex::NOT_FOUND;
+
+    // Seed the eviction order from the saved last_heard times, from then on it is kept in order as we hear nodes
+    std::vector<uint16_t> order;
+    for (int i = 1; i < numMeshNodes; i++)
+        order.push_back(i);
+    std::stable_sort(order.begin(), order.end(),
+                     [this](uint16_t a, uint16_t b) { return meshNodes->at(a).last_heard < meshNodes->at(b).last_heard; });
+    for (uint16_t pos : order)
+        linkEvictionOrder(pos);
+}
+
+void NodeDB::linkEvictionOrder(uint16_t pos)
+{
+    uint8_t c = evictionClassOf(meshNodes->at(pos));
+    evictClass[pos] = c;
+    evictNext[pos] = NodeIndex::NOT_FOUND;
+    evictPrev[pos] = evictTail[c];
+    if (evictTail[c] != NodeIndex::NOT_FOUND)
+        evictNext[evictTail[c]] = pos;
+    else
+        evictHead[c] = pos;
+    evictTail[c] = pos;
+}
+
+void NodeDB::unlinkEvictionOrder(uint16_t pos)
+{
+    uint8_t c = evictClass[pos];
+    if (evictPrev[pos] != NodeIndex::NOT_FOUND)
+        evictNext[evictPrev[pos]] = evictNext[pos];
+    else
+        evictHead[c] = evictNext[pos];
+    if (evictNext[pos] != NodeIndex::NOT_FOUND)
+        evictPrev[evictNext[pos]] = evictPrev[pos];
+    else
+        evictTail[c] = evictPrev[pos];
+}
+
+void NodeDB::touchNode(uint16_t pos)
+{
+    if (pos == 0 || pos >= numMeshNodes)
+        return; // our own node is never evicted
+    unlinkEvictionOrder(pos);
+    linkEvictionOrder(pos); // also picks up a change of class, e.g. we just learned their public key
+}
+
+int NodeDB::pickEvictionVictim()
+{
+    for (int c = 0; c < NUM_EVICTION_CLASSES; c++) {
+        // Favorites (and nodes whose key was set without telling us) are skipped by moving them to the back, so each is only
+        // passed over once per trip through the list
+        for (int tries = numMeshNodes; tries > 0 && evictHead[c] != NodeIndex::NOT_FOUND; tries--) {
+            uint16_t pos = evictHead[c];
+            const meshtastic_NodeInfoLite &node = meshNodes->at(pos);
+            if (node.is_favorite || evictionClassOf(node) != c)
+                touchNode(pos);
+            else
+                return pos;
+        }
+    }
+    return -1;
+}
+
+void NodeDB::removeNodeAt(uint16_t pos)
+{
+    assert(pos > 0 && pos < numMeshNodes);
+    uint16_t last = numMeshNodes - 1;
+
+    unlinkEvictionOrder(pos);
+    nodeIndex.erase(meshNodes->at(pos).num);
+
+    if (pos != last) {
+        // Move the last node into the hole, taking its place in the eviction lists with it
+        meshNodes->at(pos) = meshNodes->at(last);
+        nodeIndex.move(meshNodes->at(pos).num, pos);
+
+        uint8_t c = evictClass[last];
+        evictClass[pos] = c;
+        evictPrev[pos] = evictPrev[last];
+        evictNext[pos] = evictNext[last];
+        if (evictPrev[pos] != NodeIndex::NOT_FOUND)
+            evictNext[evictPrev[pos]] = pos;
+        else
+            evictHead[c] = pos;
+        if (evictNext[pos] != NodeIndex::NOT_FOUND)
+            evictPrev[evictNext[pos]] = pos;
+        else
+            evictTail[c] = pos;
+    }
+
+    meshNodes->at(last) = meshtastic_NodeInfoLite();
+    numMeshNodes--;
+}
+
 /// Find a node in our DB, create an empty NodeInfo if missing
 meshtastic_NodeInfoLite *NodeDB::getOrCreateMeshNode(NodeNum n)
 {
@@ -1111,40 +1277,32 @@ meshtastic_NodeInfoLite *NodeDB::getOrCreateMeshNode(NodeNum n)
                 screen->print("Warn: node database full!\nErasing oldest entry\n");
             LOG_WARN("Node database full with %i nodes and %i bytes free! Erasing oldest entry\n", numMeshNodes,
                      memGet.getFreeHeap());
-            // look for oldest node and erase it
-            uint32_t oldest = UINT32_MAX;
-            uint32_t oldestBoring = UINT32_MAX;
-            int oldestIndex = -1;
-            int oldestBoringIndex = -1;
-            for (int i = 1; i < numMeshNodes; i++) {
-                // Simply the oldest non-favorite node
-                if (!meshNodes->at(i).is_favorite && meshNodes->at(i).last_heard < oldest) {
-                    oldest = meshNodes->at(i).last_heard;
-                    oldestIndex = i;
-                }
-                // The oldest "boring" node
-                if (!meshNodes->at(i).is_favorite && meshNodes->at(i).user.public_key.size == 0 &&
-                    meshNodes->at(i).last_heard < oldestBoring) {
-                    oldestBoring = meshNodes->at(i).last_heard;
-                    oldestBoringIndex = i;
-                }
-            }
-            // if we found a "boring" node, evict it
-            if (oldestBoringIndex != -1) {
-                oldestIndex = oldestBoringIndex;
-            }
-            // Shove the remaining nodes down the chain
-            for (int i = oldestIndex; i < numMeshNodes - 1; i++) {
-                meshNodes->at(i) = meshNodes->at(i + 1);
+            // evict the least recently heard non-favorite node, preferring "boring" ones without a public key
+            uint32_t start = micros();
+            int oldestIndex = pickEvictionVictim();
+            if (oldestIndex < 0) {
+                LOG_WARN("Every node is a favorite, not adding 0x%x\n", n);
+                return NULL;
             }
-            (numMeshNodes)--;
+            removeNodeAt(oldestIndex);
+
+            uint32_t elapsed = micros() - start;
+            evictionStats.evictions++;
+            evictionStats.totalMicros += elapsed;
+            if (elapsed > evictionStats.maxMicros)
+                evictionStats.maxMicros = elapsed;
+            LOG_DEBUG("Evicted node in %u us (%u evictions, max %u us)\n", elapsed, evictionStats.evictions,
+                      evictionStats.maxMicros);
         }
         // add the node at the end
+        nodeIndex.insert(n, numMeshNodes);
         lite = &meshNodes->at((numMeshNodes)++);
 
         // everything is missing except the nodenum
         memset(lite, 0, sizeof(*lite));
         lite->num = n;
+        if (numMeshNodes > 1)
+            linkEvictionOrder(numMeshNodes - 1);
         LOG_INFO("Adding node to database with %i nodes and %i bytes free!\n", numMeshNodes, memGet.getFreeHeap());
     }
 
@@ -6,6 +6,8 @@
 #include <vector>
 
 #include "MeshTypes.h"
+#include "NodeIndex.h"
+#include "NodeJournal.h"
 #include "NodeStatus.h"
 #include "mesh-pb-constants.h"
 #include "mesh/generated/meshtastic/mesh.pb.h" // For CriticalErrorCode
@@ -52,6 +54,13 @@ enum LoadFileResult {
     OTHER_FAILURE = 5
 };
 
+/// How often, and how expensively, NodeDB had to evict a node to make room for a new one
+struct NodeDBEvictionStats {
+    uint32_t evictions;
+    uint32_t totalMicros; // time spent choosing and removing victims
+    uint32_t maxMicros;
+};
+
 class NodeDB
 {
     // NodeNum provisionalNodeNum; // if we are trying to find a node num this is our current attempt
@@ -73,8 +82,10 @@ class NodeDB
     NodeDB();
 
     /// write to flash
+    /// @param includeHeard see saveDeviceStateToDisk()
     /// @return true if the save was successful
-    bool saveToDisk(int saveWhat = SEGMENT_CONFIG | SEGMENT_MODULECONFIG | SEGMENT_DEVICESTATE | SEGMENT_CHANNELS);
+    bool saveToDisk(int saveWhat = SEGMENT_CONFIG | SEGMENT_MODULECONFIG | SEGMENT_DEVICESTATE | SEGMENT_CHANNELS,
+                    bool includeHeard = true);
 
     /** Reinit radio config if needed, because either:
      * a) sometimes a buggy android app might send us bogus settings or
@@ -149,6 +160,11 @@ class NodeDB
 
     void clearLocalPosition();
 
+    const NodeDBEvictionStats &getEvictionStats() const { return evictionStats; }
+
+    /// Bytes written to the node journal since boot
+    uint32_t getNodeBytesWritten() const { return nodeJournal.getBytesWritten(); }
+
     void setLocalPosition(meshtastic_Position position, bool timeOnly = false)
     {
         if (timeOnly) {
@@ -162,11 +178,55 @@ class NodeDB
         localPosition = position;
     }
 
+#ifndef PIO_UNIT_TESTING
   private:
-    uint32_t lastNodeDbSave = 0; // when we last saved our db to flash
+#endif
+    uint32_t lastNodeDbSave = 0;      // when we last saved our db to flash
+    uint32_t lastNodeJournalSave = 0; // when we last wrote out nodes that were only heard from, see updateFrom()
+
+    /// Our nodes on disk, only the ones which changed are written when we save
+    NodeJournal nodeJournal;
+
+    /// CRC of the rest of the DeviceState when we last saved it, so we only rewrite it when it changed
+    uint32_t savedDeviceStateCRC = 0;
+
+    /// NodeNum -> position in meshNodes, must be kept in step with every change to meshNodes/numMeshNodes
+    NodeIndex nodeIndex;
+
     /// Find a node in our DB, create an empty NodeInfoLite if missing
     meshtastic_NodeInfoLite *getOrCreateMeshNode(NodeNum n);
 
+    /// Rebuild nodeIndex and the eviction lists from scratch, after meshNodes has been reloaded or compacted
+    void rebuildNodeIndex();
+
+    /**
+     * Eviction order: intrusive doubly linked lists threaded through positions in meshNodes, least recently heard first.
+     * Nodes without a public key ("boring" ones) are in one list and are evicted before any node in the other.  Our own node
+     * (position 0) is in neither.
+     */
+    enum EvictionClass { EVICT_BORING = 0, EVICT_KEYED, NUM_EVICTION_CLASSES };
+    std::vector<uint16_t> evictPrev, evictNext;
+    std::vector<uint8_t> evictClass;
+    uint16_t evictHead[NUM_EVICTION_CLASSES], evictTail[NUM_EVICTION_CLASSES];
+    NodeDBEvictionStats evictionStats = {};
+
+    static EvictionClass evictionClassOf(const meshtastic_NodeInfoLite &node)
+    {
+        return node.user.public_key.size == 0 ? EVICT_BORING : EVICT_KEYED;
+    }
+
+    void linkEvictionOrder(uint16_t pos);
+    void unlinkEvictionOrder(uint16_t pos);
+
+    /// We just heard from (or changed) the node at pos, move it to the back of the eviction queue
+    void touchNode(uint16_t pos);
+
+    /// @return the position of the node to evict, or -1 if every node is a favorite
+    int pickEvictionVictim();
+
+    /// Remove the node at pos (which must not be our own) by moving the last node into its slot
+    void removeNodeAt(uint16_t pos);
+
     /// Notify observers of changes to the DB
     void notifyObservers(bool forceUpdate = false)
     {
@@ -186,10 +246,15 @@ class NodeDB
 
     /// write to flash
     /// @return true if the save was successful
-    bool saveToDiskNoRetry(int saveWhat);
+    bool saveToDiskNoRetry(int saveWhat, bool includeHeard = true);
 
     bool saveChannelsToDisk();
-    bool saveDeviceStateToDisk();
+
+    /// @param includeHeard false to leave out nodes whose only changes come from hearing them, see NodeJournal::save()
+    bool saveDeviceStateToDisk(bool includeHeard = true);
+
+    /// @return the CRC to compare with savedDeviceStateCRC
+    uint32_t deviceStateCRC();
 };
 
 extern NodeDB *nodeDB;
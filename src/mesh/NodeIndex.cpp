@@ -0,0 +1,69 @@
+#include "NodeIndex.h"
+#include <assert.h>
+
+void NodeIndex::reset(size_t maxNodes)
+{
+    size_t numBuckets = 1;
+    while (numBuckets < 2 * maxNodes)
+        numBuckets <<= 1;
+
+    if (buckets.size() != numBuckets) {
+        buckets.assign(numBuckets, Bucket());
+        buckets.shrink_to_fit();
+        mask = numBuckets - 1;
+    }
+    clear();
+}
+
+void NodeIndex::clear()
+{
+    for (auto &b : buckets)
+        b.pos = NOT_FOUND;
+}
+
+void NodeIndex::insert(NodeNum n, uint16_t pos)
+{
+    assert(!buckets.empty());
+    size_t b = bucketFor(n);
+    while (buckets[b].pos != NOT_FOUND)
+        b = (b + 1) & mask;
+    buckets[b].num = n;
+    buckets[b].pos = pos;
+}
+
+void NodeIndex::move(NodeNum n, uint16_t pos)
+{
+    size_t b = findBucket(n);
+    assert(b < buckets.size());
+    buckets[b].pos = pos;
+}
+
+void NodeIndex::erase(NodeNum n)
+{
+    size_t hole = findBucket(n);
+    if (hole >= buckets.size())
+        return;
+
+    // Backward shift deletion: pull later entries of the probe run into the hole, unless that would put them before their
+    // home bucket, so that find() never stops early at an empty bucket
+    size_t next = (hole + 1) & mask;
+    while (buckets[next].pos != NOT_FOUND) {
+        size_t home = bucketFor(buckets[next].num);
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            buckets[hole] = buckets[next];
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+    buckets[hole].pos = NOT_FOUND;
+}
+
+size_t NodeIndex::findBucket(NodeNum n) const
+{
+    if (buckets.empty())
+        return buckets.size();
+    for (size_t b = bucketFor(n); buckets[b].pos != NOT_FOUND; b = (b + 1) & mask)
+        if (buckets[b].num == n)
+            return b;
+    return buckets.size();
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "MeshTypes.h"
+#include <vector>
+
+/**
+ * A compact NodeNum -> position hash index for NodeDB, so looking a node up doesn't need to walk the whole node array.
+ *
+ * Open addressed with linear probing, and kept at most half full.  Buckets hold the NodeNum as well as the position so
+ * lookups and removals never need to touch the (large) NodeInfoLite structs.
+ *
+ * Note: find() is called from getMeshNode(), which might be called from an ISR, so it must not allocate.
+ */
+class NodeIndex
+{
+  public:
+    static const uint16_t NOT_FOUND = UINT16_MAX;
+
+    /// Size the index for up to maxNodes entries and empty it (this is the only place we allocate)
+    void reset(size_t maxNodes);
+
+    /// Forget all entries
+    void clear();
+
+    /// Add a node at position pos, the node must not already be in the index
+    void insert(NodeNum n, uint16_t pos);
+
+    /// Change the position of a node which is already in the index
+    void move(NodeNum n, uint16_t pos);
+
+    /// Remove a node, if present
+    void erase(NodeNum n);
+
+    /// @return the position of node n, or NOT_FOUND
+    uint16_t find(NodeNum n) const
+    {
+        if (buckets.empty())
+            return NOT_FOUND;
+        for (size_t b = bucketFor(n); buckets[b].pos != NOT_FOUND; b = (b + 1) & mask)
+            if (buckets[b].num == n)
+                return buckets[b].pos;
+        return NOT_FOUND;
+    }
+
+  private:
+    struct Bucket {
+        NodeNum num;
+        uint16_t pos; // NOT_FOUND means this bucket is empty
+    };
+
+    std::vector<Bucket> buckets;
+    size_t mask = 0;
+
+    size_t bucketFor(NodeNum n) const
+    {
+        // Fibonacci hashing - node numbers are often derived from MAC addresses, so spread the low bits around
+        return ((n * 0x9E3779B1u) >> 16) & mask;
+    }
+
+    /// @return the bucket holding node n, or buckets.size() if not present
+    size_t findBucket(NodeNum n) const;
+};
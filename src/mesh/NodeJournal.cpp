@@ -0,0 +1,250 @@
+#include "NodeJournal.h"
+#include "FSCommon.h"
+#include "SafeFile.h"
+#include "configuration.h"
+#include <ErriezCRC32.h>
+#include <algorithm>
+#include <string.h>
+
+#define RECORD_MAGIC 0x4e // 'N'
+
+/// Where a node ended up while replaying the journal
+struct LoadedNode {
+    pb_size_t pos;
+    uint16_t recordLen;
+};
+
+uint32_t NodeJournal::userCRCOf(const meshtastic_NodeInfoLite &node)
+{
+    struct {
+        meshtastic_UserLite user;
+        bool has_user;
+        uint8_t channel;
+        bool is_favorite;
+    } identity;
+    memset(&identity, 0, sizeof(identity));
+    identity.user = node.user;
+    identity.has_user = node.has_user;
+    identity.channel = node.channel;
+    identity.is_favorite = node.is_favorite;
+    return crc32Buffer(&identity, sizeof(identity));
+}
+
+size_t NodeJournal::appendRecord(std::vector<uint8_t> &out, NodeNum num, const meshtastic_NodeInfoLite *node)
+{
+    uint8_t record[sizeof(RecordHeader) + meshtastic_NodeInfoLite_size];
+    RecordHeader h = {RECORD_MAGIC, node ? RECORD_NODE : RECORD_REMOVE, 0, num, 0};
+    if (node)
+        h.len = pb_encode_to_bytes(record + sizeof(h), meshtastic_NodeInfoLite_size, &meshtastic_NodeInfoLite_msg, node);
+
+    size_t len = sizeof(h) + h.len;
+    memcpy(record, &h, sizeof(h));
+    h.crc = crc32Buffer(record, len);
+    memcpy(record, &h, sizeof(h));
+
+    out.insert(out.end(), record, record + len);
+    return len;
+}
+
+void NodeJournal::clear()
+{
+    saved.clear();
+    journalBytes = liveBytes = 0;
+    needCompact = true;
+}
+
+bool NodeJournal::load(std::vector<meshtastic_NodeInfoLite> &nodes, pb_size_t &numNodes)
+{
+#ifdef FSCom
+    if (FSCom.exists(filename))
+        return loadFile(filename, nodes, numNodes);
+
+    // Compacting (see SafeFile) removes the old journal before renaming the new one into place, we might have been stopped
+    // in between
+    String tmp = filename;
+    tmp += ".tmp";
+    if (FSCom.exists(tmp.c_str())) {
+        LOG_WARN("Node journal %s missing, using %s\n", filename, tmp.c_str());
+        return loadFile(tmp.c_str(), nodes, numNodes);
+    }
+#endif
+    return false;
+}
+
+bool NodeJournal::loadFile(const char *path, std::vector<meshtastic_NodeInfoLite> &nodes, pb_size_t &numNodes)
+{
+#ifdef FSCom
+    auto f = FSCom.open(path, FILE_O_READ);
+    if (!f) {
+        LOG_ERROR("Could not open / read %s\n", path);
+        return false;
+    }
+
+    uint32_t start = millis();
+    uint32_t fileSize = f.size(), offset = 0, records = 0;
+    std::unordered_map<NodeNum, LoadedNode> loaded;
+    numNodes = 0;
+
+    uint8_t record[sizeof(RecordHeader) + meshtastic_NodeInfoLite_size];
+    RecordHeader h;
+    meshtastic_NodeInfoLite node;
+    while (f.read(record, sizeof(h)) == sizeof(h)) {
+        memcpy(&h, record, sizeof(h));
+        if (h.magic != RECORD_MAGIC || (h.type != RECORD_NODE && h.type != RECORD_REMOVE) ||
+            h.len > meshtastic_NodeInfoLite_size || f.read(record + sizeof(h), h.len) != h.len)
+            break;
+
+        uint32_t crc = h.crc;
+        h.crc = 0;
+        memcpy(record, &h, sizeof(h));
+        if (crc32Buffer(record, sizeof(h) + h.len) != crc)
+            break;
+
+        auto it = loaded.find(h.num);
+        if (h.type == RECORD_REMOVE) {
+            if (it != loaded.end()) {
+                // Same as NodeDB: the last node moves into the hole
+                pb_size_t pos = it->second.pos, last = numNodes - 1;
+                loaded.erase(it);
+                if (pos != last) {
+                    nodes[pos] = nodes[last];
+                    loaded[nodes[pos].num].pos = pos;
+                }
+                numNodes--;
+            }
+        } else {
+            memset(&node, 0, sizeof(node));
+            if (!pb_decode_from_bytes(record + sizeof(h), h.len, &meshtastic_NodeInfoLite_msg, &node))
+                break;
+            if (it != loaded.end()) {
+                nodes[it->second.pos] = node;
+                it->second.recordLen = sizeof(h) + h.len;
+            } else if (numNodes < nodes.size()) {
+                loaded[h.num] = {numNodes, (uint16_t)(sizeof(h) + h.len)};
+                nodes[numNodes++] = node;
+            }
+        }
+        offset += sizeof(h) + h.len;
+        records++;
+    }
+    f.close();
+    std::fill(nodes.begin() + numNodes, nodes.end(), meshtastic_NodeInfoLite());
+
+    // What is on disk is what we just loaded
+    saved.clear();
+    liveBytes = 0;
+    for (pb_size_t i = 0; i < numNodes; i++) {
+        uint16_t len = loaded[nodes[i].num].recordLen;
+        saved[nodes[i].num] = {crc32Buffer(&nodes[i], sizeof(nodes[i])), userCRCOf(nodes[i]), len, generation};
+        liveBytes += len;
+    }
+    journalBytes = offset;
+
+    // Anything after a damaged record is lost, so don't append after it
+    needCompact = offset != fileSize || strcmp(path, filename) != 0;
+    if (offset != fileSize)
+        LOG_WARN("Node journal %s damaged after %u of %u bytes\n", path, offset, fileSize);
+    LOG_INFO("Loaded %u nodes from %u journal records in %u ms\n", numNodes, records, millis() - start);
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool NodeJournal::save(const std::vector<meshtastic_NodeInfoLite> &nodes, pb_size_t numNodes, bool includeHeard)
+{
+    generation++;
+    std::vector<uint8_t> out;
+
+    // Removals first, so a node removed and then heard again since the last save is still there after a reload
+    for (pb_size_t i = 0; i < numNodes; i++) {
+        auto it = saved.find(nodes[i].num);
+        if (it != saved.end())
+            it->second.generation = generation;
+    }
+    for (auto it = saved.begin(); it != saved.end();) {
+        if (it->second.generation != generation) {
+            appendRecord(out, it->first, NULL);
+            liveBytes -= it->second.recordLen;
+            it = saved.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    for (pb_size_t i = 0; i < numNodes; i++) {
+        const meshtastic_NodeInfoLite &node = nodes[i];
+        uint32_t crc = crc32Buffer(&node, sizeof(node)), userCRC = userCRCOf(node);
+        auto it = saved.find(node.num);
+        if (it != saved.end() && (it->second.nodeCRC == crc || (!includeHeard && it->second.userCRC == userCRC)))
+            continue; // unchanged, or nothing that can't wait
+
+        uint16_t len = appendRecord(out, node.num, &node);
+        if (it != saved.end()) {
+            liveBytes -= it->second.recordLen;
+            it->second.nodeCRC = crc;
+            it->second.userCRC = userCRC;
+            it->second.recordLen = len;
+        } else {
+            saved[node.num] = {crc, userCRC, len, generation};
+        }
+        liveBytes += len;
+    }
+
+    uint32_t limit = std::max((uint32_t)NODE_JOURNAL_MIN_COMPACT_BYTES, NODE_JOURNAL_MAX_GROWTH * liveBytes);
+    if (needCompact || journalBytes + out.size() > limit)
+        return compact(nodes, numNodes);
+    if (out.empty())
+        return true;
+
+#ifdef FSCom
+    auto f = FSCom.open(filename, FILE_O_APPEND);
+    size_t written = f ? f.write(out.data(), out.size()) : 0;
+    f.close();
+
+    journalBytes += written;
+    bytesWritten += written;
+    if (written != out.size()) {
+        LOG_ERROR("Can't append to %s\n", filename);
+        needCompact = true;
+        return false;
+    }
+    LOG_DEBUG("Saved %u bytes of node changes to %s\n", (uint32_t)out.size(), filename);
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool NodeJournal::compact(const std::vector<meshtastic_NodeInfoLite> &nodes, pb_size_t numNodes)
+{
+#ifdef FSCom
+    // Not fullAtomic, the filesystem might not hold two copies.  load() copes with being stopped half way.
+    auto f = SafeFile(filename, false);
+
+    saved.clear();
+    liveBytes = 0;
+    std::vector<uint8_t> out;
+    size_t written = 0;
+    for (pb_size_t i = 0; i < numNodes; i++) {
+        const meshtastic_NodeInfoLite &node = nodes[i];
+        out.clear();
+        uint16_t len = appendRecord(out, node.num, &node);
+        written += f.write(out.data(), out.size());
+        saved[node.num] = {crc32Buffer(&node, sizeof(node)), userCRCOf(node), len, generation};
+        liveBytes += len;
+    }
+
+    bool okay = f.close() && written == liveBytes;
+    bytesWritten += written;
+    journalBytes = okay ? written : 0;
+    needCompact = !okay;
+    if (!okay)
+        LOG_ERROR("Can't write %s\n", filename);
+    else
+        LOG_DEBUG("Rewrote %s with %u nodes in %u bytes\n", filename, numNodes, (uint32_t)written);
+    return okay;
+#else
+    return false;
+#endif
+}
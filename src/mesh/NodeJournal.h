@@ -0,0 +1,100 @@
+#pragma once
+
+#include "MeshTypes.h"
+#include "mesh-pb-constants.h"
+#include <unordered_map>
+#include <vector>
+
+/// Once the journal is this many times bigger than the nodes in it, it is rewritten with just their latest versions
+#ifndef NODE_JOURNAL_MAX_GROWTH
+#define NODE_JOURNAL_MAX_GROWTH 2
+#endif
+
+/// ... but never compact a journal smaller than this
+#ifndef NODE_JOURNAL_MIN_COMPACT_BYTES
+#define NODE_JOURNAL_MIN_COMPACT_BYTES 4096
+#endif
+
+/// How often NodeDB writes out nodes whose only changes are from hearing them (last_heard, snr, position, telemetry...)
+#ifndef NODE_JOURNAL_SAVE_MSEC
+#define NODE_JOURNAL_SAVE_MSEC (60 * 60 * 1000)
+#endif
+
+/**
+ * Keeps NodeDB's nodes on the filesystem as a journal: a file of records, each one the latest version of a node or the
+ * news that it was removed.  Saving only appends the nodes which changed since the last save, in one write, instead of
+ * rewriting every node.
+ *
+ * Every record has a CRC, so after a crash (or a write cut short) loading stops at the first damaged record and we keep
+ * every node saved before it.  When the journal has grown too big it is compacted, rewritten (via SafeFile) with one record
+ * per node.
+ *
+ * We notice a node changed by comparing a CRC of its NodeInfoLite with the CRC when we last saved it, so NodeDB doesn't have
+ * to mark every change it makes.  A second CRC covers just who the node is (user, key, channel, favorite), so a save can
+ * skip nodes whose only changes come from hearing them, which on a busy mesh is nearly all of them.
+ */
+class NodeJournal
+{
+  public:
+    explicit NodeJournal(const char *_filename) : filename(_filename) {}
+
+    /**
+     * Replay the journal into nodes[0..numNodes), replacing whatever was there.  Nodes beyond nodes.size() are dropped.
+     * @return false (leaving nodes alone) if there is no journal
+     */
+    bool load(std::vector<meshtastic_NodeInfoLite> &nodes, pb_size_t &numNodes);
+
+    /**
+     * Write out the nodes which changed (or are new) since they were last saved, and a removal for each node that has
+     * gone.  Unless includeHeard, nodes where only last_heard, snr, position etc. changed wait for a later save.
+     * @return false if the write failed (we'll compact next time)
+     */
+    bool save(const std::vector<meshtastic_NodeInfoLite> &nodes, pb_size_t numNodes, bool includeHeard = true);
+
+    /// Forget what we have saved, the next save() writes a whole new journal.  For when the file has been deleted.
+    void clear();
+
+    /// Bytes we have written since we started, to compare with rewriting the whole DB
+    uint32_t getBytesWritten() const { return bytesWritten; }
+
+    /// Size of the journal file
+    uint32_t getSize() const { return journalBytes; }
+
+  private:
+    enum RecordType : uint8_t { RECORD_NODE = 1, RECORD_REMOVE = 2 };
+
+    struct RecordHeader {
+        uint8_t magic;
+        uint8_t type;
+        uint16_t len; // of the encoded NodeInfoLite that follows, 0 for RECORD_REMOVE
+        NodeNum num;
+        uint32_t crc; // of this header (with crc = 0) and what follows
+    };
+
+    /// What we last saved for a node
+    struct Saved {
+        uint32_t nodeCRC;    // crc32 of the NodeInfoLite struct
+        uint32_t userCRC;    // see userCRCOf()
+        uint16_t recordLen;  // bytes its record takes
+        uint16_t generation; // save() generation we last saw it in
+    };
+
+    const char *filename;
+    std::unordered_map<NodeNum, Saved> saved;
+    uint16_t generation = 0;
+
+    uint32_t journalBytes = 0; // in the file now
+    uint32_t liveBytes = 0;    // in the records for the nodes we have now
+    uint32_t bytesWritten = 0;
+    bool needCompact = true; // nothing written yet, or the end of the file is damaged
+
+    static uint32_t userCRCOf(const meshtastic_NodeInfoLite &node);
+
+    /// Add a record for node (or its removal, if node is NULL) to out, @return its length
+    static size_t appendRecord(std::vector<uint8_t> &out, NodeNum num, const meshtastic_NodeInfoLite *node);
+
+    /// Rewrite the journal with one record for each node
+    bool compact(const std::vector<meshtastic_NodeInfoLite> &nodes, pb_size_t numNodes);
+
+    bool loadFile(const char *path, std::vector<meshtastic_NodeInfoLite> &nodes, pb_size_t &numNodes);
+};
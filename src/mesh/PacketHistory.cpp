@@ -6,10 +6,28 @@
 #include "platform/portduino/PortduinoGlue.h"
 #endif
 
+// We need to remember FLOOD_EXPIRE_TIME worth of traffic, start with a few packets for each node we could know about and grow
+// from there if the mesh is busier than that
+#define PACKET_HISTORY_RECORDS_PER_NODE 2
+#define PACKET_HISTORY_MIN_RECORDS 32
+#define PACKET_HISTORY_MAX_RECORDS 16384 // indexes must fit in a uint16_t with room for IdHashTable::NONE
+
 PacketHistory::PacketHistory()
 {
-    recentPackets.reserve(MAX_NUM_NODES); // Prealloc the worst case # of records - to prevent heap fragmentation
-                                          // setup our periodic task
+    uint32_t records = MAX_NUM_NODES * PACKET_HISTORY_RECORDS_PER_NODE;
+    if (records < PACKET_HISTORY_MIN_RECORDS)
+        records = PACKET_HISTORY_MIN_RECORDS;
+    if (records > PACKET_HISTORY_MAX_RECORDS)
+        records = PACKET_HISTORY_MAX_RECORDS;
+    maxRecords = records;
+
+    recentPackets = new PacketRecord[maxRecords];
+    recentIndex.resize(maxRecords);
+}
+
+PacketHistory::~PacketHistory()
+{
+    delete[] recentPackets;
 }
 
 /**
@@ -22,59 +40,108 @@ bool PacketHistory::wasSeenRecently(const meshtastic_MeshPacket *p, bool withUpd
         return false; // Not a floodable message ID, so we don't care
     }
 
-    uint32_t now = millis();
-
-    PacketRecord r;
-    r.id = p->id;
-    r.sender = getFrom(p);
-    r.rxTimeMsec = now;
-
-    auto found = recentPackets.find(r);
-    bool seenRecently = (found != recentPackets.end()); // found not equal to .end() means packet was seen recently
-
-    if (seenRecently && (now - found->rxTimeMsec) >= FLOOD_EXPIRE_TIME) { // Check whether found packet has already expired
-        recentPackets.erase(found);                                       // Erase and pretend packet has not been seen recently
-        found = recentPackets.end();
-        seenRecently = false;
-    }
+    bool seenRecently = wasSeenRecently(getFrom(p), p->id, millis(), withUpdate);
 
     if (seenRecently) {
         LOG_DEBUG("Found existing packet record for fr=0x%x,to=0x%x,id=0x%x\n", p->from, p->to, p->id);
     }
 
     if (withUpdate) {
-        if (found != recentPackets.end()) { // delete existing to updated timestamp (re-insert)
-            recentPackets.erase(found);     // as unsorted_set::iterator is const (can't update timestamp - so re-insert..)
-        }
-        recentPackets.insert(r);
         printPacket("Add packet record", p);
     }
 
-    // Capacity is reerved, so only purge expired packets if recentPackets fills past 90% capacity
-    // Expiry is normally dealt with after having searched/found a packet (above)
-    if (recentPackets.size() > (MAX_NUM_NODES * 0.9)) {
-        clearExpiredRecentPackets();
+    return seenRecently;
+}
+
+bool PacketHistory::wasSeenRecently(NodeNum sender, PacketId id, uint32_t now, bool withUpdate)
+{
+    // Records are in rxTime order, so anything expired is at the head - after this every record we find is current
+    clearExpiredRecentPackets(now);
+
+    auto key = [this](uint16_t slot) { return keyOf(slot); };
+    uint16_t bucket = recentIndex.find(sender, id, key);
+    bool seenRecently = (bucket != IdHashTable::NONE);
+
+    if (seenRecently)
+        stats.hits++;
+    else
+        stats.misses++;
+
+    if (withUpdate) {
+        // To update the timestamp we append a fresh record, the old one stays in the buffer but is no longer indexed
+        if (seenRecently)
+            recentIndex.remove(bucket, key);
+
+        // Everything left is unexpired, only forget some of it if we really can't get any bigger
+        if (numRecords == maxRecords && !grow() && removeOldest())
+            stats.evictions++;
+
+        uint16_t slot = (recentHead + numRecords) % maxRecords;
+        numRecords++;
+
+        PacketRecord &r = recentPackets[slot];
+        r.sender = sender;
+        r.id = id;
+        r.rxTimeMsec = now;
+
+        recentIndex.insert(slot, sender, id);
     }
 
     return seenRecently;
 }
 
-/**
- * Iterate through all recent packets, and remove all older than FLOOD_EXPIRE_TIME
- */
-void PacketHistory::clearExpiredRecentPackets()
+bool PacketHistory::grow()
 {
-    uint32_t now = millis();
+    if (maxRecords >= PACKET_HISTORY_MAX_RECORDS)
+        return false;
 
-    LOG_DEBUG("recentPackets size=%ld\n", recentPackets.size());
+    uint16_t newMax = maxRecords * 2;
+    if (newMax > PACKET_HISTORY_MAX_RECORDS)
+        newMax = PACKET_HISTORY_MAX_RECORDS;
+    LOG_DEBUG("Growing packet history from %u to %u records\n", maxRecords, newMax);
 
-    for (auto it = recentPackets.begin(); it != recentPackets.end();) {
-        if ((now - it->rxTimeMsec) >= FLOOD_EXPIRE_TIME) {
-            it = recentPackets.erase(it); // erase returns iterator pointing to element immediately following the one erased
-        } else {
-            ++it;
-        }
+    // Unwrap the records into the new buffer oldest first, indexing the ones the old index points at (the rest are leftovers)
+    PacketRecord *packets = new PacketRecord[newMax];
+    IdHashTable index;
+    index.resize(newMax);
+    for (uint16_t i = 0; i < numRecords; i++) {
+        uint16_t slot = (recentHead + i) % maxRecords;
+        const PacketRecord &r = recentPackets[slot];
+        packets[i] = r;
+        if (recentIndex.findRef(slot, r.sender, r.id) != IdHashTable::NONE)
+            index.insert(i, r.sender, r.id);
     }
 
-    LOG_DEBUG("recentPackets size=%ld (after clearing expired packets)\n", recentPackets.size());
-}
\ No newline at end of file
+    delete[] recentPackets;
+    recentPackets = packets;
+    recentIndex.swap(index);
+    maxRecords = newMax;
+    recentHead = 0;
+    return true;
+}
+
+bool PacketHistory::removeOldest()
+{
+    const PacketRecord &oldest = recentPackets[recentHead];
+
+    // If the packet was seen again since, the index points at the newer record and this one is just a leftover
+    uint16_t bucket = recentIndex.findRef(recentHead, oldest.sender, oldest.id);
+    bool live = (bucket != IdHashTable::NONE);
+    if (live)
+        recentIndex.remove(bucket, [this](uint16_t slot) { return keyOf(slot); });
+
+    recentHead = (recentHead + 1) % maxRecords;
+    numRecords--;
+    return live;
+}
+
+/**
+ * Remove all records older than FLOOD_EXPIRE_TIME, they are all at the head of the buffer
+ */
+void PacketHistory::clearExpiredRecentPackets(uint32_t now)
+{
+    while (numRecords > 0 && (now - recentPackets[recentHead].rxTimeMsec) >= FLOOD_EXPIRE_TIME) {
+        if (removeOldest())
+            stats.expirations++;
+    }
+}
@@ -1,7 +1,7 @@
 #pragma once
 
+#include "IdHashTable.h"
 #include "Router.h"
-#include <unordered_set>
 
 /// We clear our old flood record 10 minutes after we see the last of it
 #define FLOOD_EXPIRE_TIME (10 * 60 * 1000L)
@@ -17,29 +17,63 @@ struct PacketRecord {
     bool operator==(const PacketRecord &p) const { return sender == p.sender && id == p.id; }
 };
 
-class PacketRecordHashFunction
-{
-  public:
-    size_t operator()(const PacketRecord &p) const { return (std::hash<NodeNum>()(p.sender)) ^ (std::hash<PacketId>()(p.id)); }
+/// Counters so we can see how well the history is sized for the mesh we are on
+struct PacketHistoryStats {
+    uint32_t hits;        // lookups that found an unexpired record
+    uint32_t misses;      // lookups that didn't
+    uint32_t evictions;   // unexpired records pushed out because the history could not grow any further
+    uint32_t expirations; // records dropped because they were older than FLOOD_EXPIRE_TIME
 };
 
 /**
  * This is a mixin that adds a record of past packets we have seen
+ *
+ * Records live in a circular buffer in the order we added them, which is also rxTime order, so expiring old records is just
+ * a matter of advancing the head.  A hash table maps (sender, id) to a slot in that buffer so lookups don't need to scan.
+ * When the buffer fills with unexpired records we double it rather than forget packets we might see again, so it ends up
+ * sized for the traffic we actually hear and there is no heap churn per packet.
  */
 class PacketHistory
 {
   private:
-    std::unordered_set<PacketRecord, PacketRecordHashFunction> recentPackets;
+    PacketRecord *recentPackets; // circular buffer of records, oldest at recentHead
+    uint16_t numRecords = 0, maxRecords, recentHead = 0;
+
+    IdHashTable recentIndex; // indexes into recentPackets of the live copy of each packet
+
+    PacketHistoryStats stats = {};
+
+    /// For recentIndex, the key of the record in a slot
+    PacketKey keyOf(uint16_t slot) const { return {recentPackets[slot].sender, recentPackets[slot].id}; }
+
+    /// Double the buffer (up to PACKET_HISTORY_MAX_RECORDS), returns false if it is already as big as it gets
+    bool grow();
+
+    /// Drop the oldest record, removing it from the index if it is still the live copy of that packet (returns true if it was)
+    bool removeOldest();
 
-    void clearExpiredRecentPackets(); // clear all recentPackets older than FLOOD_EXPIRE_TIME
+    void clearExpiredRecentPackets(uint32_t now); // clear all recentPackets older than FLOOD_EXPIRE_TIME
+
+  protected:
+    /**
+     * Core of wasSeenRecently(), split out so callers (and tests) can supply their own clock
+     */
+    bool wasSeenRecently(NodeNum sender, PacketId id, uint32_t now, bool withUpdate);
 
   public:
     PacketHistory();
 
+    ~PacketHistory();
+
+    PacketHistory(const PacketHistory &) = delete;
+    PacketHistory &operator=(const PacketHistory &) = delete;
+
     /**
      * Update recentBroadcasts and return true if we have already seen this packet
      *
      * @param withUpdate if true and not found we add an entry to recentPackets
      */
     bool wasSeenRecently(const meshtastic_MeshPacket *p, bool withUpdate = true);
+
+    const PacketHistoryStats &getPacketHistoryStats() const { return stats; }
 };
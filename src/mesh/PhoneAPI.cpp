@@ -498,9 +498,9 @@ bool PhoneAPI::available()
         }
         return true; // Always say we have something, because we might need to advance our state machine
     case STATE_SEND_PACKETS: {
-        if (!queueStatusPacketForPhone)
+        if (!queueStatusPacketForPhone && pullsFromService)
             queueStatusPacketForPhone = service->getQueueStatusForPhone();
-        if (!mqttClientProxyMessageForPhone)
+        if (!mqttClientProxyMessageForPhone && pullsFromService)
             mqttClientProxyMessageForPhone = service->getMqttClientProxyMessageForPhone();
         bool hasPacket = !!queueStatusPacketForPhone || !!mqttClientProxyMessageForPhone;
         if (hasPacket)
@@ -515,15 +515,15 @@ bool PhoneAPI::available()
         }
 #endif
 
-#ifdef ARCH_ESP32
+#if defined(ARCH_ESP32) || defined(ARCH_PORTDUINO)
 #if !MESHTASTIC_EXCLUDE_STOREFORWARD
         // Check if StoreForward has packets stored for us.
-        if (!packetForPhone && storeForwardModule)
+        if (!packetForPhone && storeForwardModule && pullsFromService)
             packetForPhone = storeForwardModule->getForPhone();
 #endif
 #endif
 
-        if (!packetForPhone)
+        if (!packetForPhone && pullsFromService)
             packetForPhone = service->getForPhone();
         hasPacket = !!packetForPhone;
         // LOG_DEBUG("available hasPacket=%d\n", hasPacket);
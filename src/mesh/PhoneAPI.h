@@ -116,6 +116,9 @@ class PhoneAPI
 
     bool isConnected() { return state != STATE_SEND_NOTHING; }
 
+    /// True once the client has finished downloading our config and is ready for mesh packets
+    bool isSendingPackets() { return state == STATE_SEND_PACKETS; }
+
   protected:
     /// Our fromradio packet while it is being assembled
     meshtastic_FromRadio fromRadioScratch = {};
@@ -123,6 +126,12 @@ class PhoneAPI
     /** the last msec we heard from the client on the other side of this link */
     uint32_t lastContactMsec = 0;
 
+    /**
+     * If false we never take packets, queue status or MQTT proxy messages from the MeshService queues ourselves - used by
+     * transports that serve several clients and fan those out to all of them (i.e. EpollServerAPI)
+     */
+    bool pullsFromService = true;
+
     /// Hookable to find out when connection changes
     virtual void onConnectionChanged(bool connected) {}
 
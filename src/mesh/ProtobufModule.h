@@ -1,4 +1,5 @@
 #pragma once
+#include "DecodeCache.h"
 #include "SinglePortModule.h"
 
 /**
@@ -87,8 +88,7 @@ template <class T> class ProtobufModule : protected SinglePortModule
         T scratch;
         T *decoded = NULL;
         if (mp.which_payload_variant == meshtastic_MeshPacket_decoded_tag && mp.decoded.portnum == ourPortNum) {
-            memset(&scratch, 0, sizeof(scratch));
-            if (pb_decode_from_bytes(p.payload.bytes, p.payload.size, fields, &scratch)) {
+            if (decodeCache.decode(mp, fields, &scratch)) {
                 decoded = &scratch;
             } else {
                 LOG_ERROR("Error decoding protobuf module!\n");
@@ -107,9 +107,7 @@ template <class T> class ProtobufModule : protected SinglePortModule
         T scratch;
         T *decoded = NULL;
         if (mp.which_payload_variant == meshtastic_MeshPacket_decoded_tag && mp.decoded.portnum == ourPortNum) {
-            memset(&scratch, 0, sizeof(scratch));
-            auto &p = mp.decoded;
-            if (pb_decode_from_bytes(p.payload.bytes, p.payload.size, fields, &scratch)) {
+            if (decodeCache.decode(mp, fields, &scratch)) {
                 decoded = &scratch;
             } else {
                 LOG_ERROR("Error decoding protobuf module!\n");
@@ -275,52 +275,70 @@ uint32_t RadioInterface::getTxDelayMsecWeighted(float snr)
 void printPacket(const char *prefix, const meshtastic_MeshPacket *p)
 {
 #ifdef DEBUG_PORT
-    std::string out = DEBUG_PORT.mt_sprintf("%s (id=0x%08x fr=0x%02x to=0x%02x, WantAck=%d, HopLim=%d Ch=0x%x", prefix, p->id,
-                                            p->from & 0xff, p->to & 0xff, p->want_ack, p->hop_limit, p->channel);
+    // We are called several times for every packet, don't build a string no one will see
+    if (!DEBUG_PORT.isLevelEnabled(meshtastic_LogRecord_Level_DEBUG))
+        return;
+
+    char out[256];
+    size_t len = 0;
+    auto append = [&](const char *format, ...) __attribute__((format(printf, 2, 3)))
+    {
+        if (len >= sizeof(out))
+            return;
+        va_list arg;
+        va_start(arg, format);
+        int n = vsnprintf(out + len, sizeof(out) - len, format, arg);
+        va_end(arg);
+        if (n > 0)
+            len += n;
+    };
+
+    append("%s (id=0x%08x fr=0x%02x to=0x%02x, WantAck=%d, HopLim=%d Ch=0x%x", prefix, p->id, p->from & 0xff, p->to & 0xff,
+           p->want_ack, p->hop_limit, p->channel);
     if (p->which_payload_variant == meshtastic_MeshPacket_decoded_tag) {
         auto &s = p->decoded;
 
-        out += DEBUG_PORT.mt_sprintf(" Portnum=%d", s.portnum);
+        append(" Portnum=%d", s.portnum);
 
         if (s.want_response)
-            out += DEBUG_PORT.mt_sprintf(" WANTRESP");
+            append(" WANTRESP");
 
         if (p->pki_encrypted)
-            out += DEBUG_PORT.mt_sprintf(" PKI");
+            append(" PKI");
 
         if (s.source != 0)
-            out += DEBUG_PORT.mt_sprintf(" source=%08x", s.source);
+            append(" source=%08x", s.source);
 
         if (s.dest != 0)
-            out += DEBUG_PORT.mt_sprintf(" dest=%08x", s.dest);
+            append(" dest=%08x", s.dest);
 
         if (s.request_id)
-            out += DEBUG_PORT.mt_sprintf(" requestId=%0x", s.request_id);
+            append(" requestId=%0x", s.request_id);
 
         /* now inside Data and therefore kinda opaque
         if (s.which_ackVariant == SubPacket_success_id_tag)
-            out += DEBUG_PORT.mt_sprintf(" successId=%08x", s.ackVariant.success_id);
+            append(" successId=%08x", s.ackVariant.success_id);
         else if (s.which_ackVariant == SubPacket_fail_id_tag)
-            out += DEBUG_PORT.mt_sprintf(" failId=%08x", s.ackVariant.fail_id); */
+            append(" failId=%08x", s.ackVariant.fail_id); */
     } else {
-        out += " encrypted";
+        append(" encrypted");
     }
 
     if (p->rx_time != 0)
-        out += DEBUG_PORT.mt_sprintf(" rxtime=%u", p->rx_time);
+        append(" rxtime=%u", p->rx_time);
     if (p->rx_snr != 0.0)
-        out += DEBUG_PORT.mt_sprintf(" rxSNR=%g", p->rx_snr);
+        append(" rxSNR=%g", p->rx_snr);
     if (p->rx_rssi != 0)
-        out += DEBUG_PORT.mt_sprintf(" rxRSSI=%i", p->rx_rssi);
+        append(" rxRSSI=%i", p->rx_rssi);
     if (p->via_mqtt != 0)
-        out += DEBUG_PORT.mt_sprintf(" via MQTT");
+        append(" via MQTT");
     if (p->hop_start != 0)
-        out += DEBUG_PORT.mt_sprintf(" hopStart=%d", p->hop_start);
+        append(" hopStart=%d", p->hop_start);
     if (p->priority != 0)
-        out += DEBUG_PORT.mt_sprintf(" priority=%d", p->priority);
+        append(" priority=%d", p->priority);
 
-    out += ")";
-    LOG_DEBUG("%s\n", out.c_str());
+    append(")");
+    LOG_DEBUG("%s\n", out);
 #endif
 }
 
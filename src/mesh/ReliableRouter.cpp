@@ -29,10 +29,8 @@ ErrorCode ReliableRouter::send(meshtastic_MeshPacket *p)
     /* If we have pending retransmissions, add the airtime of this packet to it, because during that time we cannot receive an
        (implicit) ACK. Otherwise, we might retransmit too early.
      */
-    for (auto i = pending.begin(); i != pending.end(); i++) {
-        if (i->first.id != p->id) {
-            i->second.nextTxMsec += iface->getPacketTime(p);
-        }
+    if (!pending.empty()) {
+        addAirtime(iface->getPacketTime(p), findPendingPacket(GlobalPacketId(p)));
     }
 
     return FloodingRouter::send(p);
@@ -69,8 +67,8 @@ bool ReliableRouter::shouldFilterReceived(const meshtastic_MeshPacket *p)
        because while receiving this packet, we could not have received an (implicit) ACK for it.
        If we don't add this, we will likely retransmit too early.
     */
-    for (auto i = pending.begin(); i != pending.end(); i++) {
-        i->second.nextTxMsec += iface->getPacketTime(p);
+    if (!pending.empty()) {
+        addAirtime(iface->getPacketTime(p));
     }
 
     /* Resend implicit ACKs for repeated packets (hopStart equals hopLimit);
@@ -188,6 +186,7 @@ bool ReliableRouter::stopRetransmission(GlobalPacketId key)
             // now free the pooled copy for retransmission too
             packetPool.release(p);
         }
+        queueRemove(old);
         auto numErased = pending.erase(key);
         assert(numErased == 1);
         return true;
@@ -205,10 +204,12 @@ PendingPacket *ReliableRouter::startRetransmission(meshtastic_MeshPacket *p)
 
     stopRetransmission(getFrom(p), p->id);
 
-    setNextTx(&rec);
-    pending[id] = rec;
+    PendingPacket *pp = &(pending[id] = rec);
+    pp->queuePos = retransmitQueue.size();
+    retransmitQueue.push_back(pp);
+    setNextTx(pp);
 
-    return &pending[id];
+    return pp;
 }
 
 /**
@@ -217,56 +218,114 @@ PendingPacket *ReliableRouter::startRetransmission(meshtastic_MeshPacket *p)
 int32_t ReliableRouter::doRetransmissions()
 {
     uint32_t now = millis();
-    int32_t d = INT32_MAX;
-
-    // FIXME, we should use a better datastructure rather than walking through this map.
-    // for(auto el: pending) {
-    for (auto it = pending.begin(), nextIt = it; it != pending.end(); it = nextIt) {
-        ++nextIt; // we use this odd pattern because we might be deleting it...
-        auto &p = it->second;
-
-        bool stillValid = true; // assume we'll keep this record around
-
-        // FIXME, handle 51 day rolloever here!!!
-        if (p.nextTxMsec <= now) {
-            if (p.numRetransmissions == 0) {
-                LOG_DEBUG("Reliable send failed, returning a nak for fr=0x%x,to=0x%x,id=0x%x\n", p.packet->from, p.packet->to,
-                          p.packet->id);
-                sendAckNak(meshtastic_Routing_Error_MAX_RETRANSMIT, getFrom(p.packet), p.packet->id, p.packet->channel);
-                // Note: we don't stop retransmission here, instead the Nak packet gets processed in sniffReceived
-                stopRetransmission(it->first);
-                stillValid = false; // just deleted it
-            } else {
-                LOG_DEBUG("Sending reliable retransmission fr=0x%x,to=0x%x,id=0x%x, tries left=%d\n", p.packet->from,
-                          p.packet->to, p.packet->id, p.numRetransmissions);
 
-                // Note: we call the superclass version because we don't want to have our version of send() add a new
-                // retransmission record
-                FloodingRouter::send(packetPool.allocCopy(*p.packet));
-
-                // Queue again
-                --p.numRetransmissions;
-                setNextTx(&p);
-            }
+    // Only the records that are due are touched, they are all at the top of retransmitQueue
+    while (!retransmitQueue.empty()) {
+        PendingPacket &p = *retransmitQueue.front();
+        int32_t t = p.nextTxMsec + airtimeOffset - now;
+        if (t > 0) {
+            // Update our desired sleep delay
+            return t;
         }
 
-        if (stillValid) {
-            // Update our desired sleep delay
-            int32_t t = p.nextTxMsec - now;
+        if (p.numRetransmissions == 0) {
+            LOG_DEBUG("Reliable send failed, returning a nak for fr=0x%x,to=0x%x,id=0x%x\n", p.packet->from, p.packet->to,
+                      p.packet->id);
+            auto key = GlobalPacketId(p.packet);
+            sendAckNak(meshtastic_Routing_Error_MAX_RETRANSMIT, getFrom(p.packet), p.packet->id, p.packet->channel);
+            // Note: we don't stop retransmission here, instead the Nak packet gets processed in sniffReceived
+            stopRetransmission(key);
+        } else {
+            LOG_DEBUG("Sending reliable retransmission fr=0x%x,to=0x%x,id=0x%x, tries left=%d\n", p.packet->from, p.packet->to,
+                      p.packet->id, p.numRetransmissions);
+
+            // Note: we call the superclass version because we don't want to have our version of send() add a new
+            // retransmission record
+            FloodingRouter::send(packetPool.allocCopy(*p.packet));
 
-            d = min(t, d);
+            // Queue again
+            --p.numRetransmissions;
+            setNextTx(&p);
         }
     }
 
-    return d;
+    return INT32_MAX;
 }
 
 void ReliableRouter::setNextTx(PendingPacket *pending)
 {
     assert(iface);
     auto d = iface->getRetransmissionMsec(pending->packet);
-    pending->nextTxMsec = millis() + d;
+    pending->nextTxMsec = millis() + d - airtimeOffset;
+    // The timer may have moved either way (or the record was just added at the bottom), at most one of these moves it
+    queueSiftUp(pending->queuePos);
+    queueSiftDown(pending->queuePos);
     LOG_DEBUG("Setting next retransmission in %u msecs: ", d);
     printPacket("", pending->packet);
     setReceivedMessage(); // Run ASAP, so we can figure out our correct sleep time
-}
\ No newline at end of file
+}
+
+void ReliableRouter::addAirtime(uint32_t msec, PendingPacket *except)
+{
+    airtimeOffset += msec;
+
+    // Moving one timer back keeps the heap order for everything but that timer
+    if (except) {
+        except->nextTxMsec -= msec;
+        queueSiftUp(except->queuePos);
+    }
+}
+
+void ReliableRouter::queueSiftUp(size_t pos)
+{
+    PendingPacket *p = retransmitQueue[pos];
+    while (pos > 0) {
+        size_t parent = (pos - 1) / 2;
+        if (!isDueBefore(p, retransmitQueue[parent]))
+            break;
+        retransmitQueue[pos] = retransmitQueue[parent];
+        retransmitQueue[pos]->queuePos = pos;
+        pos = parent;
+    }
+    retransmitQueue[pos] = p;
+    p->queuePos = pos;
+}
+
+void ReliableRouter::queueSiftDown(size_t pos)
+{
+    size_t n = retransmitQueue.size();
+    PendingPacket *p = retransmitQueue[pos];
+    for (;;) {
+        size_t child = 2 * pos + 1;
+        if (child >= n)
+            break;
+        if (child + 1 < n && isDueBefore(retransmitQueue[child + 1], retransmitQueue[child]))
+            child++;
+        if (!isDueBefore(retransmitQueue[child], p))
+            break;
+        retransmitQueue[pos] = retransmitQueue[child];
+        retransmitQueue[pos]->queuePos = pos;
+        pos = child;
+    }
+    retransmitQueue[pos] = p;
+    p->queuePos = pos;
+}
+
+void ReliableRouter::queueRemove(PendingPacket *pending)
+{
+    size_t pos = pending->queuePos;
+    assert(pos < retransmitQueue.size() && retransmitQueue[pos] == pending);
+
+    PendingPacket *last = retransmitQueue.back();
+    retransmitQueue.pop_back();
+    if (last == pending)
+        return;
+
+    // Move the last record into the hole, it may need to go either way
+    retransmitQueue[pos] = last;
+    last->queuePos = pos;
+    if (pos > 0 && isDueBefore(last, retransmitQueue[(pos - 1) / 2]))
+        queueSiftUp(pos);
+    else
+        queueSiftDown(pos);
+}
@@ -2,6 +2,7 @@
 
 #include "FloodingRouter.h"
 #include <unordered_map>
+#include <vector>
 
 /**
  * An identifier for a globalally unique message - a pair of the sending nodenum and the packet id assigned
@@ -32,9 +33,12 @@ struct GlobalPacketId {
 struct PendingPacket {
     meshtastic_MeshPacket *packet;
 
-    /** The next time we should try to retransmit this packet */
+    /** The next time we should try to retransmit this packet, in millis() minus ReliableRouter::airtimeOffset at that time */
     uint32_t nextTxMsec = 0;
 
+    /** Where this packet is in ReliableRouter::retransmitQueue */
+    size_t queuePos = 0;
+
     /** Starts at NUM_RETRANSMISSIONS -1(normally 3) and counts down.  Once zero it will be removed from the list */
     uint8_t numRetransmissions = 0;
 
@@ -56,6 +60,15 @@ class ReliableRouter : public FloodingRouter
   private:
     std::unordered_map<GlobalPacketId, PendingPacket, GlobalPacketIdHashFunction> pending;
 
+    /** Min-heap of the records in pending (whose addresses are stable) ordered by nextTxMsec, the next one due is on top */
+    std::vector<PendingPacket *> retransmitQueue;
+
+    /**
+     * Airtime we couldn't hear acks in is added to every pending timer.  Rather than walking them all we keep the total here
+     * and store timers relative to it, so a packet is due at nextTxMsec + airtimeOffset.
+     */
+    uint32_t airtimeOffset = 0;
+
   public:
     /**
      * Constructor
@@ -120,4 +133,16 @@ class ReliableRouter : public FloodingRouter
     int32_t doRetransmissions();
 
     void setNextTx(PendingPacket *pending);
+
+    /** Delay every pending retransmission (except 'except', if set) by 'msec' */
+    void addAirtime(uint32_t msec, PendingPacket *except = NULL);
+
+    // retransmitQueue helpers
+    static bool isDueBefore(const PendingPacket *a, const PendingPacket *b)
+    {
+        return (int32_t)(a->nextTxMsec - b->nextTxMsec) < 0; // wrap safe
+    }
+    void queueSiftUp(size_t pos);
+    void queueSiftDown(size_t pos);
+    void queueRemove(PendingPacket *pending);
 };
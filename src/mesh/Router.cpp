@@ -1,6 +1,7 @@
 #include "Router.h"
 #include "Channels.h"
 #include "CryptoEngine.h"
+#include "DecodeCache.h"
 #include "MeshRadio.h"
 #include "MeshService.h"
 #include "NodeDB.h"
@@ -31,14 +32,50 @@
     (MAX_RX_TOPHONE + MAX_RX_FROMRADIO + 2 * MAX_TX_QUEUE +                                                                      \
      2) // max number of packets which can be in flight (either queued from reception or queued for sending)
 
-// static MemoryPool<MeshPacket> staticPool(MAX_PACKETS);
+// MemoryPool needs FreeRTOS to lock its free list.  The targets without it use the heap: portduino only knows MAX_RX_TOPHONE
+// once it has read its config file, and the STM32WL can't spare the RAM for a fixed slab anyway
+#ifdef HAS_FREE_RTOS
+static MemoryPool<meshtastic_MeshPacket, MAX_PACKETS> staticPool;
+#else
 static MemoryDynamic<meshtastic_MeshPacket> staticPool;
+#endif
 
 Allocator<meshtastic_MeshPacket> &packetPool = staticPool;
 
 static uint8_t bytes[MAX_RHPACKETLEN];
 static uint8_t ScratchEncrypted[MAX_RHPACKETLEN];
 
+/**
+ * Quick sanity check of decrypted bytes before handing them to nanopb.
+ *
+ * Every encoder we know of writes fields in field number order and a valid Data always has a nonzero portnum, so the
+ * first byte must be the tag of one of the Data fields (normally portnum, 0x08) with the matching wire type.  A wrong key
+ * produces random bytes, which fail this about 97% of the time.
+ */
+static bool looksLikeData(const uint8_t *buf, size_t len)
+{
+    if (len < 2)
+        return false;
+
+    uint8_t fieldNum = buf[0] >> 3, wireType = buf[0] & 0x07;
+    switch (fieldNum) {
+    case meshtastic_Data_portnum_tag:
+        return wireType == PB_WT_VARINT && buf[1] != 0; // an explicit zero portnum would be UNKNOWN_APP anyway
+    case meshtastic_Data_payload_tag:
+        return wireType == PB_WT_STRING;
+    case meshtastic_Data_want_response_tag:
+        return wireType == PB_WT_VARINT;
+    case meshtastic_Data_dest_tag:
+    case meshtastic_Data_source_tag:
+    case meshtastic_Data_request_id_tag:
+    case meshtastic_Data_reply_id_tag:
+    case meshtastic_Data_emoji_tag:
+        return wireType == PB_WT_32BIT;
+    default:
+        return false;
+    }
+}
+
 /**
  * Constructor
  *
@@ -255,21 +292,28 @@ ErrorCode Router::send(meshtastic_MeshPacket *p)
     // If the packet is not yet encrypted, do so now
     if (p->which_payload_variant == meshtastic_MeshPacket_decoded_tag) {
         ChannelIndex chIndex = p->channel; // keep as a local because we are about to change it
-        meshtastic_MeshPacket *p_decoded = packetPool.allocCopy(*p);
+
+        // Only keep a decoded copy if MQTT is going to want it
+        meshtastic_MeshPacket *p_decoded = NULL;
+#if !MESHTASTIC_EXCLUDE_MQTT
+        // Only publish to MQTT if we're the original transmitter of the packet
+        if (moduleConfig.mqtt.enabled && p->from == nodeDB->getNodeNum() && mqtt)
+            p_decoded = packetPool.allocCopy(*p);
+#endif
 
         auto encodeResult = perhapsEncode(p);
         if (encodeResult != meshtastic_Routing_Error_NONE) {
-            packetPool.release(p_decoded);
+            if (p_decoded)
+                packetPool.release(p_decoded);
             abortSendAndNak(encodeResult, p);
             return encodeResult; // FIXME - this isn't a valid ErrorCode
         }
 #if !MESHTASTIC_EXCLUDE_MQTT
-        // Only publish to MQTT if we're the original transmitter of the packet
-        if (moduleConfig.mqtt.enabled && p->from == nodeDB->getNodeNum() && mqtt) {
+        if (p_decoded) {
             mqtt->onSend(*p, *p_decoded, chIndex);
+            packetPool.release(p_decoded);
         }
 #endif
-        packetPool.release(p_decoded);
     }
 
     assert(iface); // This should have been detected already in sendLocal (or we just received a packet from outside)
@@ -347,21 +391,38 @@ bool perhapsDecode(meshtastic_MeshPacket *p)
 
     // assert(p->which_payloadVariant == MeshPacket_encrypted_tag);
     if (!decrypted) {
-        // Try to find a channel that works with this hash
-        for (chIndex = 0; chIndex < channels.getNumChannels(); chIndex++) {
+        // Only try the channels whose hash matches, in channel index order
+        uint8_t candidates = channels.getChannelsForHash(p->channel);
+        for (chIndex = 0; candidates != 0; chIndex++) {
+            if (!(candidates & (1 << chIndex)))
+                continue;
+            candidates &= ~(1 << chIndex);
+
             // Try to use this hash/channel pair
             if (channels.decryptForHash(chIndex, p->channel)) {
+                // Start from the ciphertext again, a previous candidate may have left its wrong-key output in bytes
+                memcpy(bytes, ScratchEncrypted, rawSize);
+
                 // Try to decrypt the packet if we can
                 crypto->decrypt(p->from, p->id, rawSize, bytes);
 
                 // printBytes("plaintext", bytes, p->encrypted.size);
 
+                // Cheaply reject most wrong keys before running the full decoder
+                if (!looksLikeData(bytes, rawSize)) {
+                    LOG_DEBUG("Packet id=0x%08x doesn't look like Data with channel %d (hash collision?)\n", p->id, chIndex);
+                    channels.countWastedDecrypt(chIndex);
+                    continue;
+                }
+
                 // Take those raw bytes and convert them back into a well structured protobuf we can understand
                 memset(&p->decoded, 0, sizeof(p->decoded));
                 if (!pb_decode_from_bytes(bytes, rawSize, &meshtastic_Data_msg, &p->decoded)) {
                     LOG_ERROR("Invalid protobufs in received mesh packet id=0x%08x (bad psk?)!\n", p->id);
+                    channels.countWastedDecrypt(chIndex);
                 } else if (p->decoded.portnum == meshtastic_PortNum_UNKNOWN_APP) {
                     LOG_ERROR("Invalid portnum (bad psk?)!\n");
+                    channels.countWastedDecrypt(chIndex);
                 } else {
                     decrypted = true;
                     break;
@@ -398,13 +459,14 @@ bool perhapsDecode(meshtastic_MeshPacket *p)
 #if ENABLE_JSON_LOGGING
         LOG_TRACE("%s\n", MeshPacketSerializer::JsonSerialize(p, false).c_str());
 #elif ARCH_PORTDUINO
-        if (settingsStrings[traceFilename] != "" || settingsMap[logoutputlevel] == level_trace) {
+        if (settingsStrings[traceFilename] != "" || DEBUG_PORT.isLevelEnabled(meshtastic_LogRecord_Level_TRACE)) {
             LOG_TRACE("%s\n", MeshPacketSerializer::JsonSerialize(p, false).c_str());
         }
 #endif
         return true;
     } else {
-        LOG_WARN("No suitable channel found for decoding, hash was 0x%x!\n", p->channel);
+        LOG_WARN("No suitable channel found for decoding, hash was 0x%x (candidate channels 0x%02x)!\n", p->channel,
+                 channels.getChannelsForHash(p->channel));
         return false;
     }
 }
@@ -538,8 +600,14 @@ void Router::handleReceived(meshtastic_MeshPacket *p, RxSource src)
     bool skipHandle = false;
     // Also, we should set the time from the ISR and it should have msec level resolution
     p->rx_time = getValidTime(RTCQualityFromNet); // store the arrival timestamp for the phone
-    // Store a copy of encrypted packet for MQTT
-    meshtastic_MeshPacket *p_encrypted = packetPool.allocCopy(*p);
+    // Store a copy of the encrypted packet for MQTT, but only if we would publish it.  Packets that came from MQTT are never
+    // published again and packets that arrive already decoded are the same either way, so neither needs a copy.
+    meshtastic_MeshPacket *p_encrypted = NULL;
+#if !MESHTASTIC_EXCLUDE_MQTT
+    if (moduleConfig.mqtt.enabled && mqtt && !p->via_mqtt && getFrom(p) != nodeDB->getNodeNum() &&
+        p->which_payload_variant == meshtastic_MeshPacket_encrypted_tag)
+        p_encrypted = packetPool.allocCopy(*p);
+#endif
 
     // Take those raw bytes and convert them back into a well structured protobuf we can understand
     bool decoded = perhapsDecode(p);
@@ -580,16 +648,24 @@ void Router::handleReceived(meshtastic_MeshPacket *p, RxSource src)
 
     // call modules here
     if (!skipHandle) {
+        DecodeCacheStats decodesBefore = decodeCache.getStats();
+
         MeshModule::callModules(*p, src);
 
 #if !MESHTASTIC_EXCLUDE_MQTT
         // After potentially altering it, publish received message to MQTT if we're not the original transmitter of the packet
         if (decoded && moduleConfig.mqtt.enabled && getFrom(p) != nodeDB->getNodeNum() && mqtt)
-            mqtt->onSend(*p_encrypted, *p, p->channel);
+            mqtt->onSend(p_encrypted ? *p_encrypted : *p, *p, p->channel);
 #endif
+
+        const DecodeCacheStats &decodesAfter = decodeCache.getStats();
+        if (decodesAfter.hits != decodesBefore.hits)
+            LOG_DEBUG("Payload decoded %u times for %u consumers\n", decodesAfter.decodes - decodesBefore.decodes,
+                      decodesAfter.decodes + decodesAfter.hits - decodesBefore.decodes - decodesBefore.hits);
     }
 
-    packetPool.release(p_encrypted); // Release the encrypted packet
+    if (p_encrypted)
+        packetPool.release(p_encrypted); // Release the encrypted packet
 }
 
 void Router::perhapsHandleReceived(meshtastic_MeshPacket *p)
@@ -600,7 +676,7 @@ void Router::perhapsHandleReceived(meshtastic_MeshPacket *p)
     LOG_TRACE("%s\n", MeshPacketSerializer::JsonSerializeEncrypted(p).c_str());
 #elif ARCH_PORTDUINO
     // Even ignored packets get logged in the trace
-    if (settingsStrings[traceFilename] != "" || settingsMap[logoutputlevel] == level_trace) {
+    if (settingsStrings[traceFilename] != "" || DEBUG_PORT.isLevelEnabled(meshtastic_LogRecord_Level_TRACE)) {
         p->rx_time = getValidTime(RTCQualityFromNet); // store the arrival timestamp for the phone
         LOG_TRACE("%s\n", MeshPacketSerializer::JsonSerializeEncrypted(p).c_str());
     }
@@ -3,9 +3,9 @@
 #include "RTC.h"
 #include "configuration.h"
 
-#define START1 0x94
-#define START2 0xc3
-#define HEADER_LEN 4
+#define START1 StreamFrameParser::START1
+#define START2 StreamFrameParser::START2
+#define HEADER_LEN StreamFrameParser::HEADER_LEN
 
 int32_t StreamAPI::runOncePart()
 {
@@ -21,53 +21,38 @@ int32_t StreamAPI::runOncePart()
 int32_t StreamAPI::readStream()
 {
     uint32_t now = millis();
-    if (!stream->available()) {
+    int avail = stream->available();
+    if (avail <= 0) {
         // Nothing available this time, if the computer has talked to us recently, poll often, otherwise let CPU sleep a long time
         bool recentRx = (now - lastRxMsec) < 2000;
         return recentRx ? 5 : 250;
     } else {
-        while (stream->available()) { // Currently we never want to block
-            int cInt = stream->read();
-            if (cInt < 0)
-                break; // We ran out of characters (even though available said otherwise) - this can happen on rf52 adafruit
-                       // arduino
-
-            uint8_t c = (uint8_t)cInt;
-
-            // Use the read pointer for a little state machine, first look for framing, then length bytes, then payload
-            size_t ptr = rxPtr;
-
-            rxPtr++;        // assume we will probably advance the rxPtr
-            rxBuf[ptr] = c; // store all bytes (including framing)
-
-            // console->printf("rxPtr %d ptr=%d c=0x%x\n", rxPtr, ptr, c);
-
-            if (ptr == 0) { // looking for START1
-                if (c != START1)
-                    rxPtr = 0;     // failed to find framing
-            } else if (ptr == 1) { // looking for START2
-                if (c != START2)
-                    rxPtr = 0;                             // failed to find framing
-            } else if (ptr >= HEADER_LEN - 1) {            // we have at least read our 4 byte framing
-                uint32_t len = (rxBuf[2] << 8) + rxBuf[3]; // big endian 16 bit length follows framing
-
-                // console->printf("len %d\n", len);
-
-                if (ptr == HEADER_LEN - 1) {
-                    // we _just_ finished our 4 byte header, validate length now (note: a length of zero is a valid
-                    // protobuf also)
-                    if (len > MAX_TO_FROM_RADIO_SIZE)
-                        rxPtr = 0; // length is bogus, restart search for framing
-                }
-
-                if (rxPtr != 0)                        // Is packet still considered 'good'?
-                    if (ptr + 1 >= len + HEADER_LEN) { // have we received all of the payload?
-                        rxPtr = 0;                     // start over again on the next packet
-
-                        // If we didn't just fail the packet and we now have the right # of bytes, parse it
-                        handleToRadio(rxBuf + HEADER_LEN, len);
-                    }
+        // Take everything that is already buffered in blocks.  We only ask for what available() promised, so this never waits
+        // for the stream timeout.
+        uint8_t block[128];
+        while (avail > 0) {
+            size_t want = min((size_t)avail, sizeof(block));
+#ifdef ARCH_NRF52
+            // available() can over-report on rf52 adafruit arduino, so don't let readBytes() sit waiting for the stream timeout
+            size_t n = 0;
+            int cInt;
+            while (n < want && (cInt = stream->read()) >= 0)
+                block[n++] = (uint8_t)cInt;
+#else
+            size_t n = stream->readBytes(block, want);
+#endif
+            if (n == 0)
+                break; // We ran out of characters (even though available said otherwise)
+
+            size_t used = 0;
+            while (used < n) {
+                bool gotFrame;
+                used += rxParser.parse(block + used, n - used, gotFrame);
+                if (gotFrame)
+                    handleToRadio(rxParser.getPayload(), rxParser.getPayloadLen());
             }
+
+            avail = stream->available();
         }
 
         // we had bytes available this time, so assume we might have them next time also
@@ -82,19 +67,22 @@ int32_t StreamAPI::readStream()
 void StreamAPI::writeStream()
 {
     if (canWrite) {
+        // Send every packet we can, but only wait for the stream to drain once at the end
+        bool wrote = false;
         uint32_t len;
-        do {
-            // Send every packet we can
-            len = getFromRadio(txBuf + HEADER_LEN);
-            emitTxBuffer(len);
-        } while (len);
+        while ((len = getFromRadio(txBuf + HEADER_LEN)) != 0) {
+            emitTxBuffer(len, false);
+            wrote = true;
+        }
+        if (wrote)
+            stream->flush();
     }
 }
 
 /**
  * Send the current txBuffer over our stream
  */
-void StreamAPI::emitTxBuffer(size_t len)
+void StreamAPI::emitTxBuffer(size_t len, bool flush)
 {
     if (len != 0) {
         txBuf[0] = START1;
@@ -104,7 +92,17 @@ void StreamAPI::emitTxBuffer(size_t len)
 
         auto totalLen = len + HEADER_LEN;
         stream->write(txBuf, totalLen);
-        stream->flush();
+        if (flush)
+            stream->flush();
+    }
+}
+
+void StreamAPI::wake()
+{
+    // Touching readerThread's schedule from here would race with the main loop, leave that to its shouldRun()
+    if (readerThread) {
+        wakePending = true;
+        concurrency::mainDelay.interrupt();
     }
 }
 
@@ -2,7 +2,9 @@
 
 #include "PhoneAPI.h"
 #include "Stream.h"
+#include "StreamFrameParser.h"
 #include "concurrency/OSThread.h"
+#include <atomic>
 
 // A To/FromRadio packet + our 32 bit header
 #define MAX_STREAM_BUF_SIZE (MAX_TO_FROM_RADIO_SIZE + sizeof(uint32_t))
@@ -35,8 +37,7 @@ class StreamAPI : public PhoneAPI
      */
     Stream *stream;
 
-    uint8_t rxBuf[MAX_STREAM_BUF_SIZE] = {0};
-    size_t rxPtr = 0;
+    StreamFrameParser rxParser;
 
     /// time of last rx, used, to slow down our polling if we haven't heard from anyone
     uint32_t lastRxMsec = 0;
@@ -50,6 +51,12 @@ class StreamAPI : public PhoneAPI
      */
     virtual int32_t runOncePart();
 
+    /**
+     * Get readerThread to run right away instead of waiting out its polling interval.  This only raises a flag and interrupts
+     * mainDelay, so it is safe to call from a data-ready callback on another task (where the platform has one).
+     */
+    void wake();
+
   private:
     /**
      * Read any rx chars from the link and call handleToRadio
@@ -62,6 +69,18 @@ class StreamAPI : public PhoneAPI
     void writeStream();
 
   protected:
+    /// The thread that calls runOncePart(), subclasses set this so wake() can reach it
+    concurrency::OSThread *readerThread = NULL;
+
+    /// Set by wake(), readerThread's shouldRun() takes it (on the main thread) to run early
+    std::atomic<bool> wakePending{false};
+
+    /// For readerThread's shouldRun(): true (once) if wake() was called since we last asked
+    bool takeWake() { return wakePending.exchange(false); }
+
+    /// Mesh packets for the phone are waiting, deliver them now rather than at our next poll
+    virtual void onNowHasData(uint32_t fromRadioNum) override { wake(); }
+
     /**
      * Send a FromRadio.rebooted = true packet to the phone
      */
@@ -74,8 +93,10 @@ class StreamAPI : public PhoneAPI
 
     /**
      * Send the current txBuffer over our stream
+     *
+     * @param flush wait for the stream to drain, callers sending a batch only flush after the last frame
      */
-    void emitTxBuffer(size_t len);
+    void emitTxBuffer(size_t len, bool flush = true);
 
     /// Are we allowed to write packets to our output stream (subclasses can turn this off - i.e. SerialConsole)
     bool canWrite = true;
@@ -0,0 +1,53 @@
+#include "StreamFrameParser.h"
+
+#include <string.h>
+
+const uint8_t StreamFrameParser::START1;
+const uint8_t StreamFrameParser::START2;
+const size_t StreamFrameParser::HEADER_LEN;
+
+size_t StreamFrameParser::parse(const uint8_t *data, size_t len, bool &gotFrame)
+{
+    size_t i = 0;
+    gotFrame = false;
+
+    while (i < len) {
+        if (pos < HEADER_LEN) {
+            // Use the read pointer for a little state machine, first look for framing, then length bytes
+            uint8_t c = data[i++];
+            if ((pos == 0 && c != START1) || (pos == 1 && c != START2)) {
+                // failed to find framing, but this byte might be the start of the next frame
+                pos = 0;
+                if (c == START1)
+                    buf[pos++] = c;
+                continue;
+            }
+
+            buf[pos++] = c;
+            if (pos < HEADER_LEN)
+                continue;
+
+            // we _just_ finished our 4 byte header, validate length now (note: a length of zero is a valid protobuf also)
+            if (getPayloadLen() > MAX_TO_FROM_RADIO_SIZE) {
+                pos = 0; // length is bogus, restart search for framing
+                continue;
+            }
+        } else {
+            // Take as much of the payload as this block has
+            size_t n = HEADER_LEN + getPayloadLen() - pos;
+            if (n > len - i)
+                n = len - i;
+            memcpy(buf + pos, data + i, n);
+            pos += n;
+            i += n;
+        }
+
+        if (pos == HEADER_LEN + getPayloadLen()) {
+            pos = 0; // start over again on the next packet
+            gotFrame = true;
+            break;
+        }
+    }
+
+    return i;
+}
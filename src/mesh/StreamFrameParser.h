@@ -0,0 +1,35 @@
+#pragma once
+
+#include "PhoneAPI.h"
+
+/**
+ * Finds our 0x94C3 framed protobufs (see StreamAPI for the wire encoding) in a byte stream that arrives in arbitrary blocks.
+ *
+ * Framing is searched a byte at a time, but once we have a header the payload is copied in one go, so feeding it whole
+ * reads from a socket or UART costs little more than a memcpy.
+ */
+class StreamFrameParser
+{
+  public:
+    static const uint8_t START1 = 0x94;
+    static const uint8_t START2 = 0xc3;
+    static const size_t HEADER_LEN = 4;
+
+    /**
+     * Consume bytes from 'data' until we run out or complete a frame.
+     *
+     * @return the number of bytes used, if 'gotFrame' is set the frame is available from getPayload()/getPayloadLen() until
+     * the next call
+     */
+    size_t parse(const uint8_t *data, size_t len, bool &gotFrame);
+
+    const uint8_t *getPayload() const { return buf + HEADER_LEN; }
+    size_t getPayloadLen() const { return (buf[2] << 8) + buf[3]; } // big endian 16 bit length follows framing
+
+    /// Forget any partial frame
+    void reset() { pos = 0; }
+
+  private:
+    uint8_t buf[MAX_TO_FROM_RADIO_SIZE + HEADER_LEN] = {0};
+    size_t pos = 0; // bytes of the current frame (header included) we have so far
+};
@@ -0,0 +1,386 @@
+#include "EpollServerAPI.h"
+
+#ifdef ARCH_PORTDUINO
+
+#include "MeshService.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define START1 StreamFrameParser::START1
+#define START2 StreamFrameParser::START2
+#define HEADER_LEN StreamFrameParser::HEADER_LEN
+
+/// Scratch space for encoding, everything runs on our one thread
+static uint8_t encodeBuf[meshtastic_FromRadio_size];
+
+static APIFrame makeFrame(const uint8_t *payload, size_t len)
+{
+    auto frame = std::make_shared<std::vector<uint8_t>>(len + HEADER_LEN);
+    uint8_t *p = frame->data();
+    p[0] = START1;
+    p[1] = START2;
+    p[2] = (len >> 8) & 0xff;
+    p[3] = len & 0xff;
+    memcpy(p + HEADER_LEN, payload, len);
+    return frame;
+}
+
+EpollClientAPI::EpollClientAPI(int _fd) : fd(_fd)
+{
+    pullsFromService = false; // EpollServerPort fans mesh traffic out to us
+}
+
+EpollClientAPI::~EpollClientAPI()
+{
+    close(); // PhoneAPI state, must happen before the socket goes away
+    ::close(fd);
+}
+
+void EpollClientAPI::enqueue(const APIFrame &frame, bool droppable)
+{
+    if (txQueue.size() >= MAX_API_CLIENT_QUEUE) {
+        // Drop the oldest mesh packet we haven't started writing, a partially written one has to be finished to keep the
+        // framing.  Anything else (queue status, MQTT proxy messages) the client can't do without.
+        auto oldest = txQueue.begin();
+        if (txOffset != 0)
+            ++oldest;
+        oldest = std::find_if(oldest, txQueue.end(), [](const QueuedAPIFrame &q) { return q.droppable; });
+        if (oldest != txQueue.end()) {
+            txQueue.erase(oldest);
+            droppedFrames++;
+        } else if (txQueue.size() >= 2 * MAX_API_CLIENT_QUEUE) {
+            LOG_WARN("TCP API client is not reading, disconnecting it\n");
+            open = false;
+            return;
+        }
+    }
+    txQueue.push_back({frame, droppable});
+}
+
+bool EpollClientAPI::readSocket()
+{
+    uint8_t buf[1024];
+    for (;;) {
+        ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+        if (n > 0) {
+            size_t used = 0;
+            while (used < (size_t)n) {
+                bool gotFrame;
+                used += rxParser.parse(buf + used, n - used, gotFrame);
+                if (gotFrame)
+                    handleToRadio(rxParser.getPayload(), rxParser.getPayloadLen());
+            }
+        }
+        else if (n == 0)
+            return false; // orderly shutdown
+        else if (errno == EINTR)
+            continue;
+        else
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+}
+
+bool EpollClientAPI::pullFromPhoneAPI()
+{
+    // Only generate records as fast as the client reads them, so a big config download can't blow out the queue
+    while (txQueue.size() < MAX_API_CLIENT_QUEUE) {
+        size_t len = getFromRadio(encodeBuf);
+        if (len == 0)
+            return false;
+        txQueue.push_back({makeFrame(encodeBuf, len), false});
+    }
+    return true;
+}
+
+bool EpollClientAPI::writeSocket()
+{
+    while (!txQueue.empty()) {
+        const std::vector<uint8_t> &frame = *txQueue.front().frame;
+        ssize_t n = ::send(fd, frame.data() + txOffset, frame.size() - txOffset, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+
+        txOffset += n;
+        if (txOffset < frame.size())
+            return true; // socket buffer is full, wait for EPOLLOUT
+        txQueue.pop_front();
+        txOffset = 0;
+    }
+    return true;
+}
+
+EpollServerPort::EpollServerPort(int _port) : concurrency::OSThread("ApiServer"), port(_port) {}
+
+EpollServerPort::~EpollServerPort()
+{
+    if (watcher.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(watchMutex);
+            stopping = true;
+        }
+        watchCond.notify_one();
+        uint64_t one = 1;
+        if (::write(stopFd, &one, sizeof(one)) < 0)
+            LOG_WARN("API server can't stop its socket watcher, errno=%d\n", errno);
+        watcher.join();
+    }
+    if (stopFd >= 0)
+        ::close(stopFd);
+
+    for (auto c : clients)
+        delete c;
+    clients.clear();
+
+    if (epollFd >= 0)
+        ::close(epollFd);
+    if (listenFd >= 0)
+        ::close(listenFd);
+}
+
+bool EpollServerPort::init()
+{
+    listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenFd < 0) {
+        LOG_ERROR("API server socket() failed, errno=%d\n", errno);
+        return false;
+    }
+
+    int one = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(listenFd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(listenFd, SOMAXCONN) < 0) {
+        LOG_ERROR("API server can't listen on TCP port %d, errno=%d\n", port, errno);
+        return false;
+    }
+
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0) {
+        LOG_ERROR("API server epoll_create1() failed, errno=%d\n", errno);
+        return false;
+    }
+
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL; // NULL marks the listening socket
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &ev);
+
+    stopFd = eventfd(0, EFD_CLOEXEC);
+    if (stopFd < 0) {
+        LOG_ERROR("API server eventfd() failed, errno=%d\n", errno);
+        return false;
+    }
+    watcher = std::thread(&EpollServerPort::watchSockets, this);
+
+    fromNumObserver.observe(&service->fromNumChanged);
+    return true;
+}
+
+void EpollServerPort::watchSockets()
+{
+    // The epoll fd is readable whenever it has events for us, we don't take them here, runOnce() does
+    struct pollfd fds[2] = {{epollFd, POLLIN, 0}, {stopFd, POLLIN, 0}};
+    std::unique_lock<std::mutex> lock(watchMutex);
+    while (!stopping) {
+        lock.unlock();
+        int n = poll(fds, 2, -1);
+        lock.lock();
+        if (stopping)
+            break;
+        if (n < 0 && errno != EINTR) {
+            LOG_ERROR("API server poll() failed, errno=%d\n", errno);
+            break;
+        }
+        if (n > 0 && (fds[0].revents & POLLIN)) {
+            // Only the flag and the delay, our OSThread state belongs to the main loop
+            socketsReady = true;
+            concurrency::mainDelay.interrupt();
+
+            // Level triggered, so wait until runOnce() has taken these events before we look again
+            watchCond.wait(lock, [this] { return !socketsReady || stopping; });
+        }
+    }
+}
+
+void EpollServerPort::acceptClients()
+{
+    for (;;) {
+        int fd = accept4(listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR)
+                continue;
+            break; // EAGAIN - no more pending connections
+        }
+
+        if (clients.size() >= MAX_API_CLIENTS) {
+            LOG_WARN("Refusing TCP API connection, already serving %d clients\n", (int)clients.size());
+            ::close(fd);
+            continue;
+        }
+
+        // Our frames are small and latency matters more than packing them
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        auto c = new EpollClientAPI(fd);
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.ptr = c;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev);
+        clients.push_back(c);
+        LOG_INFO("Incoming TCP API connection, %d clients\n", (int)clients.size());
+    }
+}
+
+void EpollServerPort::closeClient(EpollClientAPI *c)
+{
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, c->fd, NULL);
+    if (c->droppedFrames)
+        LOG_WARN("TCP API client dropped %u packets because it was not reading\n", c->droppedFrames);
+    clients.erase(std::find(clients.begin(), clients.end(), c));
+    delete c;
+    LOG_INFO("TCP API client disconnected, %d clients\n", (int)clients.size());
+}
+
+void EpollServerPort::updateEvents(EpollClientAPI *c)
+{
+    bool wantWrite = !c->txQueue.empty();
+    if (wantWrite != c->waitingForWrite) {
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN | EPOLLRDHUP | (wantWrite ? EPOLLOUT : 0);
+        ev.data.ptr = c;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, c->fd, &ev);
+        c->waitingForWrite = wantWrite;
+    }
+}
+
+void EpollServerPort::broadcast(bool droppable)
+{
+    size_t len = pb_encode_to_bytes(encodeBuf, meshtastic_FromRadio_size, &meshtastic_FromRadio_msg, &fromRadioScratch);
+    APIFrame frame = makeFrame(encodeBuf, len);
+    for (auto c : clients) {
+        if (c->isSendingPackets())
+            c->enqueue(frame, droppable);
+    }
+}
+
+bool EpollServerPort::fanout()
+{
+    // If no one is ready for packets leave them in the MeshService queues, like a single client that is still configuring
+    bool anyReady = false;
+    for (auto c : clients)
+        anyReady |= c->isSendingPackets();
+    if (!anyReady)
+        return false;
+
+    bool any = false;
+    while (auto qs = service->getQueueStatusForPhone()) {
+        memset(&fromRadioScratch, 0, sizeof(fromRadioScratch));
+        fromRadioScratch.which_payload_variant = meshtastic_FromRadio_queueStatus_tag;
+        fromRadioScratch.queueStatus = *qs;
+        service->releaseQueueStatusToPool(qs);
+        broadcast(false);
+        any = true;
+    }
+    while (auto m = service->getMqttClientProxyMessageForPhone()) {
+        memset(&fromRadioScratch, 0, sizeof(fromRadioScratch));
+        fromRadioScratch.which_payload_variant = meshtastic_FromRadio_mqttClientProxyMessage_tag;
+        fromRadioScratch.mqttClientProxyMessage = *m;
+        service->releaseMqttClientProxyMessageToPool(m);
+        broadcast(false);
+        any = true;
+    }
+#if !MESHTASTIC_EXCLUDE_STOREFORWARD
+    // An S&F server keeps text messages out of the phone queue (see MeshService::sendToPhone), they come from its history
+    while (auto p = storeForwardModule ? storeForwardModule->getForPhone() : NULL) {
+        printPacket("phone downloaded S&F packet", p);
+        memset(&fromRadioScratch, 0, sizeof(fromRadioScratch));
+        fromRadioScratch.which_payload_variant = meshtastic_FromRadio_packet_tag;
+        fromRadioScratch.packet = *p;
+        service->releaseToPool(p);
+        broadcast(true);
+        any = true;
+    }
+#endif
+    while (auto p = service->getForPhone()) {
+        printPacket("phone downloaded packet", p);
+        memset(&fromRadioScratch, 0, sizeof(fromRadioScratch));
+        fromRadioScratch.which_payload_variant = meshtastic_FromRadio_packet_tag;
+        fromRadioScratch.packet = *p;
+        service->releaseToPool(p);
+        broadcast(true);
+        any = true;
+    }
+    return any;
+}
+
+int32_t EpollServerPort::runOnce()
+{
+    struct epoll_event events[MAX_API_CLIENTS + 1];
+    int n = epoll_wait(epollFd, events, MAX_API_CLIENTS + 1, 0); // the watcher thread already waited for these
+    for (int i = 0; i < n; i++) {
+        auto c = (EpollClientAPI *)events[i].data.ptr;
+        if (!c) {
+            acceptClients();
+        } else {
+            if (events[i].events & EPOLLIN)
+                c->open = c->readSocket() && c->open;
+            if (events[i].events & (EPOLLHUP | EPOLLERR))
+                c->open = false;
+        }
+    }
+
+    // Let the watcher look again, anything that arrives from now on raises socketsReady (and so shouldRun()) again
+    {
+        std::lock_guard<std::mutex> lock(watchMutex);
+        socketsReady = false;
+    }
+    watchCond.notify_one();
+
+    fanout();
+
+    for (size_t i = 0; i < clients.size();) {
+        auto c = clients[i];
+        // Keep going while the socket takes everything, once it is full EPOLLOUT brings us back
+        bool more = true;
+        while (c->open && more) {
+            more = c->pullFromPhoneAPI();
+            c->open = c->writeSocket() && c->open;
+            more &= c->txQueue.empty();
+        }
+        if (!c->open) {
+            closeClient(c); // the next client moved into slot i
+            continue;
+        }
+        updateEvents(c);
+        i++;
+    }
+
+    // socketsReady and MeshService's fromNum wake us when there is something to do, this is just for the PhoneAPI
+    // connection timeouts (checked as we pull from it)
+    return 1000;
+}
+
+int EpollServerPort::onFromNumChanged(uint32_t newValue)
+{
+    setIntervalFromNow(0);
+    return 0;
+}
+
+#endif
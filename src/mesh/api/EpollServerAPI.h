@@ -0,0 +1,156 @@
+#pragma once
+
+#include "configuration.h"
+
+#ifdef ARCH_PORTDUINO
+
+#include "Observer.h"
+#include "PhoneAPI.h"
+#include "StreamFrameParser.h"
+#include "concurrency/OSThread.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// The most API clients we will serve at once, further connections are refused
+#ifndef MAX_API_CLIENTS
+#define MAX_API_CLIENTS 32
+#endif
+
+/// How many frames we hold for a client that isn't reading before we start dropping its oldest mesh packets.  A client with
+/// twice this many frames we can't drop is disconnected.
+#ifndef MAX_API_CLIENT_QUEUE
+#define MAX_API_CLIENT_QUEUE 64
+#endif
+
+/// A framed (0x94C3 + length) and encoded FromRadio, shared by every client it is queued for
+typedef std::shared_ptr<const std::vector<uint8_t>> APIFrame;
+
+/// A frame waiting in a client's queue, only mesh packets may be dropped if the client falls behind
+struct QueuedAPIFrame {
+    APIFrame frame;
+    bool droppable;
+};
+
+/**
+ * One TCP connection to an EpollServerPort.  Each client runs its own PhoneAPI state machine (so each gets its own config
+ * download), but mesh packets are encoded once by the server and queued for every client that is ready for them.
+ */
+class EpollClientAPI : public PhoneAPI
+{
+    friend class EpollServerPort;
+
+    int fd;
+    bool open = true;
+
+    StreamFrameParser rxParser;
+
+    /// Frames waiting to be written, txOffset bytes of the first one have already gone out
+    std::deque<QueuedAPIFrame> txQueue;
+    size_t txOffset = 0;
+
+    /// True while we have asked epoll to tell us when the socket is writable again
+    bool waitingForWrite = false;
+
+    /// Mesh packets thrown away because this client wasn't keeping up
+    uint32_t droppedFrames = 0;
+
+  public:
+    explicit EpollClientAPI(int _fd);
+
+    virtual ~EpollClientAPI();
+
+    /// Queue a shared frame, dropping the oldest unsent mesh packet if the client is too far behind
+    void enqueue(const APIFrame &frame, bool droppable);
+
+  protected:
+    /// We don't want to publish EVENT_SERIAL_CONNECTED/DISCONNECTED for network clients (same as ServerAPI)
+    virtual void onConnectionChanged(bool connected) override {}
+
+    /// Check the current underlying physical link to see if the client is currently connected
+    virtual bool checkIsConnected() override { return open; }
+
+  private:
+    /// Read everything the socket has for us, returns false if the connection is gone
+    bool readSocket();
+
+    /// Queue any config/xmodem records our PhoneAPI state machine wants to send (without going over the queue limit)
+    /// @return true if we stopped at the limit, so there may be more
+    bool pullFromPhoneAPI();
+
+    /// Write as much of txQueue as the socket will take, returns false if the connection is gone
+    bool writeSocket();
+};
+
+/**
+ * Listens on a TCP port and serves any number of API clients (up to MAX_API_CLIENTS) from one thread, using epoll to find the
+ * sockets that need attention instead of polling every connection.  A helper thread blocks until epoll has something for us,
+ * then raises socketsReady and interrupts the main loop's delay.  It never touches our OSThread state, the main loop sees
+ * the flag through shouldRun().
+ *
+ * We are the only consumer of the MeshService phone queues (and of the S&F history kept for the phone) while any client is
+ * ready for packets, each record is encoded to a FromRadio once and the same frame is queued for every client.
+ */
+class EpollServerPort : private concurrency::OSThread
+{
+    int port;
+    int listenFd = -1;
+    int epollFd = -1;
+
+    std::vector<EpollClientAPI *> clients;
+
+    /// Blocks on epollFd and schedules us when it has events, stopFd wakes it up when we are going away
+    std::thread watcher;
+    int stopFd = -1;
+    std::mutex watchMutex;
+    std::condition_variable watchCond;
+    std::atomic<bool> socketsReady{false}; // set by the watcher, cleared by runOnce() once it has taken the events
+    bool stopping = false;                 // protected by watchMutex
+
+    /// Our fromradio record while it is being encoded for fanout
+    meshtastic_FromRadio fromRadioScratch = {};
+
+    CallbackObserver<EpollServerPort, uint32_t> fromNumObserver =
+        CallbackObserver<EpollServerPort, uint32_t>(this, &EpollServerPort::onFromNumChanged);
+
+  public:
+    explicit EpollServerPort(int _port);
+
+    virtual ~EpollServerPort();
+
+    /// Start listening, returns false if we could not open the port
+    bool init();
+
+    /// Also run as soon as the watcher has seen socket events
+    virtual bool shouldRun(unsigned long time) override { return socketsReady || OSThread::shouldRun(time); }
+
+  protected:
+    virtual int32_t runOnce() override;
+
+  private:
+    void acceptClients();
+
+    void closeClient(EpollClientAPI *c);
+
+    /// Ask epoll for write readiness only while the client has data stuck in its queue
+    void updateEvents(EpollClientAPI *c);
+
+    /// Move everything in the MeshService phone queues to our clients, returns true if there was anything
+    bool fanout();
+
+    /// Encode fromRadioScratch and queue it for every client that is ready for packets
+    void broadcast(bool droppable);
+
+    /// The watcher thread
+    void watchSockets();
+
+    /// MeshService has new records for the phone, come and get them
+    int onFromNumChanged(uint32_t newValue);
+};
+
+#endif
@@ -5,6 +5,7 @@
 template <typename T>
 ServerAPI<T>::ServerAPI(T &_client) : StreamAPI(&client), concurrency::OSThread("ServerAPI"), client(_client)
 {
+    readerThread = this;
     LOG_INFO("Incoming wifi connection\n");
 }
 
@@ -26,6 +26,9 @@ template <class T> class ServerAPI : public StreamAPI, private concurrency::OSTh
 
     virtual int32_t runOnce() override; // Check for dropped client connections
 
+    /// Run early if StreamAPI::wake() was called
+    virtual bool shouldRun(unsigned long time) override { return (takeWake() && enabled) || OSThread::shouldRun(time); }
+
     /// Check the current underlying physical link to see if the client is currently connected
     virtual bool checkIsConnected() override;
 };
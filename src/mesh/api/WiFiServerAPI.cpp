@@ -4,13 +4,23 @@
 #if HAS_WIFI
 #include "WiFiServerAPI.h"
 
+#ifdef ARCH_PORTDUINO
+// On Linux we serve many TCP clients at once (dashboards, loggers, bridges...)
+#include "EpollServerAPI.h"
+static EpollServerPort *apiPort;
+#else
 static WiFiServerPort *apiPort;
+#endif
 
 void initApiServer(int port)
 {
     // Start API server on port 4403
     if (!apiPort) {
+#ifdef ARCH_PORTDUINO
+        apiPort = new EpollServerPort(port);
+#else
         apiPort = new WiFiServerPort(port);
+#endif
         LOG_INFO("API server listening on TCP port %d\n", port);
         apiPort->init();
     }
@@ -18,6 +28,7 @@ void initApiServer(int port)
 void deInitApiServer()
 {
     delete apiPort;
+    apiPort = NULL;
 }
 
 WiFiServerAPI::WiFiServerAPI(WiFiClient &_client) : ServerAPI(_client)
@@ -0,0 +1,136 @@
+#include "HttpAPI.h"
+
+#ifdef ARCH_PORTDUINO
+
+#include <algorithm>
+#include <chrono>
+#include <string.h>
+
+HttpAPI::HttpAPI() : concurrency::OSThread("HttpAPI") {}
+
+void HttpAPI::queueToRadio(const uint8_t *buf, size_t len)
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        toRadioQueue.emplace_back(buf, buf + len);
+    }
+    workPending = true;
+}
+
+HttpAPIOutbox *HttpAPI::attach()
+{
+    HttpAPIOutbox *box = new HttpAPIOutbox();
+    box->attached = true;
+
+    std::lock_guard<std::mutex> guard(lock);
+    outboxes.push_back(box);
+    return box;
+}
+
+void HttpAPI::detach(HttpAPIOutbox *box)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    outboxes.erase(std::remove(outboxes.begin(), outboxes.end(), box), outboxes.end());
+    delete box;
+}
+
+size_t HttpAPI::take(HttpAPIOutbox *box, uint8_t *buf, size_t bufLen, bool oneRecord, uint32_t timeoutMsec)
+{
+    std::unique_lock<std::mutex> guard(lock);
+    box->lastTakeMsec = millis();
+    if (!box->attached) {
+        box->attached = true;
+        workPending = true;
+    }
+    framesReady.wait_for(guard, std::chrono::milliseconds(timeoutMsec), [box] { return !box->frames.empty(); });
+
+    // Only ever hand out whole records
+    size_t used = 0, taken = 0;
+    while (box->frames.size() - taken >= StreamFrameParser::HEADER_LEN) {
+        const uint8_t *frame = (const uint8_t *)box->frames.data() + taken;
+        size_t len = (frame[2] << 8) | frame[3];
+        size_t frameLen = StreamFrameParser::HEADER_LEN + len;
+        if (oneRecord) {
+            if (len <= bufLen) {
+                memcpy(buf, frame + StreamFrameParser::HEADER_LEN, len);
+                used = len;
+                taken = frameLen;
+            }
+            break;
+        }
+        if (bufLen - used < frameLen)
+            break;
+        memcpy(buf + used, frame, frameLen);
+        used += frameLen;
+        taken += frameLen;
+    }
+    box->frames.erase(0, taken);
+
+    if (taken)
+        workPending = true; // there is room for more now
+    return used;
+}
+
+bool HttpAPI::outboxesWant()
+{
+    bool any = false;
+    for (HttpAPIOutbox *box : outboxes) {
+        if (box->frames.size() + sizeof(txBuf) > FROMRADIO_OUTBOX_SIZE)
+            return false;
+        any = true;
+    }
+    if (pollOutbox.attached) {
+        if (pollOutbox.frames.size() + sizeof(txBuf) > FROMRADIO_OUTBOX_SIZE)
+            return false;
+        any = true;
+    }
+    return any;
+}
+
+int32_t HttpAPI::runOnce()
+{
+    std::deque<std::vector<uint8_t>> toRadio;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        toRadio.swap(toRadioQueue);
+
+        // Nobody is polling any more, stop saving records for them
+        if (pollOutbox.attached && millis() - pollOutbox.lastTakeMsec > FROMRADIO_POLL_IDLE_MSEC) {
+            pollOutbox.attached = false;
+            pollOutbox.frames.clear();
+        }
+    }
+
+    for (auto &buf : toRadio)
+        handleToRadio(buf.data(), buf.size());
+
+    // Records stay in the PhoneAPI (and the MeshService queues) until some web client wants them, and then go to all of them
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (!outboxesWant())
+                break;
+        }
+
+        size_t len = getFromRadio(txBuf + StreamFrameParser::HEADER_LEN);
+        if (len == 0)
+            break;
+        txBuf[0] = StreamFrameParser::START1;
+        txBuf[1] = StreamFrameParser::START2;
+        txBuf[2] = (len >> 8) & 0xff;
+        txBuf[3] = len & 0xff;
+
+        std::lock_guard<std::mutex> guard(lock);
+        for (HttpAPIOutbox *box : outboxes)
+            box->frames.append((const char *)txBuf, StreamFrameParser::HEADER_LEN + len);
+        if (pollOutbox.attached)
+            pollOutbox.frames.append((const char *)txBuf, StreamFrameParser::HEADER_LEN + len);
+        framesReady.notify_all();
+    }
+
+    // Without an interruptible mainDelay on portduino this interval is how long a web request may wait for us
+    std::lock_guard<std::mutex> guard(lock);
+    return (outboxes.empty() && !pollOutbox.attached) ? 100 : 20;
+}
+
+#endif
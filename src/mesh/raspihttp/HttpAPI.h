@@ -0,0 +1,93 @@
+#pragma once
+
+#include "configuration.h"
+
+#ifdef ARCH_PORTDUINO
+
+#include "PhoneAPI.h"
+#include "StreamFrameParser.h"
+#include "concurrency/OSThread.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/// Most bytes of framed records we hold for one web client before we stop taking more from the PhoneAPI
+#define FROMRADIO_OUTBOX_SIZE (64 * 1024)
+
+/// If nobody has polled fromradio for this long we stop collecting records for the polling endpoints
+#define FROMRADIO_POLL_IDLE_MSEC (60 * 1000)
+
+/**
+ * Framed FromRadio records (0x94 0xc3, 16 bit big endian length, protobuf) waiting for a web client: one for each open
+ * fromradio/stream response, plus one shared by the polling endpoints.
+ */
+struct HttpAPIOutbox {
+    std::string frames;
+    bool attached = false;
+    uint32_t lastTakeMsec = 0;
+};
+
+/**
+ * The PhoneAPI session behind the web endpoints.
+ *
+ * The web server runs every connection on a thread of its own, but the PhoneAPI state and the MeshService queues it reads
+ * belong to the main thread.  So web threads only queue ToRadios and take finished records from their outbox, and runOnce()
+ * does all the PhoneAPI work on the main thread, copying every FromRadio into every attached outbox so each open stream sees
+ * the whole session rather than whatever records the others didn't take first.
+ */
+class HttpAPI : public PhoneAPI, private concurrency::OSThread
+{
+  public:
+    HttpAPI();
+
+    /// For web server threads: have the main thread handle a ToRadio
+    void queueToRadio(const uint8_t *buf, size_t len);
+
+    /// For web server threads: start collecting every FromRadio from now on in a new outbox, detach() it when done
+    HttpAPIOutbox *attach();
+
+    void detach(HttpAPIOutbox *box);
+
+    /// The outbox for the polling endpoints, (re)attached whenever someone takes from it
+    HttpAPIOutbox *getPollOutbox() { return &pollOutbox; }
+
+    /**
+     * For web server threads: move whole framed records from 'box' into buf, or with oneRecord just the first record without
+     * its frame header.  Waits up to timeoutMsec for something to arrive, returns the number of bytes used.
+     */
+    size_t take(HttpAPIOutbox *box, uint8_t *buf, size_t bufLen, bool oneRecord, uint32_t timeoutMsec);
+
+  protected:
+    virtual int32_t runOnce() override;
+
+    /// Run early if a web thread gave us something to do
+    virtual bool shouldRun(unsigned long time) override { return workPending.exchange(false) || OSThread::shouldRun(time); }
+
+    /// Check the current underlying physical link to see if the client is currently connected
+    virtual bool checkIsConnected() override { return true; } // FIXME, be smarter about this
+
+    /// Called from the main thread when new packets arrive for the client
+    virtual void onNowHasData(uint32_t fromRadioNum) override { workPending = true; }
+
+  private:
+    /// Protects everything below, which the web server threads share with the main thread
+    std::mutex lock;
+    std::condition_variable framesReady;
+
+    std::deque<std::vector<uint8_t>> toRadioQueue;
+    std::vector<HttpAPIOutbox *> outboxes; // attached streams
+    HttpAPIOutbox pollOutbox;
+
+    std::atomic<bool> workPending{false};
+
+    uint8_t txBuf[StreamFrameParser::HEADER_LEN + MAX_TO_FROM_RADIO_SIZE];
+
+    /// True if there is an attached outbox and they all have room for another record, the caller must hold lock
+    bool outboxesWant();
+};
+
+#endif
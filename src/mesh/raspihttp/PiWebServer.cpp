@@ -5,6 +5,10 @@ Webserver libs including generation of SSL certifcicates,  because the use ESP s
 the lib that can't be emulated.
 
 The WebServices adapt to the two major phoneapi functions "handleAPIv1FromRadio,handleAPIv1ToRadio"
+GET /api/v1/fromradio returns one FromRadio protobuf.  With ?all=true it returns every pending record (up to
+FROMRADIO_BATCH_SIZE bytes) in one response, each framed like the serial/TCP API (0x94 0xc3 + 16 bit length), and with
+&wait=<msec> it waits that long for new records instead of answering empty.  GET /api/v1/fromradio/stream keeps the
+response open and pushes the same frames over chunked HTTP as they become available.
 The WebServer just adds basaic support to deliver WebContent, so it can be used to
 deliver the WebGui definded by the WebClient Project.
 
@@ -41,6 +45,7 @@ mail:   marchammermann@googlemail.com
 #include "PhoneAPI.h"
 #include "PowerFSM.h"
 #include "RadioLibInterface.h"
+#include "StreamFrameParser.h"
 #include "airtime.h"
 #include "graphics/Screen.h"
 #include "main.h"
@@ -56,8 +61,10 @@ mail:   marchammermann@googlemail.com
 #include <ulfius.h>
 #include <yder.h>
 
+#include <algorithm>
 #include <cstring>
 #include <string>
+#include <vector>
 
 #include "PortduinoFS.h"
 #include "platform/portduino/PortduinoGlue.h"
@@ -82,7 +89,7 @@ char contentTypes[][2][32] = {{".txt", "text/plain"},      {".html", "text/html"
 volatile bool isWebServerReady;
 volatile bool isCertReady;
 
-HttpAPI webAPI;
+static HttpAPI *webAPI;
 
 PiWebServerThread *piwebServerThread;
 
@@ -247,7 +254,7 @@ int handleAPIv1ToRadio(const struct _u_request *req, struct _u_response *res, vo
     portduinoVFS->mountpoint(configWeb.rootPath);
 
     LOG_DEBUG("Received %d bytes from PUT request\n", s);
-    webAPI.handleToRadio(buffer, s);
+    webAPI->queueToRadio(buffer, s);
     LOG_DEBUG("end web->radio  \n");
     return U_CALLBACK_COMPLETE;
 }
@@ -260,7 +267,8 @@ int handleAPIv1FromRadio(const struct _u_request *req, struct _u_response *res,
 {
 
     // LOG_DEBUG("handleAPIv1FromRadio radio -> web\n");
-    std::string valueAll;
+    const char *valueAll = u_map_get(req->map_url, "all");
+    const char *valueWait = u_map_get(req->map_url, "wait");
 
     // Status code is 200 OK by default.
     ulfius_add_header_to_response(res, "Content-Type", "application/x-protobuf");
@@ -269,22 +277,17 @@ int handleAPIv1FromRadio(const struct _u_request *req, struct _u_response *res,
     ulfius_add_header_to_response(res, "X-Protobuf-Schema",
                                   "https://raw.githubusercontent.com/meshtastic/protobufs/master/meshtastic/mesh.proto");
 
-    uint8_t txBuf[MAX_STREAM_BUF_SIZE];
-    uint32_t len = 1;
-
-    if (valueAll == "true") {
-        while (len) {
-            len = webAPI.getFromRadio(txBuf);
-            ulfius_set_response_properties(res, U_OPT_STATUS, 200, U_OPT_BINARY_BODY, txBuf, len);
-            const char *tmpa = (const char *)txBuf;
-            ulfius_set_string_body_response(res, 200, tmpa);
-            // LOG_DEBUG("\n----webAPI response all:----\n");
-            // LOG_DEBUG(tmpa);
-            // LOG_DEBUG("\n");
-        }
+    uint32_t waitMsec = valueWait ? std::min((uint32_t)strtoul(valueWait, NULL, 10), (uint32_t)FROMRADIO_MAX_WAIT_MSEC) : 0;
+
+    if (valueAll && strcmp(valueAll, "true") == 0) {
+        // Everything we have in one response, framed so the client can split it (a config download is hundreds of records)
+        std::vector<uint8_t> body(FROMRADIO_BATCH_SIZE);
+        size_t len = webAPI->take(webAPI->getPollOutbox(), body.data(), body.size(), false, waitMsec);
+        ulfius_set_binary_body_response(res, 200, (const char *)body.data(), len);
         // Otherwise, just return one protobuf
     } else {
-        len = webAPI.getFromRadio(txBuf);
+        uint8_t txBuf[MAX_STREAM_BUF_SIZE];
+        size_t len = webAPI->take(webAPI->getPollOutbox(), txBuf, sizeof(txBuf), true, waitMsec);
         const char *tmpa = (const char *)txBuf;
         ulfius_set_binary_body_response(res, 200, tmpa, len);
         // LOG_DEBUG("\n----webAPI response:\n");
@@ -296,6 +299,67 @@ int handleAPIv1FromRadio(const struct _u_request *req, struct _u_response *res,
     return U_CALLBACK_COMPLETE;
 }
 
+/**
+ * State for one open fromradio/stream response
+ */
+struct FromRadioStream {
+    HttpAPIOutbox *outbox; // every record from the moment the stream was opened
+};
+
+/**
+ * Called by the web server whenever it wants the next chunk of a fromradio/stream response.  Each connection has its own
+ * thread, so we simply sleep here until there is something to send.
+ */
+static ssize_t fromRadioStreamCallback(void *cls, uint64_t pos, char *buf, size_t max)
+{
+    (void)(pos);
+    FromRadioStream *stream = (FromRadioStream *)cls;
+    size_t len = webAPI->take(stream->outbox, (uint8_t *)buf, max, false, FROMRADIO_STREAM_KEEPALIVE_MSEC);
+    if (len == 0 && max >= StreamFrameParser::HEADER_LEN) {
+        // Nothing to send, but the only way to find out the client went away is to write to it
+        buf[0] = StreamFrameParser::START1;
+        buf[1] = StreamFrameParser::START2;
+        buf[2] = 0;
+        buf[3] = 0;
+        len = StreamFrameParser::HEADER_LEN;
+    }
+    return len;
+}
+
+static void fromRadioStreamFree(void *cls)
+{
+    LOG_DEBUG("fromradio stream closed\n");
+    FromRadioStream *stream = (FromRadioStream *)cls;
+    webAPI->detach(stream->outbox);
+    delete stream;
+}
+
+/*
+ * Streaming version of handleAPIv1FromRadio, pushes framed FromRadio records over chunked HTTP until the client goes away.
+ * An empty frame is sent every FROMRADIO_STREAM_KEEPALIVE_MSEC while there is no traffic.
+ */
+int handleAPIv1FromRadioStream(const struct _u_request *req, struct _u_response *res, void *user_data)
+{
+    LOG_DEBUG("fromradio stream opened\n");
+
+    ulfius_add_header_to_response(res, "Content-Type", "application/x-protobuf");
+    ulfius_add_header_to_response(res, "Access-Control-Allow-Origin", "*");
+    ulfius_add_header_to_response(res, "Access-Control-Allow-Methods", "GET");
+    ulfius_add_header_to_response(res, "Cache-Control", "no-cache");
+    ulfius_add_header_to_response(res, "X-Protobuf-Schema",
+                                  "https://raw.githubusercontent.com/meshtastic/protobufs/master/meshtastic/mesh.proto");
+
+    FromRadioStream *stream = new FromRadioStream();
+    stream->outbox = webAPI->attach();
+    if (ulfius_set_stream_response(res, 200, fromRadioStreamCallback, fromRadioStreamFree, U_STREAM_SIZE_UNKNOWN,
+                                   FROMRADIO_STREAM_CHUNK, stream) != U_OK) {
+        webAPI->detach(stream->outbox);
+        delete stream;
+        return U_CALLBACK_ERROR;
+    }
+    return U_CALLBACK_COMPLETE;
+}
+
 /*
 OpenSSL RSA Key Gen
 */
@@ -444,6 +508,8 @@ PiWebServerThread::PiWebServerThread()
 {
     int ret, retssl, webservport;
 
+    webAPI = new HttpAPI();
+
     if (CheckSSLandLoad() != 0) {
         CreateSSLCertificate();
         if (CheckSSLandLoad() != 0) {
@@ -492,6 +558,7 @@ PiWebServerThread::PiWebServerThread()
         u_map_put(instanceWeb.default_headers, "Access-Control-Allow-Origin", "*");
         // Maximum body size sent by the client is 1 Kb
         instanceWeb.max_post_body_size = 1024;
+        ulfius_add_endpoint_by_val(&instanceWeb, "GET", PREFIX, "/api/v1/fromradio/stream", 0, &handleAPIv1FromRadioStream, NULL);
         ulfius_add_endpoint_by_val(&instanceWeb, "GET", PREFIX, "/api/v1/fromradio/*", 1, &handleAPIv1FromRadio, NULL);
         ulfius_add_endpoint_by_val(&instanceWeb, "PUT", PREFIX, "/api/v1/toradio/*", 1, &handleAPIv1ToRadio, configWeb.rootPath);
 
@@ -1,7 +1,7 @@
 #pragma once
 #ifdef PORTDUINO_LINUX_HARDWARE
 #if __has_include(<ulfius.h>)
-#include "PhoneAPI.h"
+#include "HttpAPI.h"
 #include "ulfius-cfg.h"
 #include "ulfius.h"
 #include <Arduino.h>
@@ -9,6 +9,18 @@
 
 #define STATIC_FILE_CHUNK 256
 
+/// Most bytes of framed FromRadio records we put in one fromradio?all=true response, the client asks again for the rest
+#define FROMRADIO_BATCH_SIZE FROMRADIO_OUTBOX_SIZE
+
+/// Chunk size for the fromradio/stream response, room for several records per chunk
+#define FROMRADIO_STREAM_CHUNK 8192
+
+/// If nothing has been sent on a fromradio/stream for this long we send an empty frame so a dead client is noticed
+#define FROMRADIO_STREAM_KEEPALIVE_MSEC 5000
+
+/// Longest a fromradio?wait= long poll may block
+#define FROMRADIO_MAX_WAIT_MSEC 30000
+
 void initWebServer();
 void createSSLCert();
 int callback_static_file(const struct _u_request *request, struct _u_response *response, void *user_data);
@@ -41,20 +53,6 @@ class PiWebServerThread
     struct _u_instance instanceService;
 };
 
-class HttpAPI : public PhoneAPI
-{
-
-  public:
-    // Nothing here yet
-
-  private:
-    // Nothing here yet
-
-  protected:
-    /// Check the current underlying physical link to see if the client is currently connected
-    virtual bool checkIsConnected() override { return true; } // FIXME, be smarter about this
-};
-
 extern PiWebServerThread *piwebServerThread;
 
 #endif
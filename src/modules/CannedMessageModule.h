@@ -70,6 +70,7 @@ class CannedMessageModule : public SinglePortModule, public Observable<const UIF
 
     /*
       -Override the wantPacket method. We need the Routing Messages to look for ACKs.
+      -It also keeps the signal of the last packet we received, so it must be offered every packet (see getPortNums()).
     */
     virtual bool wantPacket(const meshtastic_MeshPacket *p) override
     {
@@ -88,6 +89,7 @@ class CannedMessageModule : public SinglePortModule, public Observable<const UIF
             return false;
         }
     }
+    virtual std::vector<meshtastic_PortNum> getPortNums() override { return {}; }
 
   protected:
     virtual int32_t runOnce() override;
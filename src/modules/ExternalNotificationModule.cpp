@@ -195,6 +195,11 @@ bool ExternalNotificationModule::wantPacket(const meshtastic_MeshPacket *p)
     return MeshService::isTextPayload(p);
 }
 
+std::vector<meshtastic_PortNum> ExternalNotificationModule::getPortNums()
+{
+    return MeshService::getTextPortNums();
+}
+
 /**
  * Sets the external notification on for the specified index.
  *
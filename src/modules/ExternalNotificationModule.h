@@ -56,6 +56,7 @@ class ExternalNotificationModule : public SinglePortModule, private concurrency:
     virtual int32_t runOnce() override;
 
     virtual bool wantPacket(const meshtastic_MeshPacket *p) override;
+    virtual std::vector<meshtastic_PortNum> getPortNums() override;
 
     bool isNagging = false;
 
@@ -34,6 +34,9 @@ class RoutingModule : public ProtobufModule<meshtastic_Routing>
 
     /// Override wantPacket to say we want to see all packets, not just those for our port number
     virtual bool wantPacket(const meshtastic_MeshPacket *p) override { return true; }
+
+    /// We look at every packet, not just routing ones
+    virtual std::vector<meshtastic_PortNum> getPortNums() override { return {}; }
 };
 
 extern RoutingModule *routingModule;
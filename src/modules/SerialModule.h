@@ -23,6 +23,9 @@ class SerialModule : public StreamAPI, private concurrency::OSThread
   protected:
     virtual int32_t runOnce() override;
 
+    /// Run early if StreamAPI::wake() was called
+    virtual bool shouldRun(unsigned long time) override { return (takeWake() && enabled) || OSThread::shouldRun(time); }
+
     /// Check the current underlying physical link to see if the client is currently connected
     virtual bool checkIsConnected() override;
 
@@ -64,6 +67,7 @@ class SerialModuleRadio : public MeshModule
     meshtastic_PortNum ourPortNum;
 
     virtual bool wantPacket(const meshtastic_MeshPacket *p) override { return p->decoded.portnum == ourPortNum; }
+    virtual std::vector<meshtastic_PortNum> getPortNums() override { return {ourPortNum}; }
 
     meshtastic_MeshPacket *allocDataPacket()
     {
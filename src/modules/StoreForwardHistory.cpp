@@ -0,0 +1,249 @@
+#include "StoreForwardHistory.h"
+#include "configuration.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/// The history can be megabytes, so on ESP32 it (and its indexes) go in PSRAM
+static void *historyAlloc(size_t n, size_t size)
+{
+#ifdef ARCH_ESP32
+    return ps_calloc(n, size);
+#else
+    return calloc(n, size);
+#endif
+}
+
+StoreForwardHistory::~StoreForwardHistory()
+{
+    free(data);
+    free(offsets);
+    free(broadcasts);
+}
+
+bool StoreForwardHistory::init(size_t bytes, uint32_t _maxRecords)
+{
+    free(data);
+    free(offsets);
+    free(broadcasts);
+    data = NULL;
+    offsets = broadcasts = NULL;
+    direct.clear();
+    firstSeq = nextSeq = 0;
+    broadcastFirst = broadcastCount = 0;
+    writeOffset = 0;
+    newestTime = 0;
+
+    if (bytes < maxRecordLen() || _maxRecords == 0)
+        return false;
+
+    dataSize = bytes;
+    maxRecords = _maxRecords;
+    data = (uint8_t *)historyAlloc(dataSize, 1);
+    offsets = (uint32_t *)historyAlloc(maxRecords, sizeof(uint32_t));
+    broadcasts = (uint32_t *)historyAlloc(maxRecords, sizeof(uint32_t));
+    if (!data || !offsets || !broadcasts) {
+        free(data);
+        free(offsets);
+        free(broadcasts);
+        data = NULL;
+        offsets = broadcasts = NULL;
+        return false;
+    }
+    return true;
+}
+
+void StoreForwardHistory::dropOldest()
+{
+    const RecordHeader *h = header(firstSeq);
+    if (h->to == NODENUM_BROADCAST) {
+        broadcastFirst = (broadcastFirst + 1) % maxRecords;
+        broadcastCount--;
+    } else {
+        auto it = direct.find(h->to);
+        if (it != direct.end()) {
+            if (h->nextSameTo == NONE)
+                direct.erase(it);
+            else
+                it->second.first = h->nextSameTo;
+        }
+    }
+    firstSeq++;
+}
+
+size_t StoreForwardHistory::makeRoom(size_t len)
+{
+    for (;;) {
+        if (getCount() == 0) {
+            writeOffset = 0;
+            return 0;
+        }
+        if (getCount() < maxRecords) {
+            // Records fill [oldest, writeOffset), wrapping around the end of data at most once
+            size_t oldest = offsets[firstSeq % maxRecords];
+            if (writeOffset > oldest) {
+                if (dataSize - writeOffset >= len)
+                    return writeOffset;
+                if (oldest >= len)
+                    return 0; // the tail end is too small, leave it unused this time around
+            } else if (writeOffset < oldest && oldest - writeOffset >= len) {
+                return writeOffset;
+            }
+        }
+        dropOldest();
+    }
+}
+
+uint32_t StoreForwardHistory::add(uint32_t time, NodeNum to, NodeNum from, uint8_t channel, const uint8_t *payload,
+                                  pb_size_t size)
+{
+    if (!data)
+        return NONE;
+    if (size > meshtastic_Constants_DATA_PAYLOAD_LEN)
+        size = meshtastic_Constants_DATA_PAYLOAD_LEN;
+
+    // Keep times in order, so firstAfter() can binary search
+    if (time < newestTime)
+        time = newestTime;
+    newestTime = time;
+
+    size_t len = recordLen(size);
+    size_t offset = makeRoom(len);
+    uint32_t seq = nextSeq++;
+    offsets[seq % maxRecords] = offset;
+    writeOffset = offset + len;
+
+    RecordHeader *h = header(seq);
+    h->time = time;
+    h->to = to;
+    h->from = from;
+    h->nextSameTo = NONE;
+    h->channel = channel;
+    h->reserved = 0;
+    h->size = size;
+    memcpy(h + 1, payload, size); // only what the message actually used
+
+    if (to == NODENUM_BROADCAST) {
+        broadcasts[(broadcastFirst + broadcastCount) % maxRecords] = seq;
+        broadcastCount++;
+    } else {
+        auto it = direct.find(to);
+        if (it != direct.end()) {
+            header(it->second.last)->nextSameTo = seq;
+            it->second.last = seq;
+        } else {
+            direct[to] = {seq, seq};
+        }
+    }
+    return seq;
+}
+
+void StoreForwardHistory::dropBefore(uint32_t seq)
+{
+    while (getCount() && firstSeq < seq)
+        dropOldest();
+}
+
+uint32_t StoreForwardHistory::firstAfter(uint32_t since) const
+{
+    uint32_t lo = firstSeq, hi = nextSeq;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (header(mid)->time > since)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    return lo;
+}
+
+void StoreForwardHistory::beginScan(Scan &scan, NodeNum dest, uint32_t start) const
+{
+    uint32_t lo = 0, hi = broadcastCount;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (broadcastAt(mid) >= start)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    scan.broadcastPos = lo;
+
+    // Direct messages to one node are few, so we just follow the links
+    scan.direct = NONE;
+    auto it = direct.find(dest);
+    if (it != direct.end()) {
+        uint32_t s = it->second.first;
+        while (s != NONE && s < start)
+            s = header(s)->nextSameTo;
+        scan.direct = s;
+    }
+}
+
+uint32_t StoreForwardHistory::nextFromScan(Scan &scan, NodeNum dest) const
+{
+    for (;;) {
+        uint32_t b = scan.broadcastPos < broadcastCount ? broadcastAt(scan.broadcastPos) : NONE;
+        uint32_t s;
+        if (scan.direct != NONE && scan.direct < b) {
+            s = scan.direct;
+            scan.direct = header(s)->nextSameTo;
+        } else if (b != NONE) {
+            s = b;
+            scan.broadcastPos++;
+        } else {
+            return NONE;
+        }
+
+        // Clients aren't interested in their own messages
+        if (header(s)->from != dest)
+            return s;
+    }
+}
+
+bool StoreForwardHistory::next(NodeNum dest, uint32_t cursor, uint32_t since, uint32_t &seq) const
+{
+    if (!data || getCount() == 0)
+        return false;
+
+    uint32_t start = firstAfter(since);
+    if (cursor > start)
+        start = cursor;
+
+    Scan scan;
+    beginScan(scan, dest, start);
+    seq = nextFromScan(scan, dest);
+    return seq != NONE;
+}
+
+uint32_t StoreForwardHistory::count(NodeNum dest, uint32_t cursor, uint32_t since, uint32_t limit) const
+{
+    if (!data || getCount() == 0)
+        return 0;
+
+    uint32_t start = firstAfter(since);
+    if (cursor > start)
+        start = cursor;
+
+    Scan scan;
+    beginScan(scan, dest, start);
+    uint32_t n = 0;
+    while (n < limit && nextFromScan(scan, dest) != NONE)
+        n++;
+    return n;
+}
+
+bool StoreForwardHistory::get(uint32_t seq, PacketHistoryStruct &out) const
+{
+    if (!data || seq < firstSeq || seq >= nextSeq)
+        return false;
+
+    const RecordHeader *h = header(seq);
+    out.time = h->time;
+    out.to = h->to;
+    out.from = h->from;
+    out.channel = h->channel;
+    out.payload_size = h->size;
+    memcpy(out.payload, h + 1, h->size);
+    return true;
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include "MeshTypes.h"
+#include <unordered_map>
+
+/// One stored message, as handed out by StoreForwardHistory::get()
+struct PacketHistoryStruct {
+    uint32_t time;
+    uint32_t to;
+    uint32_t from;
+    uint8_t channel;
+    uint8_t payload[meshtastic_Constants_DATA_PAYLOAD_LEN];
+    pb_size_t payload_size;
+};
+
+/**
+ * The store and forward message history: a ring log of variable length records, so a short text message only takes the
+ * space it needs, with indexes so serving a client doesn't mean scanning the whole history.
+ *
+ * Every record gets a sequence number, one more than the record before it.  Clients are tracked with a cursor, the
+ * sequence number of the next record they have not seen.  When the log is full the oldest records are dropped, a cursor
+ * pointing at a dropped record just continues from the oldest one still kept (nobody gets sent everything again).
+ *
+ * Indexes:
+ *  - the position of every record, by sequence number
+ *  - the sequence numbers of all broadcast records, in order
+ *  - for each node we have direct messages for, the first and last of them (the records themselves link to the next one)
+ *
+ * Record times are kept in order (a record never gets an earlier time than the one before it) so we can binary search for
+ * the first record in a client's time window.
+ */
+class StoreForwardHistory
+{
+  public:
+    static const uint32_t NONE = UINT32_MAX;
+
+    /// Index memory each record slot costs, on top of the record itself
+    static const size_t INDEX_BYTES_PER_RECORD = 2 * sizeof(uint32_t);
+
+    ~StoreForwardHistory();
+
+    /**
+     * Allocate room for 'bytes' of records (in PSRAM when we have it), and the indexes for at most maxRecords of them.
+     * @return false if we couldn't get the memory
+     */
+    bool init(size_t bytes, uint32_t maxRecords);
+
+    /// Add a record, dropping the oldest ones if we are out of space.  @return its sequence number
+    uint32_t add(uint32_t time, NodeNum to, NodeNum from, uint8_t channel, const uint8_t *payload, pb_size_t size);
+
+    /**
+     * Find the first record at or after 'cursor' which client 'dest' should get: not sent by dest itself, broadcast or sent to
+     * dest, and newer than 'since' (a time in seconds).
+     * @return false if there is none
+     */
+    bool next(NodeNum dest, uint32_t cursor, uint32_t since, uint32_t &seq) const;
+
+    /// How many records next() would give dest, one after the other, stopping once we have counted 'limit'
+    uint32_t count(NodeNum dest, uint32_t cursor, uint32_t since, uint32_t limit = NONE) const;
+
+    /// Copy out a record, @return false if it has already been dropped
+    bool get(uint32_t seq, PacketHistoryStruct &out) const;
+
+    /// Drop every record older than seq
+    void dropBefore(uint32_t seq);
+
+    /// Number of records we hold now
+    uint32_t getCount() const { return nextSeq - firstSeq; }
+
+    /// The most records we could hold (if they were all small)
+    uint32_t getMaxRecords() const { return maxRecords; }
+
+    /// The sequence number the next record added will get
+    uint32_t getNextSeq() const { return nextSeq; }
+
+    /// Bytes a record with 'size' bytes of payload takes in the log
+    static size_t recordLen(size_t size) { return (sizeof(RecordHeader) + size + 3) & ~(size_t)3; }
+
+    /// Bytes the largest possible record takes in the log
+    static size_t maxRecordLen() { return recordLen(meshtastic_Constants_DATA_PAYLOAD_LEN); }
+
+  private:
+    struct RecordHeader {
+        uint32_t time;
+        uint32_t to;
+        uint32_t from;
+        uint32_t nextSameTo; // sequence number of the next direct message to 'to', or NONE
+        uint8_t channel;
+        uint8_t reserved;
+        uint16_t size;
+    };
+
+    /// Walks the broadcast index and one node's direct messages together, see next()
+    struct Scan {
+        uint32_t broadcastPos; // position in the broadcast index
+        uint32_t direct;       // sequence number of the next direct message, or NONE
+    };
+
+    uint8_t *data = NULL;
+    size_t dataSize = 0;
+
+    /// Where the next record will go
+    size_t writeOffset = 0;
+
+    /// Offset in data of every record we hold, indexed by sequence number % maxRecords
+    uint32_t *offsets = NULL;
+    uint32_t maxRecords = 0;
+
+    /// Sequence numbers of the broadcast records we hold, oldest first, starting at broadcasts[broadcastFirst % maxRecords]
+    uint32_t *broadcasts = NULL;
+    uint32_t broadcastFirst = 0;
+    uint32_t broadcastCount = 0;
+
+    struct DirectChain {
+        uint32_t first, last;
+    };
+    std::unordered_map<NodeNum, DirectChain> direct;
+
+    uint32_t firstSeq = 0;
+    uint32_t nextSeq = 0;
+
+    uint32_t newestTime = 0;
+
+    RecordHeader *header(uint32_t seq) const { return (RecordHeader *)(data + offsets[seq % maxRecords]); }
+
+    uint32_t broadcastAt(uint32_t pos) const { return broadcasts[(broadcastFirst + pos) % maxRecords]; }
+
+    /// Drop the oldest record
+    void dropOldest();
+
+    /// Find room for a record of len bytes, dropping old records as needed.  @return its offset
+    size_t makeRoom(size_t len);
+
+    /// The first record newer than 'since'
+    uint32_t firstAfter(uint32_t since) const;
+
+    void beginScan(Scan &scan, NodeNum dest, uint32_t start) const;
+
+    /// @return the next record for dest from scan and move past it, or NONE
+    uint32_t nextFromScan(Scan &scan, NodeNum dest) const;
+};
@@ -0,0 +1,277 @@
+#include "StoreForwardLog.h"
+#include "FSCommon.h"
+
+#include <algorithm>
+#include <string.h>
+
+#define SEGMENT_MAGIC 0x474c4653 // "SFLG"
+#define RECORD_MAGIC 0xa5
+
+uint16_t StoreForwardLog::checksum(const RecordHeader &h, const uint8_t *payload)
+{
+    RecordHeader copy = h;
+    copy.check = 0;
+
+    uint16_t sum1 = 0, sum2 = 0;
+    auto add = [&](const uint8_t *p, size_t len) {
+        for (size_t i = 0; i < len; i++) {
+            sum1 = (sum1 + p[i]) % 255;
+            sum2 = (sum2 + sum1) % 255;
+        }
+    };
+    add((const uint8_t *)&copy, sizeof(copy));
+    add(payload, h.size);
+    return (sum2 << 8) | sum1;
+}
+
+void StoreForwardLog::getPath(char *path, size_t len, uint8_t slot) const
+{
+    snprintf(path, len, "%s/seg%u", dir, slot);
+}
+
+bool StoreForwardLog::begin(const char *_dir, uint8_t _numSegments, uint32_t _segmentBytes)
+{
+#ifdef FSCom
+    strncpy(dir, _dir, sizeof(dir) - 1);
+    numSegments = std::max(_numSegments, (uint8_t)2);
+    segmentBytes = std::max(_segmentBytes, (uint32_t)(sizeof(SegmentHeader) + sizeof(RecordHeader) + 255));
+    segments.clear();
+    pending.clear();
+
+    if (!FSCom.exists(dir))
+        FSCom.mkdir(dir);
+
+    // Find the segments we already have, and put them in the order they were written
+    char path[40];
+    for (uint8_t slot = 0; slot < numSegments; slot++) {
+        getPath(path, sizeof(path), slot);
+        if (!FSCom.exists(path))
+            continue;
+        File f = FSCom.open(path, FILE_O_READ);
+        SegmentHeader h;
+        if (f && f.read((uint8_t *)&h, sizeof(h)) == sizeof(h) && h.magic == SEGMENT_MAGIC)
+            segments.push_back({slot, h.number, 0, 0});
+        f.close();
+    }
+    std::sort(segments.begin(), segments.end(), [](const Segment &a, const Segment &b) { return a.number < b.number; });
+
+    uint32_t start = millis();
+    bool lastOk = true;
+    for (auto &s : segments) {
+        s.firstSeq = index.getNextSeq();
+        lastOk = scanSegment(s);
+    }
+    LOG_INFO("S&F log: %u records in %u segments, read in %u ms\n", index.getCount(), (uint32_t)segments.size(),
+             millis() - start);
+
+    // We can't append after a partly written record, so start a fresh segment
+    if (segments.empty() || !lastOk)
+        return startSegment();
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool StoreForwardLog::scanSegment(Segment &s)
+{
+#ifdef FSCom
+    char path[40];
+    getPath(path, sizeof(path), s.slot);
+    File f = FSCom.open(path, FILE_O_READ);
+    if (!f)
+        return false;
+
+    // Just the headers, seeking past every payload
+    uint32_t fileSize = f.size();
+    uint32_t offset = sizeof(SegmentHeader);
+    RecordHeader h;
+    while (offset + sizeof(h) <= fileSize) {
+        if (!f.seek(offset) || f.read((uint8_t *)&h, sizeof(h)) != sizeof(h) || h.magic != RECORD_MAGIC ||
+            h.size > meshtastic_Constants_DATA_PAYLOAD_LEN || offset + sizeof(h) + h.size > fileSize)
+            break;
+
+        Locator loc = {s.number, offset};
+        index.add(h.time, h.to, h.from, h.channel, (const uint8_t *)&loc, sizeof(loc));
+        offset += sizeof(h) + h.size;
+    }
+    f.close();
+
+    s.bytes = offset;
+    if (offset != fileSize) {
+        LOG_WARN("S&F log: %s is damaged after %u bytes\n", path, offset);
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool StoreForwardLog::startSegment()
+{
+#ifdef FSCom
+    Segment s;
+    s.number = segments.empty() ? 1 : segments.back().number + 1;
+
+    if (segments.size() < numSegments) {
+        // Take the first unused file
+        for (s.slot = 0; s.slot < numSegments; s.slot++) {
+            bool used = false;
+            for (auto &other : segments)
+                used |= other.slot == s.slot;
+            if (!used)
+                break;
+        }
+    } else {
+        // Out of files, forget the oldest segment's records and reuse its file
+        s.slot = segments[0].slot;
+        index.dropBefore(segments[1].firstSeq);
+        segments.erase(segments.begin());
+    }
+
+    char path[40];
+    getPath(path, sizeof(path), s.slot);
+    if (FSCom.exists(path))
+        FSCom.remove(path);
+
+    SegmentHeader h = {SEGMENT_MAGIC, s.number};
+    File f = FSCom.open(path, FILE_O_WRITE);
+    bool ok = f && f.write((const uint8_t *)&h, sizeof(h)) == sizeof(h);
+    f.close();
+
+    if (!ok) {
+        LOG_ERROR("S&F log: can't create %s\n", path);
+        return false;
+    }
+    s.firstSeq = index.getNextSeq();
+    s.bytes = sizeof(h);
+    segments.push_back(s);
+    return true;
+#else
+    return false;
+#endif
+}
+
+uint32_t StoreForwardLog::add(uint32_t time, NodeNum to, NodeNum from, uint8_t channel, const uint8_t *payload,
+                              pb_size_t size)
+{
+    if (segments.empty())
+        return StoreForwardHistory::NONE;
+    if (size > meshtastic_Constants_DATA_PAYLOAD_LEN)
+        size = meshtastic_Constants_DATA_PAYLOAD_LEN;
+
+    RecordHeader h = {};
+    h.magic = RECORD_MAGIC;
+    h.channel = channel;
+    h.size = size;
+    h.time = time;
+    h.to = to;
+    h.from = from;
+    h.check = checksum(h, payload);
+
+    uint32_t len = sizeof(h) + size;
+    if (segments.back().bytes + pending.size() + len > segmentBytes) {
+        flush();
+        if (!startSegment())
+            return StoreForwardHistory::NONE;
+    }
+
+    const Segment &s = segments.back();
+    Locator loc = {s.number, (uint32_t)(s.bytes + pending.size())};
+
+    if (pending.empty())
+        pendingSinceMsec = millis();
+    pending.insert(pending.end(), (const uint8_t *)&h, (const uint8_t *)&h + sizeof(h));
+    pending.insert(pending.end(), payload, payload + size);
+
+    uint32_t seq = index.add(time, to, from, channel, (const uint8_t *)&loc, sizeof(loc));
+
+    if (pending.size() >= STOREFORWARD_LOG_COMMIT_BYTES)
+        flush();
+    return seq;
+}
+
+bool StoreForwardLog::flush()
+{
+    if (pending.empty())
+        return true;
+#ifdef FSCom
+    Segment &s = segments.back();
+    char path[40];
+    getPath(path, sizeof(path), s.slot);
+
+    File f = FSCom.open(path, FILE_O_APPEND);
+    size_t written = f ? f.write(pending.data(), pending.size()) : 0;
+    f.close();
+
+    bool ok = written == pending.size();
+    if (ok) {
+        s.bytes += written;
+    } else {
+        // The file may now end in a partial record, so don't append to it again (get() will fail for the lost records)
+        LOG_ERROR("S&F log: write to %s failed, lost %u bytes\n", path, (uint32_t)pending.size());
+        s.bytes = segmentBytes;
+    }
+    pending.clear();
+    return ok;
+#else
+    pending.clear();
+    return false;
+#endif
+}
+
+void StoreForwardLog::flushIfDue()
+{
+    if (!pending.empty() && millis() - pendingSinceMsec >= STOREFORWARD_LOG_COMMIT_MSEC)
+        flush();
+}
+
+bool StoreForwardLog::get(uint32_t seq, PacketHistoryStruct &out) const
+{
+    PacketHistoryStruct entry;
+    Locator loc;
+    if (!index.get(seq, entry) || entry.payload_size != sizeof(loc))
+        return false;
+    memcpy(&loc, entry.payload, sizeof(loc));
+
+    auto s = std::find_if(segments.begin(), segments.end(), [&](const Segment &x) { return x.number == loc.segment; });
+    if (s == segments.end())
+        return false;
+
+    RecordHeader h;
+    if (&*s == &segments.back() && loc.offset >= s->bytes) {
+        // Not written yet
+        size_t pos = loc.offset - s->bytes;
+        if (pos + sizeof(h) > pending.size())
+            return false;
+        memcpy(&h, pending.data() + pos, sizeof(h));
+        if (pos + sizeof(h) + h.size > pending.size())
+            return false;
+        memcpy(out.payload, pending.data() + pos + sizeof(h), h.size);
+    } else {
+#ifdef FSCom
+        char path[40];
+        getPath(path, sizeof(path), s->slot);
+        File f = FSCom.open(path, FILE_O_READ);
+        bool ok = f && f.seek(loc.offset) && f.read((uint8_t *)&h, sizeof(h)) == sizeof(h) && h.magic == RECORD_MAGIC &&
+                  h.size <= meshtastic_Constants_DATA_PAYLOAD_LEN && f.read(out.payload, h.size) == h.size;
+        f.close();
+        if (!ok)
+            return false;
+#else
+        return false;
+#endif
+    }
+
+    if (h.magic != RECORD_MAGIC || checksum(h, out.payload) != h.check) {
+        LOG_WARN("S&F log: record %u is damaged\n", seq);
+        return false;
+    }
+    out.time = h.time;
+    out.to = h.to;
+    out.from = h.from;
+    out.channel = h.channel;
+    out.payload_size = h.size;
+    return true;
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include "StoreForwardHistory.h"
+#include "configuration.h"
+#include <vector>
+
+/// Keep the history in this log even when there is PSRAM for it, which holds far more messages (but loses them on a reboot)
+#ifndef STOREFORWARD_USE_LOG
+#define STOREFORWARD_USE_LOG 0
+#endif
+
+/// How many segment files the log is split over, once they are all full the oldest one is thrown away and reused
+#ifndef STOREFORWARD_LOG_SEGMENTS
+#ifdef ARCH_PORTDUINO
+#define STOREFORWARD_LOG_SEGMENTS 16
+#else
+#define STOREFORWARD_LOG_SEGMENTS 4
+#endif
+#endif
+
+/// Size of each segment file
+#ifndef STOREFORWARD_LOG_SEGMENT_BYTES
+#ifdef ARCH_PORTDUINO
+#define STOREFORWARD_LOG_SEGMENT_BYTES (1024 * 1024)
+#else
+#define STOREFORWARD_LOG_SEGMENT_BYTES (32 * 1024)
+#endif
+#endif
+
+/// Most RAM the in memory index may take, unless the number of records is configured
+#ifndef STOREFORWARD_LOG_INDEX_BYTES
+#ifdef ARCH_PORTDUINO
+#define STOREFORWARD_LOG_INDEX_BYTES (1024 * 1024)
+#else
+#define STOREFORWARD_LOG_INDEX_BYTES (32 * 1024)
+#endif
+#endif
+
+/// New records are written out together, once this many bytes are waiting or the oldest has waited this long
+#ifndef STOREFORWARD_LOG_COMMIT_BYTES
+#define STOREFORWARD_LOG_COMMIT_BYTES 4096
+#endif
+#ifndef STOREFORWARD_LOG_COMMIT_MSEC
+#define STOREFORWARD_LOG_COMMIT_MSEC (60 * 1000)
+#endif
+
+/**
+ * An append only store and forward history on the filesystem, so the messages offline clients are waiting for survive a
+ * reboot.
+ *
+ * Records go into a fixed number of segment files, used in turn.  Each record is written once, and kept until its whole
+ * segment is reused.  To spare the flash, records are collected in RAM and appended in one write (see
+ * STOREFORWARD_LOG_COMMIT_BYTES/MSEC), so a crash can lose the last few.
+ *
+ * The in memory index is a StoreForwardHistory whose records hold where the message is in the log instead of the message
+ * itself, so it answers count() and next() for clients as before while using a few dozen bytes per message.  At startup
+ * the index is rebuilt from the record headers alone, skipping over the payloads.
+ */
+class StoreForwardLog
+{
+  public:
+    /// Every record added is also added to 'index', which must already be init()ed
+    explicit StoreForwardLog(StoreForwardHistory &_index) : index(_index) {}
+
+    /**
+     * Open the log in directory 'dir', creating it if needed, and add every record already in it to the index.
+     * @return false if we couldn't use the filesystem
+     */
+    bool begin(const char *dir, uint8_t numSegments = STOREFORWARD_LOG_SEGMENTS,
+               uint32_t segmentBytes = STOREFORWARD_LOG_SEGMENT_BYTES);
+
+    /// Add a record, it reaches the filesystem on the next flush().  @return its sequence number in the index
+    uint32_t add(uint32_t time, NodeNum to, NodeNum from, uint8_t channel, const uint8_t *payload, pb_size_t size);
+
+    /// Read back a record the index found, @return false if it is gone or damaged
+    bool get(uint32_t seq, PacketHistoryStruct &out) const;
+
+    /// Write out any records we are holding, @return false if that failed
+    bool flush();
+
+    /// Call every so often, writes out records which have waited long enough
+    void flushIfDue();
+
+    /// Bytes of records waiting to be written
+    size_t getPendingBytes() const { return pending.size(); }
+
+    /// Bytes each record takes in the index
+    static size_t indexRecordLen() { return StoreForwardHistory::recordLen(sizeof(Locator)); }
+
+  private:
+    /// What the index stores as each record's payload
+    struct Locator {
+        uint32_t segment; // segment number
+        uint32_t offset;  // of the record in the segment file
+    };
+
+    /// At the start of every segment file
+    struct SegmentHeader {
+        uint32_t magic;
+        uint32_t number; // increases by one for every new segment
+    };
+
+    /// Before every record's payload
+    struct RecordHeader {
+        uint8_t magic;
+        uint8_t channel;
+        uint8_t size;
+        uint8_t reserved;
+        uint32_t time;
+        uint32_t to;
+        uint32_t from;
+        uint16_t check; // fletcher16 of this header (with check = 0) and the payload
+        uint16_t reserved2;
+    };
+
+    struct Segment {
+        uint8_t slot;      // which file it is in
+        uint32_t number;   // from its SegmentHeader
+        uint32_t firstSeq; // index sequence number of its first record
+        uint32_t bytes;    // written to the file so far
+    };
+
+    StoreForwardHistory &index;
+
+    char dir[24] = "";
+    uint8_t numSegments = 0;
+    uint32_t segmentBytes = 0;
+
+    /// Oldest first, we append to the last one
+    std::vector<Segment> segments;
+
+    /// Records for the last segment which haven't been written yet
+    std::vector<uint8_t> pending;
+    uint32_t pendingSinceMsec = 0;
+
+    void getPath(char *path, size_t len, uint8_t slot) const;
+
+    /// Start a new segment to append to, reusing the oldest one's file if we have run out
+    bool startSegment();
+
+    /// Add the records of a segment to the index, @return false if the end of the file is damaged
+    bool scanSegment(Segment &s);
+
+    static uint16_t checksum(const RecordHeader &h, const uint8_t *payload);
+};
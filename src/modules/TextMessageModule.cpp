@@ -26,4 +26,9 @@ ProcessMessage TextMessageModule::handleReceived(const meshtastic_MeshPacket &mp
 bool TextMessageModule::wantPacket(const meshtastic_MeshPacket *p)
 {
     return MeshService::isTextPayload(p);
+}
+
+std::vector<meshtastic_PortNum> TextMessageModule::getPortNums()
+{
+    return MeshService::getTextPortNums();
 }
\ No newline at end of file
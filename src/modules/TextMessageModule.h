@@ -21,6 +21,7 @@ class TextMessageModule : public SinglePortModule, public Observable<const mesht
     */
     virtual ProcessMessage handleReceived(const meshtastic_MeshPacket &mp) override;
     virtual bool wantPacket(const meshtastic_MeshPacket *p) override;
+    virtual std::vector<meshtastic_PortNum> getPortNums() override;
 };
 
 extern TextMessageModule *textMessageModule;
\ No newline at end of file
@@ -13,6 +13,7 @@
  * @date [Insert Date]
  */
 #include "StoreForwardModule.h"
+#include "FSCommon.h"
 #include "MeshService.h"
 #include "NodeDB.h"
 #include "RTC.h"
@@ -24,6 +25,7 @@
 #include "mesh/generated/meshtastic/storeforward.pb.h"
 #include "modules/ModuleDev.h"
 #include <Arduino.h>
+#include <algorithm>
 #include <iterator>
 #include <map>
 
@@ -31,8 +33,11 @@ StoreForwardModule *storeForwardModule;
 
 int32_t StoreForwardModule::runOnce()
 {
-#ifdef ARCH_ESP32
+#if defined(ARCH_ESP32) || defined(ARCH_PORTDUINO)
     if (moduleConfig.store_forward.enabled && is_server) {
+        if (this->log)
+            this->log->flushIfDue();
+
         // Send out the message queue.
         if (this->busy) {
             // Only send packets if the channel is less than 25% utilized and until historyReturnMax
@@ -61,9 +66,15 @@ int32_t StoreForwardModule::runOnce()
 
 /**
  * Populates the PSRAM with data to be sent later when a device is out of range.
+ *
+ * @return false if we couldn't allocate the history.
  */
-void StoreForwardModule::populatePSRAM()
+bool StoreForwardModule::populatePSRAM()
 {
+    // With PSRAM the in memory history holds tens of thousands of messages, the log only a few hundred on a small flash
+    if ((STOREFORWARD_USE_LOG || memGet.getPsramSize() == 0) && openLog())
+        return true;
+
     /*
     For PSRAM usage, see:
         https://learn.upesy.com/en/programmation/psram.html#psram-tab
@@ -75,15 +86,76 @@ void StoreForwardModule::populatePSRAM()
     /* Use a maximum of 2/3 the available PSRAM unless otherwise specified.
         Note: This needs to be done after every thing that would use PSRAM
     */
+    size_t budget = (memGet.getFreePsram() / 3) * 2;
+
+    // Messages are stored at their actual size, so unless told otherwise allow one record for every 64 bytes
     uint32_t numberOfPackets =
-        (this->records ? this->records : (((memGet.getFreePsram() / 3) * 2) / sizeof(PacketHistoryStruct)));
+        (this->records ? this->records : budget / (64 + StoreForwardHistory::INDEX_BYTES_PER_RECORD));
+    size_t indexBytes = numberOfPackets * StoreForwardHistory::INDEX_BYTES_PER_RECORD;
+    size_t historyBytes = budget > indexBytes ? budget - indexBytes : 0;
+    if (this->records) // no need for more than the configured number of the biggest messages
+        historyBytes = std::min(historyBytes, numberOfPackets * StoreForwardHistory::maxRecordLen());
     this->records = numberOfPackets;
 
-    this->packetHistory = static_cast<PacketHistoryStruct *>(ps_calloc(numberOfPackets, sizeof(PacketHistoryStruct)));
+    bool ok = this->history.init(historyBytes, numberOfPackets);
 
     LOG_DEBUG("*** After PSRAM initialization: heap %d/%d PSRAM %d/%d\n", memGet.getFreeHeap(), memGet.getHeapSize(),
               memGet.getFreePsram(), memGet.getPsramSize());
-    LOG_DEBUG("*** numberOfPackets for packetHistory - %u\n", numberOfPackets);
+    LOG_DEBUG("*** numberOfPackets for packetHistory - %u in %u bytes\n", numberOfPackets, (uint32_t)historyBytes);
+    if (!ok)
+        LOG_ERROR("*** S&F - Could not allocate the message history\n");
+    return ok;
+}
+
+/**
+ * Opens the message log on the filesystem, so the history survives a reboot.  Only the index is kept in memory.
+ *
+ * @return false if there is no filesystem or we couldn't allocate the index.
+ */
+bool StoreForwardModule::openLog()
+{
+#ifdef FSCom
+    // Unless told otherwise allow one record for every 64 bytes of log, as far as STOREFORWARD_LOG_INDEX_BYTES allows
+    uint32_t numberOfPackets = this->records;
+    if (!numberOfPackets) {
+        uint32_t perRecord = StoreForwardLog::indexRecordLen() + StoreForwardHistory::INDEX_BYTES_PER_RECORD;
+        numberOfPackets = std::min((uint32_t)(STOREFORWARD_LOG_SEGMENTS * (STOREFORWARD_LOG_SEGMENT_BYTES / 64)),
+                                   (uint32_t)(STOREFORWARD_LOG_INDEX_BYTES / perRecord));
+    }
+    if (!this->history.init(numberOfPackets * StoreForwardLog::indexRecordLen(), numberOfPackets)) {
+        LOG_ERROR("*** S&F - Could not allocate the index for the message log\n");
+        return false;
+    }
+
+    this->log = new StoreForwardLog(this->history);
+    if (!this->log->begin("/storeforward")) {
+        LOG_ERROR("*** S&F - Could not open the message log, keeping the history in memory\n");
+        delete this->log;
+        this->log = NULL;
+        return false;
+    }
+    this->records = numberOfPackets;
+
+    // Don't send the phone again what we had before the reboot
+    lastRequest[nodeDB->getNodeNum()] = this->history.getNextSeq();
+    return true;
+#else
+    return false;
+#endif
+}
+
+void StoreForwardModule::flushHistory()
+{
+    if (this->log)
+        this->log->flush();
+}
+
+/**
+ * Copies out a record from the log or the in memory history.
+ */
+bool StoreForwardModule::getRecord(uint32_t seq, PacketHistoryStruct &record)
+{
+    return this->log ? this->log->get(seq, record) : this->history.get(seq, record);
 }
 
 /**
@@ -95,9 +167,7 @@ void StoreForwardModule::populatePSRAM()
 void StoreForwardModule::historySend(uint32_t secAgo, uint32_t to)
 {
     this->last_time = getTime() < secAgo ? 0 : getTime() - secAgo;
-    uint32_t queueSize = getNumAvailablePackets(to, last_time);
-    if (queueSize > this->historyReturnMax)
-        queueSize = this->historyReturnMax;
+    uint32_t queueSize = getNumAvailablePackets(to, last_time, this->historyReturnMax);
 
     if (queueSize) {
         LOG_INFO("*** S&F - Sending %u message(s)\n", queueSize);
@@ -121,24 +191,13 @@ void StoreForwardModule::historySend(uint32_t secAgo, uint32_t to)
  *
  * @param dest The destination node number.
  * @param last_time The relative time to start counting messages from.
+ * @param limit Stop counting once we have found this many.
  * @return The number of available packets in the message history.
  */
-uint32_t StoreForwardModule::getNumAvailablePackets(NodeNum dest, uint32_t last_time)
+uint32_t StoreForwardModule::getNumAvailablePackets(NodeNum dest, uint32_t last_time, uint32_t limit)
 {
-    uint32_t count = 0;
-    if (lastRequest.find(dest) == lastRequest.end()) {
-        lastRequest[dest] = 0;
-    }
-    for (uint32_t i = lastRequest[dest]; i < this->packetHistoryTotalCount; i++) {
-        if (this->packetHistory[i].time && (this->packetHistory[i].time > last_time)) {
-            // Client is only interested in packets not from itself and only in broadcast packets or packets towards it.
-            if (this->packetHistory[i].from != dest &&
-                (this->packetHistory[i].to == NODENUM_BROADCAST || this->packetHistory[i].to == dest)) {
-                count++;
-            }
-        }
-    }
-    return count;
+    // Client is only interested in packets not from itself and only in broadcast packets or packets towards it.
+    return this->history.count(dest, lastRequest[dest], last_time, limit);
 }
 
 /**
@@ -152,7 +211,7 @@ meshtastic_MeshPacket *StoreForwardModule::getForPhone()
         NodeNum to = nodeDB->getNodeNum();
         if (!this->busy) {
             // Get number of packets we're going to send in this loop
-            uint32_t histSize = getNumAvailablePackets(to, 0); // No time limit
+            uint32_t histSize = getNumAvailablePackets(to, 0, 1); // No time limit
             if (histSize) {
                 this->busy = true;
                 this->busyTo = to;
@@ -181,22 +240,11 @@ void StoreForwardModule::historyAdd(const meshtastic_MeshPacket &mp)
 {
     const auto &p = mp.decoded;
 
-    if (this->packetHistoryTotalCount == this->records) {
-        LOG_WARN("*** S&F - PSRAM Full. Starting overwrite now.\n");
-        this->packetHistoryTotalCount = 0;
-        for (auto &i : lastRequest) {
-            i.second = 0; // Clear the last request index for each client device
-        }
-    }
-
-    this->packetHistory[this->packetHistoryTotalCount].time = getTime();
-    this->packetHistory[this->packetHistoryTotalCount].to = mp.to;
-    this->packetHistory[this->packetHistoryTotalCount].channel = mp.channel;
-    this->packetHistory[this->packetHistoryTotalCount].from = getFrom(&mp);
-    this->packetHistory[this->packetHistoryTotalCount].payload_size = p.payload.size;
-    memcpy(this->packetHistory[this->packetHistoryTotalCount].payload, p.payload.bytes, meshtastic_Constants_DATA_PAYLOAD_LEN);
-
-    this->packetHistoryTotalCount++;
+    // Once the history is full the oldest records make way, client cursors pointing at them skip ahead to the oldest we keep
+    if (this->log)
+        this->log->add(getTime(), mp.to, getFrom(&mp), mp.channel, p.payload.bytes, p.payload.size);
+    else
+        this->history.add(getTime(), mp.to, getFrom(&mp), mp.channel, p.payload.bytes, p.payload.size);
 }
 
 /**
@@ -227,51 +275,52 @@ bool StoreForwardModule::sendPayload(NodeNum dest, uint32_t last_time)
  */
 meshtastic_MeshPacket *StoreForwardModule::preparePayload(NodeNum dest, uint32_t last_time, bool local)
 {
-    for (uint32_t i = lastRequest[dest]; i < this->packetHistoryTotalCount; i++) {
-        if (this->packetHistory[i].time && (this->packetHistory[i].time > last_time)) {
-            /*  Copy the messages that were received by the server in the last msAgo
-                to the packetHistoryTXQueue structure.
-                Client not interested in packets from itself and only in broadcast packets or packets towards it. */
-            if (this->packetHistory[i].from != dest &&
-                (this->packetHistory[i].to == NODENUM_BROADCAST || this->packetHistory[i].to == dest)) {
-
-                meshtastic_MeshPacket *p = allocDataPacket();
-
-                p->to = local ? this->packetHistory[i].to : dest; // PhoneAPI can handle original `to`
-                p->from = this->packetHistory[i].from;
-                p->channel = this->packetHistory[i].channel;
-                p->rx_time = this->packetHistory[i].time;
-
-                // Let's assume that if the server received the S&F request that the client is in range.
-                //   TODO: Make this configurable.
-                p->want_ack = false;
-
-                if (local) { // PhoneAPI gets normal TEXT_MESSAGE_APP
-                    p->decoded.portnum = meshtastic_PortNum_TEXT_MESSAGE_APP;
-                    memcpy(p->decoded.payload.bytes, this->packetHistory[i].payload, this->packetHistory[i].payload_size);
-                    p->decoded.payload.size = this->packetHistory[i].payload_size;
-                } else {
-                    meshtastic_StoreAndForward sf = meshtastic_StoreAndForward_init_zero;
-                    sf.which_variant = meshtastic_StoreAndForward_text_tag;
-                    sf.variant.text.size = this->packetHistory[i].payload_size;
-                    memcpy(sf.variant.text.bytes, this->packetHistory[i].payload, this->packetHistory[i].payload_size);
-                    if (this->packetHistory[i].to == NODENUM_BROADCAST) {
-                        sf.rr = meshtastic_StoreAndForward_RequestResponse_ROUTER_TEXT_BROADCAST;
-                    } else {
-                        sf.rr = meshtastic_StoreAndForward_RequestResponse_ROUTER_TEXT_DIRECT;
-                    }
-
-                    p->decoded.payload.size = pb_encode_to_bytes(p->decoded.payload.bytes, sizeof(p->decoded.payload.bytes),
-                                                                 &meshtastic_StoreAndForward_msg, &sf);
-                }
+    uint32_t seq;
+    PacketHistoryStruct record;
+    for (;;) {
+        if (!this->history.next(dest, lastRequest[dest], last_time, seq))
+            return nullptr;
+        if (getRecord(seq, record))
+            break;
+        lastRequest[dest] = seq + 1; // damaged in the log, skip it
+    }
 
-                lastRequest[dest] = i + 1; // Update the last request index for the client device
+    /*  Copy the messages that were received by the server in the last msAgo
+        to the packetHistoryTXQueue structure.
+        Client not interested in packets from itself and only in broadcast packets or packets towards it. */
+    meshtastic_MeshPacket *p = allocDataPacket();
 
-                return p;
-            }
+    p->to = local ? record.to : dest; // PhoneAPI can handle original `to`
+    p->from = record.from;
+    p->channel = record.channel;
+    p->rx_time = record.time;
+
+    // Let's assume that if the server received the S&F request that the client is in range.
+    //   TODO: Make this configurable.
+    p->want_ack = false;
+
+    if (local) { // PhoneAPI gets normal TEXT_MESSAGE_APP
+        p->decoded.portnum = meshtastic_PortNum_TEXT_MESSAGE_APP;
+        memcpy(p->decoded.payload.bytes, record.payload, record.payload_size);
+        p->decoded.payload.size = record.payload_size;
+    } else {
+        meshtastic_StoreAndForward sf = meshtastic_StoreAndForward_init_zero;
+        sf.which_variant = meshtastic_StoreAndForward_text_tag;
+        sf.variant.text.size = record.payload_size;
+        memcpy(sf.variant.text.bytes, record.payload, record.payload_size);
+        if (record.to == NODENUM_BROADCAST) {
+            sf.rr = meshtastic_StoreAndForward_RequestResponse_ROUTER_TEXT_BROADCAST;
+        } else {
+            sf.rr = meshtastic_StoreAndForward_RequestResponse_ROUTER_TEXT_DIRECT;
         }
+
+        p->decoded.payload.size =
+            pb_encode_to_bytes(p->decoded.payload.bytes, sizeof(p->decoded.payload.bytes), &meshtastic_StoreAndForward_msg, &sf);
     }
-    return nullptr;
+
+    lastRequest[dest] = seq + 1; // Update the last request index for the client device
+
+    return p;
 }
 
 /**
@@ -351,7 +400,7 @@ void StoreForwardModule::statsSend(uint32_t to)
     sf.rr = meshtastic_StoreAndForward_RequestResponse_ROUTER_STATS;
     sf.which_variant = meshtastic_StoreAndForward_stats_tag;
     sf.variant.stats.messages_total = this->records;
-    sf.variant.stats.messages_saved = this->packetHistoryTotalCount;
+    sf.variant.stats.messages_saved = this->history.getCount();
     sf.variant.stats.messages_max = this->records;
     sf.variant.stats.up_time = millis() / 1000;
     sf.variant.stats.requests = this->requests;
@@ -372,7 +421,7 @@ void StoreForwardModule::statsSend(uint32_t to)
  */
 ProcessMessage StoreForwardModule::handleReceived(const meshtastic_MeshPacket &mp)
 {
-#ifdef ARCH_ESP32
+#if defined(ARCH_ESP32) || defined(ARCH_PORTDUINO)
     if (moduleConfig.store_forward.enabled) {
 
         if ((mp.decoded.portnum == meshtastic_PortNum_TEXT_MESSAGE_APP) && is_server) {
@@ -389,7 +438,7 @@ ProcessMessage StoreForwardModule::handleReceived(const meshtastic_MeshPacket &m
                 }
             } else {
                 storeForwardModule->historyAdd(mp);
-                LOG_INFO("*** S&F stored. Message history contains %u records now.\n", this->packetHistoryTotalCount);
+                LOG_INFO("*** S&F stored. Message history contains %u records now.\n", this->history.getCount());
             }
         } else if (getFrom(&mp) != nodeDB->getNodeNum() && mp.decoded.portnum == meshtastic_PortNum_STORE_FORWARD_APP) {
             auto &p = mp.decoded;
@@ -555,7 +604,7 @@ StoreForwardModule::StoreForwardModule()
       ProtobufModule("StoreForward", meshtastic_PortNum_STORE_FORWARD_APP, &meshtastic_StoreAndForward_msg)
 {
 
-#ifdef ARCH_ESP32
+#if defined(ARCH_ESP32) || defined(ARCH_PORTDUINO)
 
     isPromiscuous = true; // Brown chicken brown cow
 
@@ -573,8 +622,13 @@ StoreForwardModule::StoreForwardModule()
         // Router
         if ((config.device.role == meshtastic_Config_DeviceConfig_Role_ROUTER || moduleConfig.store_forward.is_server)) {
             LOG_INFO("*** Initializing Store & Forward Module in Server mode\n");
-            if (memGet.getPsramSize() > 0) {
-                if (memGet.getFreePsram() >= 1024 * 1024) {
+#ifdef ARCH_PORTDUINO
+            const bool bigRam = true; // Linux doesn't need PSRAM for the history index
+#else
+            const bool bigRam = false;
+#endif
+            if (bigRam || memGet.getPsramSize() > 0) {
+                if (bigRam || memGet.getFreePsram() >= 1024 * 1024) {
 
                     // Do the startup here
 
@@ -597,8 +651,7 @@ StoreForwardModule::StoreForwardModule()
                         this->heartbeat = false;
 
                     // Popupate PSRAM with our data structures.
-                    this->populatePSRAM();
-                    is_server = true;
+                    is_server = this->populatePSRAM();
                 } else {
                     LOG_INFO("*** Device has less than 1M of PSRAM free.\n");
                     LOG_INFO("*** Store & Forward Module - disabling server.\n");
@@ -3,29 +3,22 @@
 #include "ProtobufModule.h"
 #include "concurrency/OSThread.h"
 #include "mesh/generated/meshtastic/storeforward.pb.h"
+#include "modules/StoreForwardHistory.h"
+#include "modules/StoreForwardLog.h"
 
 #include "configuration.h"
 #include <Arduino.h>
 #include <functional>
 #include <unordered_map>
 
-struct PacketHistoryStruct {
-    uint32_t time;
-    uint32_t to;
-    uint32_t from;
-    uint8_t channel;
-    uint8_t payload[meshtastic_Constants_DATA_PAYLOAD_LEN];
-    pb_size_t payload_size;
-};
-
 class StoreForwardModule : private concurrency::OSThread, public ProtobufModule<meshtastic_StoreAndForward>
 {
     bool busy = 0;
     uint32_t busyTo = 0;
     char routerMessage[meshtastic_Constants_DATA_PAYLOAD_LEN] = {0};
 
-    PacketHistoryStruct *packetHistory = 0;
-    uint32_t packetHistoryTotalCount = 0;
+    StoreForwardHistory history;
+    StoreForwardLog *log = NULL; // if set, the messages are on the filesystem and history only says where
     uint32_t last_time = 0;
     uint32_t requestCount = 0;
 
@@ -34,7 +27,8 @@ class StoreForwardModule : private concurrency::OSThread, public ProtobufModule<
     bool is_client = false;
     bool is_server = false;
 
-    // Unordered_map stores the last request for each nodeNum (`to` field)
+    // Unordered_map stores the last request for each nodeNum (`to` field): the history sequence number of the next record
+    // they haven't been sent
     std::unordered_map<NodeNum, uint32_t> lastRequest;
 
   public:
@@ -50,7 +44,7 @@ class StoreForwardModule : private concurrency::OSThread, public ProtobufModule<
     void historyAdd(const meshtastic_MeshPacket &mp);
     void statsSend(uint32_t to);
     void historySend(uint32_t secAgo, uint32_t to);
-    uint32_t getNumAvailablePackets(NodeNum dest, uint32_t last_time);
+    uint32_t getNumAvailablePackets(NodeNum dest, uint32_t last_time, uint32_t limit = StoreForwardHistory::NONE);
 
     /**
      * Send our payload into the mesh
@@ -64,6 +58,9 @@ class StoreForwardModule : private concurrency::OSThread, public ProtobufModule<
     // Returns true if we are configured as server AND we could allocate PSRAM.
     bool isServer() { return is_server; }
 
+    /// Write out any messages not yet in the log on the filesystem, call before rebooting or shutting down
+    void flushHistory();
+
     /*
       -Override the wantPacket method.
     */
@@ -77,9 +74,15 @@ class StoreForwardModule : private concurrency::OSThread, public ProtobufModule<
             return false;
         }
     }
+    virtual std::vector<meshtastic_PortNum> getPortNums() override
+    {
+        return {meshtastic_PortNum_TEXT_MESSAGE_APP, meshtastic_PortNum_STORE_FORWARD_APP};
+    }
 
   private:
-    void populatePSRAM();
+    bool populatePSRAM();
+    bool openLog();
+    bool getRecord(uint32_t seq, PacketHistoryStruct &record);
 
     // S&F Defaults
     uint32_t historyReturnMax = 25;     // Return maximum of 25 records by default.
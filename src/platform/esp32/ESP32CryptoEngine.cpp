@@ -2,16 +2,30 @@
 #include "configuration.h"
 
 #include "mbedtls/aes.h"
+#include <assert.h>
 
 class ESP32CryptoEngine : public CryptoEngine
 {
 
     mbedtls_aes_context aes;
 
+    /// Expanded key schedules for each channel, set up by setChannelKey
+    mbedtls_aes_context channelAes[MAX_NUM_CHANNELS];
+
   public:
-    ESP32CryptoEngine() { mbedtls_aes_init(&aes); }
+    ESP32CryptoEngine()
+    {
+        mbedtls_aes_init(&aes);
+        for (size_t i = 0; i < MAX_NUM_CHANNELS; i++)
+            mbedtls_aes_init(&channelAes[i]);
+    }
 
-    ~ESP32CryptoEngine() { mbedtls_aes_free(&aes); }
+    ~ESP32CryptoEngine()
+    {
+        mbedtls_aes_free(&aes);
+        for (size_t i = 0; i < MAX_NUM_CHANNELS; i++)
+            mbedtls_aes_free(&channelAes[i]);
+    }
 
     /**
      * Encrypt a packet
@@ -24,18 +38,31 @@ class ESP32CryptoEngine : public CryptoEngine
         if (_key.length > 0) {
             if (numBytes <= MAX_BLOCKSIZE) {
                 mbedtls_aes_setkey_enc(&aes, _key.bytes, _key.length * 8);
-                static uint8_t scratch[MAX_BLOCKSIZE];
                 uint8_t stream_block[16];
                 size_t nc_off = 0;
-                memcpy(scratch, bytes, numBytes);
-                memset(scratch + numBytes, 0,
-                       sizeof(scratch) - numBytes); // Fill rest of buffer with zero (in case cypher looks at it)
-                mbedtls_aes_crypt_ctr(&aes, numBytes, &nc_off, _nonce, stream_block, scratch, bytes);
+                mbedtls_aes_crypt_ctr(&aes, numBytes, &nc_off, _nonce, stream_block, bytes, bytes); // CTR is safe in place
             } else {
                 LOG_ERROR("Packet too large for crypto engine: %d. noop encryption!\n", numBytes);
             }
         }
     }
+
+    virtual void setChannelKey(uint8_t chIndex, const CryptoKey &k) override
+    {
+        assert(chIndex < MAX_NUM_CHANNELS);
+        channelKeys[chIndex] = k;
+        if (k.length > 0)
+            mbedtls_aes_setkey_enc(&channelAes[chIndex], k.bytes, k.length * 8);
+    }
+
+    virtual void encryptChannelAESCtr(uint8_t chIndex, uint8_t *_nonce, size_t numBytes, uint8_t *bytes) override
+    {
+        if (channelKeys[chIndex].length > 0) {
+            uint8_t stream_block[16];
+            size_t nc_off = 0;
+            mbedtls_aes_crypt_ctr(&channelAes[chIndex], numBytes, &nc_off, _nonce, stream_block, bytes, bytes);
+        }
+    }
 };
 
 CryptoEngine *crypto = new ESP32CryptoEngine();
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "aes-256/tiny-aes.h"
 #include "configuration.h"
 #include <Adafruit_nRFCrypto.h>
+#include <assert.h>
 class NRF52CryptoEngine : public CryptoEngine
 {
   public:
@@ -27,6 +28,28 @@ class NRF52CryptoEngine : public CryptoEngine
             memcpy(bytes, encBuf, numBytes);
         }
     }
+
+    virtual void setChannelKey(uint8_t chIndex, const CryptoKey &k) override
+    {
+        assert(chIndex < MAX_NUM_CHANNELS);
+        channelKeys[chIndex] = k;
+        // AES128 is done by the CC310, which takes the raw key, so we only need to expand AES256 keys for tiny-aes
+        if (k.length > 16)
+            AES_init_ctx(&channelAes[chIndex], k.bytes);
+    }
+
+    virtual void encryptChannelAESCtr(uint8_t chIndex, uint8_t *_nonce, size_t numBytes, uint8_t *bytes) override
+    {
+        if (channelKeys[chIndex].length > 16) {
+            AES_ctx_set_iv(&channelAes[chIndex], _nonce);
+            AES_CTR_xcrypt_buffer(&channelAes[chIndex], bytes, numBytes);
+        } else {
+            encryptAESCtr(channelKeys[chIndex], _nonce, numBytes, bytes);
+        }
+    }
+
+  private:
+    AES_ctx channelAes[MAX_NUM_CHANNELS];
 };
 
 CryptoEngine *crypto = new NRF52CryptoEngine();
\ No newline at end of file
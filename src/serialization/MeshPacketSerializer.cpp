@@ -1,6 +1,7 @@
 #include "MeshPacketSerializer.h"
 #include "JSON.h"
 #include "NodeDB.h"
+#include "mesh/DecodeCache.h"
 #include "mesh/generated/meshtastic/mqtt.pb.h"
 #include "mesh/generated/meshtastic/telemetry.pb.h"
 #include "modules/RoutingModule.h"
@@ -54,7 +55,7 @@ std::string MeshPacketSerializer::JsonSerialize(const meshtastic_MeshPacket *mp,
             meshtastic_Telemetry scratch;
             meshtastic_Telemetry *decoded = NULL;
             memset(&scratch, 0, sizeof(scratch));
-            if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_Telemetry_msg, &scratch)) {
+            if (decodeCache.decode(*mp, &meshtastic_Telemetry_msg, &scratch)) {
                 decoded = &scratch;
                 if (decoded->which_variant == meshtastic_Telemetry_device_metrics_tag) {
                     msgPayload["battery_level"] = new JSONValue((unsigned int)decoded->variant.device_metrics.battery_level);
@@ -95,7 +96,7 @@ std::string MeshPacketSerializer::JsonSerialize(const meshtastic_MeshPacket *mp,
             meshtastic_User scratch;
             meshtastic_User *decoded = NULL;
             memset(&scratch, 0, sizeof(scratch));
-            if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_User_msg, &scratch)) {
+            if (decodeCache.decode(*mp, &meshtastic_User_msg, &scratch)) {
                 decoded = &scratch;
                 msgPayload["id"] = new JSONValue(decoded->id);
                 msgPayload["longname"] = new JSONValue(decoded->long_name);
@@ -113,7 +114,7 @@ std::string MeshPacketSerializer::JsonSerialize(const meshtastic_MeshPacket *mp,
             meshtastic_Position scratch;
             meshtastic_Position *decoded = NULL;
             memset(&scratch, 0, sizeof(scratch));
-            if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_Position_msg, &scratch)) {
+            if (decodeCache.decode(*mp, &meshtastic_Position_msg, &scratch)) {
                 decoded = &scratch;
                 if ((int)decoded->time) {
                     msgPayload["time"] = new JSONValue((unsigned int)decoded->time);
@@ -158,7 +159,7 @@ std::string MeshPacketSerializer::JsonSerialize(const meshtastic_MeshPacket *mp,
             meshtastic_Waypoint scratch;
             meshtastic_Waypoint *decoded = NULL;
             memset(&scratch, 0, sizeof(scratch));
-            if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_Waypoint_msg, &scratch)) {
+            if (decodeCache.decode(*mp, &meshtastic_Waypoint_msg, &scratch)) {
                 decoded = &scratch;
                 msgPayload["id"] = new JSONValue((unsigned int)decoded->id);
                 msgPayload["name"] = new JSONValue(decoded->name);
@@ -178,8 +179,7 @@ std::string MeshPacketSerializer::JsonSerialize(const meshtastic_MeshPacket *mp,
             meshtastic_NeighborInfo scratch;
             meshtastic_NeighborInfo *decoded = NULL;
             memset(&scratch, 0, sizeof(scratch));
-            if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_NeighborInfo_msg,
-                                     &scratch)) {
+            if (decodeCache.decode(*mp, &meshtastic_NeighborInfo_msg, &scratch)) {
                 decoded = &scratch;
                 msgPayload["node_id"] = new JSONValue((unsigned int)decoded->node_id);
                 msgPayload["node_broadcast_interval_secs"] = new JSONValue((unsigned int)decoded->node_broadcast_interval_secs);
@@ -205,8 +205,7 @@ std::string MeshPacketSerializer::JsonSerialize(const meshtastic_MeshPacket *mp,
                 meshtastic_RouteDiscovery scratch;
                 meshtastic_RouteDiscovery *decoded = NULL;
                 memset(&scratch, 0, sizeof(scratch));
-                if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_RouteDiscovery_msg,
-                                         &scratch)) {
+                if (decodeCache.decode(*mp, &meshtastic_RouteDiscovery_msg, &scratch)) {
                     decoded = &scratch;
                     JSONArray route; // Route this message took
                     // Lambda function for adding a long name to the route
@@ -247,7 +246,7 @@ std::string MeshPacketSerializer::JsonSerialize(const meshtastic_MeshPacket *mp,
             meshtastic_Paxcount scratch;
             meshtastic_Paxcount *decoded = NULL;
             memset(&scratch, 0, sizeof(scratch));
-            if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_Paxcount_msg, &scratch)) {
+            if (decodeCache.decode(*mp, &meshtastic_Paxcount_msg, &scratch)) {
                 decoded = &scratch;
                 msgPayload["wifi_count"] = new JSONValue((unsigned int)decoded->wifi);
                 msgPayload["ble_count"] = new JSONValue((unsigned int)decoded->ble);
@@ -263,8 +262,7 @@ std::string MeshPacketSerializer::JsonSerialize(const meshtastic_MeshPacket *mp,
             meshtastic_HardwareMessage scratch;
             meshtastic_HardwareMessage *decoded = NULL;
             memset(&scratch, 0, sizeof(scratch));
-            if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_HardwareMessage_msg,
-                                     &scratch)) {
+            if (decodeCache.decode(*mp, &meshtastic_HardwareMessage_msg, &scratch)) {
                 decoded = &scratch;
                 if (decoded->type == meshtastic_HardwareMessage_Type_GPIOS_CHANGED) {
                     msgType = "gpios_changed";
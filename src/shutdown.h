@@ -8,11 +8,25 @@
 #include "input/LinuxInputImpl.h"
 
 #endif
+#if (defined(ARCH_ESP32) || defined(ARCH_PORTDUINO)) && !MESHTASTIC_EXCLUDE_STOREFORWARD
+#include "modules/esp32/StoreForwardModule.h"
+#endif
+
+/// Write out anything we were holding back to save flash writes
+static void flushBeforePowerOff()
+{
+#if (defined(ARCH_ESP32) || defined(ARCH_PORTDUINO)) && !MESHTASTIC_EXCLUDE_STOREFORWARD
+    if (storeForwardModule)
+        storeForwardModule->flushHistory();
+#endif
+}
 
 void powerCommandsCheck()
 {
     if (rebootAtMsec && millis() > rebootAtMsec) {
         LOG_INFO("Rebooting\n");
+        flushBeforePowerOff();
+        console->flush(); // print any log messages still waiting in the log ring
 #if defined(ARCH_ESP32)
         ESP.restart();
 #elif defined(ARCH_NRF52)
@@ -44,6 +58,8 @@ void powerCommandsCheck()
 
     if (shutdownAtMsec && millis() > shutdownAtMsec) {
         LOG_INFO("Shutting down from admin command\n");
+        flushBeforePowerOff();
+        console->flush();
 #if defined(ARCH_NRF52) || defined(ARCH_ESP32)
         playShutdownMelody();
         power->shutdown();
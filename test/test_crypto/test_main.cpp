@@ -1,4 +1,5 @@
 #include "CryptoEngine.h"
+#include "aes-ccm.h"
 
 #include <unity.h>
 
@@ -99,6 +100,54 @@ void test_DH25519(void)
     crypto->setDHPrivateKey(private_key);
     TEST_ASSERT(!crypto->setDHPublicKey(public_key)); // Weak public key results in 0 shared key
 }
+void test_DH25519_cache(void)
+{
+    uint8_t private_key[32];
+    uint8_t public_key[32];
+    uint8_t uncached_key[32];
+    uint8_t nonce[16] = {0};
+    uint8_t plain[32];
+    uint8_t uncached_crypt[32];
+    uint8_t cached_crypt[32];
+    uint8_t auth[16];
+    memcpy(plain, "The quick brown fox jumps over.", 32);
+
+    HexToBytes(public_key, "504a36999f489cd2fdbc08baff3d88fa00569ba986cba22548ffde80f9806829");
+    HexToBytes(private_key, "c8a9d5a91091ad851c668b0736c1c9a02936c0d3ad62670858088047ba057475");
+    crypto->setDHPrivateKey(private_key);
+    crypto->clearDHKeyCache();
+
+    // Uncached path: scalar multiplication then hash, as setDHKey always did
+    TEST_ASSERT(crypto->setDHPublicKey(public_key));
+    crypto->hash(crypto->shared_key, 32);
+    memcpy(uncached_key, crypto->shared_key, 32);
+    aes_ccm_ae(uncached_key, 32, nonce, 8, plain, sizeof(plain), nullptr, 0, uncached_crypt, auth);
+
+    uint32_t hits = crypto->getDHKeyCacheHits(), misses = crypto->getDHKeyCacheMisses();
+
+    // First lookup misses and fills the cache, the second must hit and give the same key and ciphertext
+    TEST_ASSERT(crypto->setDHKey(0x1234, public_key));
+    TEST_ASSERT_EQUAL_MEMORY(uncached_key, crypto->shared_key, 32);
+    TEST_ASSERT_EQUAL_UINT32(misses + 1, crypto->getDHKeyCacheMisses());
+
+    memset(crypto->shared_key, 0, 32);
+    TEST_ASSERT(crypto->setDHKey(0x1234, public_key));
+    TEST_ASSERT_EQUAL_UINT32(hits + 1, crypto->getDHKeyCacheHits());
+    aes_ccm_ae(crypto->shared_key, 32, nonce, 8, plain, sizeof(plain), nullptr, 0, cached_crypt, auth);
+    TEST_ASSERT_EQUAL_MEMORY(uncached_crypt, cached_crypt, sizeof(plain));
+
+    // A new private key must invalidate everything we cached
+    HexToBytes(private_key, "d85d8c061a50804ac488ad774ac716c3f5ba714b2712e048491379a500211958");
+    crypto->setDHPrivateKey(private_key);
+    TEST_ASSERT(crypto->setDHKey(0x1234, public_key));
+    TEST_ASSERT_EQUAL_UINT32(misses + 2, crypto->getDHKeyCacheMisses());
+    TEST_ASSERT(memcmp(uncached_key, crypto->shared_key, 32) != 0);
+
+    // As must the peer changing keys
+    HexToBytes(public_key, "63aa40c6e38346c5caf23a6df0a5e6c80889a08647e551b3563449befcfc9733");
+    TEST_ASSERT(crypto->setDHKey(0x1234, public_key));
+    TEST_ASSERT_EQUAL_UINT32(misses + 3, crypto->getDHKeyCacheMisses());
+}
 void test_AES_CTR(void)
 {
     uint8_t expected[32];
@@ -123,6 +172,55 @@ void test_AES_CTR(void)
     HexToBytes(expected, "E4095D4FB7A7B3792D6175A3261311B8");
     crypto->encryptAESCtr(k, nonce, 16, plain);
     TEST_ASSERT_EQUAL_MEMORY(expected, plain, 16);
+
+    // Same vector through a precomputed channel key schedule
+    memcpy(plain, "Single block msg", 16);
+    HexToBytes(nonce, "00000030000000000000000000000001");
+    crypto->setChannelKey(0, k);
+    crypto->encryptChannelAESCtr(0, nonce, 16, plain);
+    TEST_ASSERT_EQUAL_MEMORY(expected, plain, 16);
+}
+void test_AES_CTR_benchmark(void)
+{
+    const uint32_t numPackets = 10000;
+    uint8_t nonce[16];
+    uint8_t packet[237]; // biggest LoRa payload
+    CryptoKey k;
+    char msg[120];
+
+    k.length = 32;
+    HexToBytes(k.bytes, "776BEFF2851DB06F4C8A0542C8696F6C6A81AF1EEC96B4D37FC1D689E6C1C104");
+    memset(packet, 0x55, sizeof(packet));
+    crypto->setChannelKey(1, k);
+
+    // Old path: key schedule for every packet
+    uint32_t start = micros();
+    for (uint32_t i = 0; i < numPackets; i++) {
+        HexToBytes(nonce, "00000060DB5672C97AA8F0B200000001");
+        crypto->encryptAESCtr(k, nonce, sizeof(packet), packet);
+    }
+    uint32_t perPacketKey = micros() - start;
+
+    start = micros();
+    for (uint32_t i = 0; i < numPackets; i++) {
+        HexToBytes(nonce, "00000060DB5672C97AA8F0B200000001");
+        crypto->encryptChannelAESCtr(1, nonce, sizeof(packet), packet);
+    }
+    uint32_t channelKey = micros() - start;
+
+    snprintf(msg, sizeof(msg), "AES256-CTR %u byte packet: %u ns with key setup, %u ns with channel key", (unsigned)sizeof(packet),
+             (uint32_t)((uint64_t)perPacketKey * 1000 / numPackets), (uint32_t)((uint64_t)channelKey * 1000 / numPackets));
+    TEST_MESSAGE(msg);
+
+    // Both paths must still agree
+    uint8_t a[sizeof(packet)], b[sizeof(packet)];
+    memcpy(a, packet, sizeof(packet));
+    memcpy(b, packet, sizeof(packet));
+    HexToBytes(nonce, "00000060DB5672C97AA8F0B200000001");
+    crypto->encryptAESCtr(k, nonce, sizeof(a), a);
+    HexToBytes(nonce, "00000060DB5672C97AA8F0B200000001");
+    crypto->encryptChannelAESCtr(1, nonce, sizeof(b), b);
+    TEST_ASSERT_EQUAL_MEMORY(a, b, sizeof(a));
 }
 
 void setup()
@@ -135,7 +233,9 @@ void setup()
     RUN_TEST(test_SHA256);
     RUN_TEST(test_ECB_AES256);
     RUN_TEST(test_DH25519);
+    RUN_TEST(test_DH25519_cache);
     RUN_TEST(test_AES_CTR);
+    RUN_TEST(test_AES_CTR_benchmark);
 }
 
 void loop()
@@ -0,0 +1,128 @@
+#include "DecodeCache.h"
+#include "mesh/generated/meshtastic/telemetry.pb.h"
+
+#include <unity.h>
+
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+static meshtastic_MeshPacket makePositionPacket(int32_t lat)
+{
+    meshtastic_MeshPacket mp = meshtastic_MeshPacket_init_zero;
+    mp.which_payload_variant = meshtastic_MeshPacket_decoded_tag;
+    mp.decoded.portnum = meshtastic_PortNum_POSITION_APP;
+
+    meshtastic_Position pos = meshtastic_Position_init_zero;
+    pos.has_latitude_i = true;
+    pos.latitude_i = lat;
+    pos.has_longitude_i = true;
+    pos.longitude_i = -1223456789;
+    pos.altitude = 42;
+    pos.time = 1700000000;
+    mp.decoded.payload.size =
+        pb_encode_to_bytes(mp.decoded.payload.bytes, sizeof(mp.decoded.payload.bytes), &meshtastic_Position_msg, &pos);
+    return mp;
+}
+
+void test_decode_once(void)
+{
+    DecodeCache cache;
+    meshtastic_MeshPacket mp = makePositionPacket(374211234);
+
+    // Five consumers of the same packet, only the first one decodes
+    for (int i = 0; i < 5; i++) {
+        meshtastic_Position pos;
+        TEST_ASSERT_TRUE(cache.decode(mp, &meshtastic_Position_msg, &pos));
+        TEST_ASSERT_EQUAL_INT32(374211234, pos.latitude_i);
+        TEST_ASSERT_EQUAL_INT32(-1223456789, pos.longitude_i);
+        pos.latitude_i = 0; // consumers may scribble on their copy
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, cache.getStats().decodes);
+    TEST_ASSERT_EQUAL_UINT32(4, cache.getStats().hits);
+
+    // A module rewriting the payload must not get the old struct back
+    meshtastic_MeshPacket altered = makePositionPacket(1);
+    meshtastic_Position pos;
+    TEST_ASSERT_TRUE(cache.decode(altered, &meshtastic_Position_msg, &pos));
+    TEST_ASSERT_EQUAL_INT32(1, pos.latitude_i);
+    TEST_ASSERT_EQUAL_UINT32(2, cache.getStats().decodes);
+
+    // Both are still remembered
+    TEST_ASSERT_TRUE(cache.decode(mp, &meshtastic_Position_msg, &pos));
+    TEST_ASSERT_EQUAL_INT32(374211234, pos.latitude_i);
+    TEST_ASSERT_EQUAL_UINT32(2, cache.getStats().decodes);
+
+    // The same bytes read as a different message type are a different entry
+    meshtastic_Telemetry t;
+    cache.decode(mp, &meshtastic_Telemetry_msg, &t);
+    TEST_ASSERT_EQUAL_UINT32(3, cache.getStats().decodes);
+}
+
+void test_bad_payload(void)
+{
+    DecodeCache cache;
+    meshtastic_MeshPacket mp = makePositionPacket(5);
+    mp.decoded.payload.size = 3; // truncated mid field
+
+    meshtastic_Position pos;
+    TEST_ASSERT_FALSE(cache.decode(mp, &meshtastic_Position_msg, &pos));
+    TEST_ASSERT_FALSE(cache.decode(mp, &meshtastic_Position_msg, &pos));
+    TEST_ASSERT_EQUAL_UINT32(1, cache.getStats().decodes);
+}
+
+void test_benchmark(void)
+{
+    // A position packet seen by its ProtobufModule (handleReceived + alterReceived), the JSON serializer and two sniffers
+    const uint32_t numPackets = 10000, consumers = 5;
+    DecodeCache cache;
+    meshtastic_Position pos;
+
+    uint32_t start = micros();
+    for (uint32_t i = 0; i < numPackets; i++) {
+        meshtastic_MeshPacket mp = makePositionPacket(i);
+        for (uint32_t c = 0; c < consumers; c++) {
+            memset(&pos, 0, sizeof(pos));
+            pb_decode_from_bytes(mp.decoded.payload.bytes, mp.decoded.payload.size, &meshtastic_Position_msg, &pos);
+        }
+    }
+    uint32_t direct = micros() - start;
+
+    start = micros();
+    for (uint32_t i = 0; i < numPackets; i++) {
+        meshtastic_MeshPacket mp = makePositionPacket(i);
+        for (uint32_t c = 0; c < consumers; c++)
+            cache.decode(mp, &meshtastic_Position_msg, &pos);
+    }
+    uint32_t cached = micros() - start;
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "%u consumers/packet: decode each %u ns/packet, cached %u ns/packet, %u decodes for %u packets",
+             consumers, (uint32_t)((uint64_t)direct * 1000 / numPackets), (uint32_t)((uint64_t)cached * 1000 / numPackets),
+             cache.getStats().decodes, numPackets);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_EQUAL_UINT32(numPackets, cache.getStats().decodes);
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs
+    // if board doesn't support software reset via Serial.DTR/RTS
+    delay(2000);
+
+    UNITY_BEGIN(); // IMPORTANT LINE!
+    RUN_TEST(test_decode_once);
+    RUN_TEST(test_bad_payload);
+    RUN_TEST(test_benchmark);
+}
+
+void loop()
+{
+    UNITY_END(); // stop unit testing
+}
@@ -0,0 +1,151 @@
+#include "MeshService.h"
+#include "NodeDB.h"
+#include "ReliableRouter.h"
+#include "airtime.h"
+#include "mesh-pb-constants.h"
+#include "mesh/StreamFrameParser.h"
+#include "mesh/api/EpollServerAPI.h"
+#include "modules/esp32/StoreForwardModule.h"
+#include "platform/portduino/PortduinoGlue.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <unity.h>
+
+#define TEST_PORT 14499
+#define CONFIG_NONCE 4242
+
+static EpollServerPort *apiPort;
+static int clientFd = -1;
+static StreamFrameParser rxParser;
+
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+/// Run the main loop until the server sends us a FromRadio that 'match' accepts, or 'msec' has passed
+template <typename Match> static bool runUntil(uint32_t msec, Match match)
+{
+    uint32_t start = millis();
+    while (millis() - start < msec) {
+        concurrency::mainController.runOrDelay();
+
+        uint8_t buf[1024];
+        ssize_t n;
+        while ((n = recv(clientFd, buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+            size_t used = 0;
+            while (used < (size_t)n) {
+                bool gotFrame;
+                used += rxParser.parse(buf + used, n - used, gotFrame);
+                if (!gotFrame)
+                    continue;
+                meshtastic_FromRadio fr = meshtastic_FromRadio_init_zero;
+                const uint8_t *payload = rxParser.getPayload();
+                if (pb_decode_from_bytes(payload, rxParser.getPayloadLen(), &meshtastic_FromRadio_msg, &fr) && match(fr))
+                    return true;
+            }
+        }
+        delay(1);
+    }
+    return false;
+}
+
+static void sendToRadio(const meshtastic_ToRadio &t)
+{
+    uint8_t frame[StreamFrameParser::HEADER_LEN + meshtastic_ToRadio_size];
+    size_t len = pb_encode_to_bytes(frame + StreamFrameParser::HEADER_LEN, meshtastic_ToRadio_size, &meshtastic_ToRadio_msg, &t);
+    frame[0] = StreamFrameParser::START1;
+    frame[1] = StreamFrameParser::START2;
+    frame[2] = (len >> 8) & 0xff;
+    frame[3] = len & 0xff;
+    TEST_ASSERT_EQUAL(StreamFrameParser::HEADER_LEN + len, send(clientFd, frame, StreamFrameParser::HEADER_LEN + len, 0));
+}
+
+/// A TCP API client on an S&F server gets text messages, which sendToPhone() leaves to the S&F history
+void test_text_reaches_client(void)
+{
+    TEST_ASSERT_TRUE(storeForwardModule->isServer());
+
+    // Connect and download the config, after which the client is ready for packets
+    clientFd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(TEST_PORT);
+    TEST_ASSERT_EQUAL(0, connect(clientFd, (struct sockaddr *)&addr, sizeof(addr)));
+
+    meshtastic_ToRadio t = meshtastic_ToRadio_init_zero;
+    t.which_payload_variant = meshtastic_ToRadio_want_config_id_tag;
+    t.want_config_id = CONFIG_NONCE;
+    sendToRadio(t);
+    TEST_ASSERT_TRUE(runUntil(5000, [](const meshtastic_FromRadio &fr) {
+        return fr.which_payload_variant == meshtastic_FromRadio_config_complete_id_tag && fr.config_complete_id == CONFIG_NONCE;
+    }));
+
+    // What the module does with a text it hears, then what the router does
+    const char *text = "stored and forwarded";
+    meshtastic_MeshPacket *p = packetPool.allocZeroed();
+    p->from = 0x1234;
+    p->to = NODENUM_BROADCAST;
+    p->id = 0x5678;
+    p->which_payload_variant = meshtastic_MeshPacket_decoded_tag;
+    p->decoded.portnum = meshtastic_PortNum_TEXT_MESSAGE_APP;
+    p->decoded.payload.size = strlen(text);
+    memcpy(p->decoded.payload.bytes, text, p->decoded.payload.size);
+    storeForwardModule->historyAdd(*p);
+    service->sendToPhone(p);
+
+    TEST_ASSERT_TRUE(runUntil(5000, [text](const meshtastic_FromRadio &fr) {
+        return fr.which_payload_variant == meshtastic_FromRadio_packet_tag &&
+               fr.packet.decoded.portnum == meshtastic_PortNum_TEXT_MESSAGE_APP && fr.packet.from == 0x1234 &&
+               fr.packet.decoded.payload.size == strlen(text) && memcmp(fr.packet.decoded.payload.bytes, text, strlen(text)) == 0;
+    }));
+
+    close(clientFd);
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs
+    // if board doesn't support software reset via Serial.DTR/RTS
+    delay(2000);
+
+    // What main.cpp's setup() would have done for us
+    concurrency::hasBeenSetup = true;
+    concurrency::OSThread::setup();
+    if (!settingsMap[maxnodes])
+        settingsMap[maxnodes] = 200;
+    if (!settingsMap[maxtophone])
+        settingsMap[maxtophone] = 100;
+    FSBegin();
+    nodeDB = new NodeDB();
+    router = new ReliableRouter();
+    service = new MeshService();
+    airTime = new AirTime();
+
+    config.device.role = meshtastic_Config_DeviceConfig_Role_ROUTER;
+    moduleConfig.store_forward.enabled = true;
+    moduleConfig.store_forward.is_server = true;
+    moduleConfig.store_forward.heartbeat = false;
+    storeForwardModule = new StoreForwardModule();
+
+    apiPort = new EpollServerPort(TEST_PORT);
+    apiPort->init();
+
+    UNITY_BEGIN(); // IMPORTANT LINE!
+    RUN_TEST(test_text_reaches_client);
+}
+
+void loop()
+{
+    UNITY_END(); // stop unit testing
+}
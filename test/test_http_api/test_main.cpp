@@ -0,0 +1,157 @@
+#include "MeshService.h"
+#include "NodeDB.h"
+#include "ReliableRouter.h"
+#include "airtime.h"
+#include "mesh-pb-constants.h"
+#include "mesh/StreamFrameParser.h"
+#include "mesh/raspihttp/HttpAPI.h"
+#include "platform/portduino/PortduinoGlue.h"
+
+#include <atomic>
+#include <string.h>
+#include <thread>
+#include <unity.h>
+
+#define CONFIG_NONCE 4242
+#define TEST_FROM 0x1234
+#define TEST_TEXT "to every stream"
+
+static HttpAPI *api;
+
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+/// What a fromradio/stream response would see: a web server thread taking records from its own outbox
+struct StreamReader {
+    HttpAPIOutbox *outbox;
+    StreamFrameParser parser;
+    std::atomic<uint32_t> numRecords{0};
+    std::atomic<bool> gotConfig{false}, gotText{false}; // the main loop watches these
+
+    void run(const std::atomic<bool> &stop)
+    {
+        uint8_t buf[8192];
+        while (!stop && !(gotConfig && gotText)) {
+            size_t n = api->take(outbox, buf, sizeof(buf), false, 100);
+            size_t used = 0;
+            while (used < n) {
+                bool gotFrame;
+                used += parser.parse(buf + used, n - used, gotFrame);
+                if (gotFrame)
+                    onRecord(parser.getPayload(), parser.getPayloadLen());
+            }
+        }
+    }
+
+    void onRecord(const uint8_t *payload, size_t len)
+    {
+        meshtastic_FromRadio fr = meshtastic_FromRadio_init_zero;
+        if (!pb_decode_from_bytes(payload, len, &meshtastic_FromRadio_msg, &fr))
+            return;
+        numRecords++;
+        if (fr.which_payload_variant == meshtastic_FromRadio_config_complete_id_tag && fr.config_complete_id == CONFIG_NONCE)
+            gotConfig = true;
+        if (fr.which_payload_variant == meshtastic_FromRadio_packet_tag && fr.packet.from == TEST_FROM &&
+            fr.packet.decoded.payload.size == strlen(TEST_TEXT))
+            gotText = true;
+    }
+};
+
+/// Run the main loop until both readers are done or 'msec' has passed
+static bool runUntilDone(StreamReader &a, StreamReader &b, uint32_t msec)
+{
+    uint32_t start = millis();
+    while (millis() - start < msec) {
+        concurrency::mainController.runOrDelay();
+        if (a.gotConfig && a.gotText && b.gotConfig && b.gotText)
+            return true;
+        delay(1);
+    }
+    return false;
+}
+
+/// Every attached stream must see the whole session, not just the records the other streams didn't take first
+void test_two_streams(void)
+{
+    StreamReader a, b;
+    a.outbox = api->attach();
+    b.outbox = api->attach();
+
+    std::atomic<bool> stop(false);
+    std::thread ta([&] { a.run(stop); });
+    std::thread tb([&] { b.run(stop); });
+
+    // A PUT toradio with want_config, from yet another web server thread
+    std::thread put([] {
+        meshtastic_ToRadio t = meshtastic_ToRadio_init_zero;
+        t.which_payload_variant = meshtastic_ToRadio_want_config_id_tag;
+        t.want_config_id = CONFIG_NONCE;
+        uint8_t buf[meshtastic_ToRadio_size];
+        size_t len = pb_encode_to_bytes(buf, sizeof(buf), &meshtastic_ToRadio_msg, &t);
+        api->queueToRadio(buf, len);
+    });
+    put.join();
+
+    // Let the config download finish, then a text message arrives for the client
+    uint32_t start = millis();
+    while (millis() - start < 5000 && !(a.gotConfig && b.gotConfig)) {
+        concurrency::mainController.runOrDelay();
+        delay(1);
+    }
+    meshtastic_MeshPacket *p = packetPool.allocZeroed();
+    p->from = TEST_FROM;
+    p->to = NODENUM_BROADCAST;
+    p->id = 0x5678;
+    p->which_payload_variant = meshtastic_MeshPacket_decoded_tag;
+    p->decoded.portnum = meshtastic_PortNum_TEXT_MESSAGE_APP;
+    p->decoded.payload.size = strlen(TEST_TEXT);
+    memcpy(p->decoded.payload.bytes, TEST_TEXT, p->decoded.payload.size);
+    service->sendToPhone(p);
+
+    bool done = runUntilDone(a, b, 5000);
+    stop = true;
+    ta.join();
+    tb.join();
+    api->detach(a.outbox);
+    api->detach(b.outbox);
+
+    TEST_ASSERT_TRUE(done);
+    TEST_ASSERT_EQUAL_UINT32(a.numRecords.load(), b.numRecords.load());
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs
+    // if board doesn't support software reset via Serial.DTR/RTS
+    delay(2000);
+
+    // What main.cpp's setup() would have done for us
+    concurrency::hasBeenSetup = true;
+    concurrency::OSThread::setup();
+    if (!settingsMap[maxnodes])
+        settingsMap[maxnodes] = 200;
+    if (!settingsMap[maxtophone])
+        settingsMap[maxtophone] = 100;
+    FSBegin();
+    nodeDB = new NodeDB();
+    router = new ReliableRouter();
+    service = new MeshService();
+    airTime = new AirTime();
+
+    api = new HttpAPI();
+
+    UNITY_BEGIN(); // IMPORTANT LINE!
+    RUN_TEST(test_two_streams);
+}
+
+void loop()
+{
+    UNITY_END(); // stop unit testing
+}
@@ -0,0 +1,191 @@
+#include "LogRing.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <unity.h>
+#include <vector>
+
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+/// Format a message the way RedirectablePrint::log does before pushing it
+static bool pushf(LogRing &ring, uint8_t level, const char *format, ...) __attribute__((format(printf, 3, 4)));
+static bool pushf(LogRing &ring, uint8_t level, const char *format, ...)
+{
+    char text[LogRing::MAX_RECORD];
+    va_list arg;
+    va_start(arg, format);
+    int n = vsnprintf(text, sizeof(text), format, arg);
+    va_end(arg);
+    return ring.push(level, millis(), "Test", text, n < (int)sizeof(text) ? n : sizeof(text) - 1);
+}
+
+void test_truncation(void)
+{
+    LogRing ring(4096);
+    LogRingEntry entry;
+    std::string big(2000, 'x');
+
+    // A huge message is cut down to fit a record, and again to fit the caller's buffer
+    TEST_ASSERT_TRUE(ring.push(10, 0, "Test", big.c_str(), big.size()));
+    TEST_ASSERT_TRUE(ring.push(10, 0, "Test", big.c_str(), big.size()));
+    char text[LogRing::MAX_RECORD + 1];
+    TEST_ASSERT_TRUE(ring.pop(entry, text, sizeof(text)));
+    TEST_ASSERT_TRUE(strlen(text) < LogRing::MAX_RECORD);
+    TEST_ASSERT_TRUE(strlen(text) > LogRing::MAX_RECORD / 2);
+    char small[64];
+    TEST_ASSERT_TRUE(ring.pop(entry, small, sizeof(small)));
+    TEST_ASSERT_EQUAL_UINT32(sizeof(small) - 1, strlen(small));
+    TEST_ASSERT_TRUE(ring.isEmpty());
+}
+
+void test_order_and_overflow(void)
+{
+    LogRing ring(4096);
+    LogRingEntry entry;
+    char text[LogRing::MAX_RECORD];
+
+    // Push and pop enough to wrap around the buffer many times
+    uint32_t next = 0;
+    for (uint32_t i = 0; i < 10000; i++) {
+        TEST_ASSERT_TRUE(pushf(ring, i % 50, "message %u %s\n", i, (i % 3) ? "short" : "a somewhat longer string argument"));
+        if (i % 7 == 6) {
+            while (ring.pop(entry, text, sizeof(text))) {
+                char expected[80];
+                snprintf(expected, sizeof(expected), "message %u %s\n", next,
+                         (next % 3) ? "short" : "a somewhat longer string argument");
+                TEST_ASSERT_EQUAL_STRING(expected, text);
+                TEST_ASSERT_EQUAL_UINT8(next % 50, entry.level);
+                TEST_ASSERT_EQUAL_STRING("Test", entry.threadName);
+                next++;
+            }
+        }
+    }
+    while (ring.pop(entry, text, sizeof(text)))
+        next++;
+    TEST_ASSERT_EQUAL_UINT32(10000, next);
+    TEST_ASSERT_TRUE(ring.isEmpty());
+
+    // If no one drains the ring push() refuses new messages rather than block (the logger then prints them itself)
+    uint32_t pushed = 0;
+    while (pushf(ring, 10, "filling %u\n", pushed))
+        pushed++;
+    TEST_ASSERT_TRUE(pushed > 10);
+    TEST_ASSERT_TRUE(ring.pop(entry, text, sizeof(text)));
+    TEST_ASSERT_EQUAL_STRING("filling 0\n", text);
+}
+
+void test_threads(void)
+{
+    LogRing ring(8192);
+    const uint32_t numThreads = 4, perThread = 20000;
+    std::vector<std::thread> producers;
+    for (uint32_t t = 0; t < numThreads; t++) {
+        producers.emplace_back([&ring, t]() {
+            for (uint32_t i = 0; i < perThread;) {
+                if (pushf(ring, 10, "thread %u message %u\n", t, i))
+                    i++;
+                else
+                    std::this_thread::yield(); // the consumer will catch up
+            }
+        });
+    }
+
+    // Every thread's messages must come out complete and in order
+    std::vector<uint32_t> next(numThreads, 0);
+    LogRingEntry entry;
+    char text[LogRing::MAX_RECORD];
+    uint32_t total = 0;
+    while (total < numThreads * perThread) {
+        if (!ring.pop(entry, text, sizeof(text)))
+            continue;
+        unsigned t, i;
+        TEST_ASSERT_EQUAL_INT(2, sscanf(text, "thread %u message %u", &t, &i));
+        TEST_ASSERT_EQUAL_UINT32(next[t], i);
+        next[t]++;
+        total++;
+    }
+    for (auto &p : producers)
+        p.join();
+}
+
+/// What RedirectablePrint::log did on the calling thread before writing to the port, the ring now only adds a copy
+static size_t formatNow(char *buf, size_t len, const char *format, ...)
+{
+    va_list arg;
+    va_start(arg, format);
+    size_t n = vsnprintf(buf, len, format, arg);
+    va_end(arg);
+    if (n > len - 1)
+        n = len - 1;
+    for (size_t f = 0; f < n; f++) {
+        if (!isprint((unsigned char)buf[f]) && buf[f] != '\n')
+            buf[f] = '#';
+    }
+    return n;
+}
+
+void test_benchmark(void)
+{
+    const uint32_t numMessages = 100000;
+    static char printBuf[512];
+    LogRing ring(1 << 20);
+    LogRingEntry entry;
+
+    // A typical packet log line
+#define BENCH_FORMAT "Received packet (id=0x%08x fr=0x%08x to=0x%08x, WantAck=%d, HopLim=%d Ch=0x%x Portnum=%d rxSNR=%g rxRSSI=%i)\n"
+#define BENCH_ARGS(i) i, 0xdeadbeef, 0xffffffff, 1, 3, 8, 1, 6.25, -97
+
+    uint32_t start = micros();
+    for (uint32_t i = 0; i < numMessages; i++)
+        formatNow(printBuf, sizeof(printBuf), BENCH_FORMAT, BENCH_ARGS(i));
+    uint32_t format = micros() - start;
+
+    uint32_t pushed = 0;
+    start = micros();
+    for (uint32_t i = 0; i < numMessages; i++) {
+        if (pushf(ring, 10, BENCH_FORMAT, BENCH_ARGS(i)))
+            pushed++;
+        if ((i & 1023) == 1023) { // the drain thread runs later, in between bursts
+            uint32_t paused = micros();
+            while (ring.pop(entry, printBuf, sizeof(printBuf))) {
+            }
+            start += micros() - paused;
+        }
+    }
+    uint32_t queued = micros() - start;
+    TEST_ASSERT_EQUAL_UINT32(numMessages, pushed);
+
+    char msg[200];
+    snprintf(msg, sizeof(msg), "%u messages: format %u ns/message, format and push %u ns/message (before any port I/O)",
+             numMessages, (uint32_t)((uint64_t)format * 1000 / numMessages), (uint32_t)((uint64_t)queued * 1000 / numMessages));
+    TEST_MESSAGE(msg);
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs
+    // if board doesn't support software reset via Serial.DTR/RTS
+    delay(2000);
+
+    UNITY_BEGIN(); // IMPORTANT LINE!
+    RUN_TEST(test_truncation);
+    RUN_TEST(test_order_and_overflow);
+    RUN_TEST(test_threads);
+    RUN_TEST(test_benchmark);
+}
+
+void loop()
+{
+    UNITY_END(); // stop unit testing
+}
@@ -0,0 +1,214 @@
+#include "MeshPacketQueue.h"
+#include "MeshTypes.h"
+
+#include <algorithm>
+#include <unity.h>
+#include <vector>
+
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+static meshtastic_MeshPacket *makePacket(NodeNum from, PacketId id, meshtastic_MeshPacket_Priority priority)
+{
+    meshtastic_MeshPacket *p = packetPool.allocZeroed();
+    p->from = from;
+    p->id = id;
+    p->priority = priority;
+    return p;
+}
+
+/// Like the radio interfaces, free anything the queue didn't take
+static void enqueueOrRelease(MeshPacketQueue &q, meshtastic_MeshPacket *p)
+{
+    if (!q.enqueue(p))
+        packetPool.release(p);
+}
+
+static void releaseIfFound(meshtastic_MeshPacket *p)
+{
+    if (p)
+        packetPool.release(p);
+}
+
+static void drain(MeshPacketQueue &q)
+{
+    while (!q.empty())
+        packetPool.release(q.dequeue());
+}
+
+void test_priority_order(void)
+{
+    MeshPacketQueue q(16);
+
+    q.enqueue(makePacket(1, 3, meshtastic_MeshPacket_Priority_DEFAULT));
+    q.enqueue(makePacket(1, 2, meshtastic_MeshPacket_Priority_DEFAULT));
+    q.enqueue(makePacket(1, 9, meshtastic_MeshPacket_Priority_ACK));
+    q.enqueue(makePacket(1, 1, meshtastic_MeshPacket_Priority_BACKGROUND));
+    TEST_ASSERT_EQUAL_UINT32(12, q.getFree());
+
+    // Highest priority first, then the oldest (smallest) id
+    PacketId expected[] = {9, 2, 3, 1};
+    for (auto id : expected) {
+        TEST_ASSERT_EQUAL_UINT32(id, q.getFront()->id);
+        meshtastic_MeshPacket *p = q.dequeue();
+        TEST_ASSERT_EQUAL_UINT32(id, p->id);
+        packetPool.release(p);
+    }
+    TEST_ASSERT_TRUE(q.empty());
+    TEST_ASSERT_NULL(q.dequeue());
+}
+
+void test_remove(void)
+{
+    MeshPacketQueue q(16);
+
+    for (PacketId id = 1; id <= 10; id++)
+        q.enqueue(makePacket(id % 2 ? 0x1111 : 0x2222, id, meshtastic_MeshPacket_Priority_DEFAULT));
+
+    TEST_ASSERT_NULL(q.remove(0x1111, 2)); // wrong sender
+    meshtastic_MeshPacket *p = q.remove(0x2222, 2);
+    TEST_ASSERT_NOT_NULL(p);
+    TEST_ASSERT_EQUAL_UINT32(2, p->id);
+    packetPool.release(p);
+    TEST_ASSERT_NULL(q.remove(0x2222, 2));
+    TEST_ASSERT_EQUAL_UINT32(1, q.getStats().cancelled);
+
+    PacketId expected[] = {1, 3, 4, 5, 6, 7, 8, 9, 10};
+    for (auto id : expected) {
+        p = q.dequeue();
+        TEST_ASSERT_EQUAL_UINT32(id, p->id);
+        packetPool.release(p);
+    }
+}
+
+void test_full_queue(void)
+{
+    MeshPacketQueue q(4);
+
+    q.enqueue(makePacket(1, 1, meshtastic_MeshPacket_Priority_DEFAULT));
+    q.enqueue(makePacket(1, 2, meshtastic_MeshPacket_Priority_BACKGROUND));
+    q.enqueue(makePacket(1, 3, meshtastic_MeshPacket_Priority_RELIABLE));
+    q.enqueue(makePacket(1, 4, meshtastic_MeshPacket_Priority_BACKGROUND));
+    TEST_ASSERT_EQUAL_UINT32(0, q.getFree());
+
+    // Same priority as the lowest queued packet - must be refused (and left to the caller to free)
+    meshtastic_MeshPacket *p = makePacket(1, 5, meshtastic_MeshPacket_Priority_BACKGROUND);
+    TEST_ASSERT_FALSE(q.enqueue(p));
+    packetPool.release(p);
+    TEST_ASSERT_EQUAL_UINT32(1, q.getStats().rejected);
+
+    // Higher priority - the newest background packet goes first
+    TEST_ASSERT_TRUE(q.enqueue(makePacket(1, 6, meshtastic_MeshPacket_Priority_ACK)));
+    TEST_ASSERT_EQUAL_UINT32(1, q.getStats().dropped[QUEUE_PRI_BACKGROUND]);
+    TEST_ASSERT_NULL(q.remove(1, 4));
+
+    PacketId expected[] = {6, 3, 1, 2};
+    for (auto id : expected) {
+        p = q.dequeue();
+        TEST_ASSERT_EQUAL_UINT32(id, p->id);
+        packetPool.release(p);
+    }
+}
+
+void test_against_reference(void)
+{
+    // Random operations checked against a plain sorted vector
+    const size_t maxLen = 16;
+    MeshPacketQueue q(maxLen);
+    std::vector<meshtastic_MeshPacket *> ref;
+    auto before = [](const meshtastic_MeshPacket *a, const meshtastic_MeshPacket *b) {
+        return a->priority != b->priority ? a->priority > b->priority : a->id < b->id;
+    };
+    const meshtastic_MeshPacket_Priority priorities[] = {
+        meshtastic_MeshPacket_Priority_BACKGROUND, meshtastic_MeshPacket_Priority_DEFAULT,
+        meshtastic_MeshPacket_Priority_RELIABLE, meshtastic_MeshPacket_Priority_ACK};
+
+    randomSeed(42);
+    PacketId nextId = 1;
+    for (int step = 0; step < 20000; step++) {
+        long op = random(0, 3);
+        if (op == 0) {
+            meshtastic_MeshPacket *p = makePacket(random(1, 4), nextId++, priorities[random(0, 4)]);
+            if (ref.size() < maxLen) {
+                TEST_ASSERT_TRUE(q.enqueue(p));
+                ref.push_back(p);
+            } else {
+                auto low = std::max_element(ref.begin(), ref.end(), before);
+                if (p->priority > (*low)->priority) {
+                    ref.erase(low); // the queue releases it
+                    TEST_ASSERT_TRUE(q.enqueue(p));
+                    ref.push_back(p);
+                } else {
+                    TEST_ASSERT_FALSE(q.enqueue(p));
+                    packetPool.release(p);
+                }
+            }
+        } else if (op == 1 && !ref.empty()) {
+            auto first = std::min_element(ref.begin(), ref.end(), before);
+            TEST_ASSERT_EQUAL_PTR(*first, q.dequeue());
+            packetPool.release(*first);
+            ref.erase(first);
+        } else if (!ref.empty()) {
+            meshtastic_MeshPacket *victim = ref[random(0, ref.size())];
+            TEST_ASSERT_EQUAL_PTR(victim, q.remove(victim->from, victim->id));
+            ref.erase(std::find(ref.begin(), ref.end(), victim));
+            packetPool.release(victim);
+        }
+        TEST_ASSERT_EQUAL_UINT32(maxLen - ref.size(), q.getFree());
+    }
+    drain(q);
+}
+
+void test_benchmark(void)
+{
+    // Keep a full queue busy the way a busy router does: enqueue, cancel a rebroadcast, dequeue
+    MeshPacketQueue q(MAX_TX_QUEUE);
+    const uint32_t numOps = 100000;
+    PacketId nextId = 1;
+    while (q.getFree() > 0)
+        enqueueOrRelease(q, makePacket(1, nextId++, meshtastic_MeshPacket_Priority_DEFAULT));
+
+    uint32_t start = micros();
+    for (uint32_t i = 0; i < numOps; i++) {
+        releaseIfFound(q.remove(1, nextId - MAX_TX_QUEUE / 2));
+        enqueueOrRelease(q, makePacket(1, nextId++, meshtastic_MeshPacket_Priority_DEFAULT));
+        releaseIfFound(q.dequeue());
+        enqueueOrRelease(q, makePacket(1, nextId++, meshtastic_MeshPacket_Priority_DEFAULT));
+        // Full again, a higher priority packet displaces the lowest one
+        enqueueOrRelease(q, makePacket(1, nextId++, meshtastic_MeshPacket_Priority_RELIABLE));
+        releaseIfFound(q.dequeue());
+    }
+    uint32_t elapsed = micros() - start;
+
+    char msg[120];
+    snprintf(msg, sizeof(msg), "%u iterations in %u us (%u ns/iteration), dropped %u", numOps, elapsed,
+             (uint32_t)((uint64_t)elapsed * 1000 / numOps), q.getStats().dropped[QUEUE_PRI_DEFAULT]);
+    TEST_MESSAGE(msg);
+    drain(q);
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs
+    // if board doesn't support software reset via Serial.DTR/RTS
+    delay(2000);
+
+    UNITY_BEGIN(); // IMPORTANT LINE!
+    RUN_TEST(test_priority_order);
+    RUN_TEST(test_remove);
+    RUN_TEST(test_full_queue);
+    RUN_TEST(test_against_reference);
+    RUN_TEST(test_benchmark);
+}
+
+void loop()
+{
+    UNITY_END(); // stop unit testing
+}
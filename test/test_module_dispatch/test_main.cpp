@@ -0,0 +1,169 @@
+#include "mesh/ModuleDispatch.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+#include <vector>
+
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+static std::vector<uint16_t> collect(ModuleDispatch::Cursor cursor)
+{
+    std::vector<uint16_t> out;
+    uint16_t index;
+    while (cursor.next(index))
+        out.push_back(index);
+    return out;
+}
+
+void test_lookup(void)
+{
+    ModuleDispatch d;
+    d.add(0, {}, true); // like RoutingModule
+    d.add(1, {meshtastic_PortNum_TEXT_MESSAGE_APP, meshtastic_PortNum_DETECTION_SENSOR_APP}, false);
+    d.add(2, {meshtastic_PortNum_POSITION_APP}, false);
+    d.add(3, {meshtastic_PortNum_TEXT_MESSAGE_APP, meshtastic_PortNum_TEXT_MESSAGE_APP}, false); // listed twice
+    d.add(4, {}, false);
+    d.add(5, {meshtastic_PortNum_TEXT_MESSAGE_APP}, true);
+
+    // Wildcards are merged in, and the module order is kept
+    std::vector<uint16_t> expected = {0, 1, 3, 4, 5};
+    TEST_ASSERT_TRUE(collect(d.lookup(meshtastic_PortNum_TEXT_MESSAGE_APP)) == expected);
+    expected = {0, 2, 4};
+    TEST_ASSERT_TRUE(collect(d.lookup(meshtastic_PortNum_POSITION_APP)) == expected);
+    expected = {0, 4};
+    TEST_ASSERT_TRUE(collect(d.lookup(meshtastic_PortNum_PRIVATE_APP)) == expected);
+    expected = {0, 5};
+    TEST_ASSERT_TRUE(collect(d.lookupEncrypted()) == expected);
+
+    d.clear();
+    TEST_ASSERT_TRUE(collect(d.lookup(meshtastic_PortNum_TEXT_MESSAGE_APP)).empty());
+    TEST_ASSERT_TRUE(collect(d.lookupEncrypted()).empty());
+}
+
+/// Stands in for a MeshModule: what callModules used to look at for each one
+class FakeModule
+{
+  public:
+    meshtastic_PortNum portnum;
+    const char *boundChannel = NULL;
+    uint8_t boundChannelMask = 0;
+    uint32_t calls = 0;
+
+    /// UNKNOWN_APP means every packet, like RoutingModule
+    explicit FakeModule(meshtastic_PortNum _portnum) : portnum(_portnum) {}
+    virtual ~FakeModule() {}
+    virtual bool wantPacket(meshtastic_PortNum p) { return portnum == meshtastic_PortNum_UNKNOWN_APP || p == portnum; }
+};
+
+static const char *channelNames[] = {"LongFast", "admin", "serial", "friends"};
+
+void test_benchmark(void)
+{
+    // Roughly the modules a full build registers, with a few that look at everything
+    const meshtastic_PortNum ports[] = {
+        meshtastic_PortNum_UNKNOWN_APP,        meshtastic_PortNum_ADMIN_APP,           meshtastic_PortNum_TEXT_MESSAGE_APP,
+        meshtastic_PortNum_NODEINFO_APP,       meshtastic_PortNum_POSITION_APP,        meshtastic_PortNum_WAYPOINT_APP,
+        meshtastic_PortNum_REMOTE_HARDWARE_APP, meshtastic_PortNum_TELEMETRY_APP,      meshtastic_PortNum_TELEMETRY_APP,
+        meshtastic_PortNum_TELEMETRY_APP,      meshtastic_PortNum_TELEMETRY_APP,       meshtastic_PortNum_SERIAL_APP,
+        meshtastic_PortNum_RANGE_TEST_APP,     meshtastic_PortNum_STORE_FORWARD_APP,   meshtastic_PortNum_TRACEROUTE_APP,
+        meshtastic_PortNum_UNKNOWN_APP,        meshtastic_PortNum_DETECTION_SENSOR_APP, meshtastic_PortNum_PAXCOUNTER_APP,
+        meshtastic_PortNum_ATAK_PLUGIN,        meshtastic_PortNum_AUDIO_APP,           meshtastic_PortNum_REPLY_APP,
+        meshtastic_PortNum_IP_TUNNEL_APP,      meshtastic_PortNum_TEXT_MESSAGE_APP,    meshtastic_PortNum_TEXT_MESSAGE_APP,
+        meshtastic_PortNum_POSITION_APP,       meshtastic_PortNum_NODEINFO_APP,        meshtastic_PortNum_UNKNOWN_APP,
+    };
+    const size_t numModules = sizeof(ports) / sizeof(ports[0]);
+    std::vector<FakeModule *> modules;
+    ModuleDispatch d;
+    for (size_t i = 0; i < numModules; i++) {
+        auto m = new FakeModule(ports[i]);
+        if (ports[i] == meshtastic_PortNum_SERIAL_APP || ports[i] == meshtastic_PortNum_REMOTE_HARDWARE_APP) {
+            m->boundChannel = ports[i] == meshtastic_PortNum_SERIAL_APP ? "serial" : "gpio";
+            for (uint8_t c = 0; c < 4; c++)
+                if (strcasecmp(channelNames[c], m->boundChannel) == 0)
+                    m->boundChannelMask |= 1 << c;
+        }
+        modules.push_back(m);
+        if (ports[i] == meshtastic_PortNum_UNKNOWN_APP)
+            d.add(i, {}, false);
+        else
+            d.add(i, {ports[i]}, false);
+    }
+
+    // A typical mix of received traffic
+    const meshtastic_PortNum traffic[] = {meshtastic_PortNum_POSITION_APP, meshtastic_PortNum_TELEMETRY_APP,
+                                          meshtastic_PortNum_NODEINFO_APP, meshtastic_PortNum_TEXT_MESSAGE_APP,
+                                          meshtastic_PortNum_ROUTING_APP,  meshtastic_PortNum_SERIAL_APP};
+    const uint32_t numPackets = 200000;
+    const size_t numTraffic = sizeof(traffic) / sizeof(traffic[0]);
+
+    // Before: ask every module, and compare channel names for the ones that want it
+    uint32_t wantedBefore = 0;
+    uint32_t start = micros();
+    for (uint32_t i = 0; i < numPackets; i++) {
+        meshtastic_PortNum p = traffic[i % numTraffic];
+        uint8_t channel = i & 3;
+        for (auto m : modules) {
+            if (m->wantPacket(p) && (!m->boundChannel || strcasecmp(channelNames[channel], m->boundChannel) == 0)) {
+                m->calls++;
+                wantedBefore++;
+            }
+        }
+    }
+    uint32_t before = micros() - start;
+
+    // After: only ask the modules registered for the portnum, and check the precomputed channel mask
+    uint32_t wantedAfter = 0;
+    start = micros();
+    for (uint32_t i = 0; i < numPackets; i++) {
+        meshtastic_PortNum p = traffic[i % numTraffic];
+        uint8_t channel = i & 3;
+        auto cursor = d.lookup(p);
+        uint16_t index;
+        while (cursor.next(index)) {
+            auto m = modules[index];
+            if (m->wantPacket(p) && (!m->boundChannel || (m->boundChannelMask & (1 << channel)))) {
+                m->calls++;
+                wantedAfter++;
+            }
+        }
+    }
+    uint32_t after = micros() - start;
+
+    // Both ways must pick the same modules
+    TEST_ASSERT_EQUAL_UINT32(wantedBefore, wantedAfter);
+    TEST_ASSERT_TRUE(wantedBefore > 0);
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "%u modules, %u packets: walk every module %u ns/packet, dispatch table %u ns/packet",
+             (unsigned)numModules, numPackets, (uint32_t)((uint64_t)before * 1000 / numPackets),
+             (uint32_t)((uint64_t)after * 1000 / numPackets));
+    TEST_MESSAGE(msg);
+
+    for (auto m : modules)
+        delete m;
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs
+    // if board doesn't support software reset via Serial.DTR/RTS
+    delay(2000);
+
+    UNITY_BEGIN(); // IMPORTANT LINE!
+    RUN_TEST(test_lookup);
+    RUN_TEST(test_benchmark);
+}
+
+void loop()
+{
+    UNITY_END(); // stop unit testing
+}
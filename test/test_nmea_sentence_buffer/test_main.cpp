@@ -0,0 +1,203 @@
+#include "gps/NMEASentenceBuffer.h"
+
+#include <string.h>
+#include <string>
+#include <unity.h>
+#include <vector>
+
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+static const char *sentences[] = {
+    "$GNGGA,092725.00,4717.11399,N,00833.91590,E,1,08,1.01,499.6,M,48.0,M,,*5B\r\n",
+    "$GNRMC,092725.00,A,4717.11399,N,00833.91590,E,0.004,77.52,091202,,,A*57\r\n",
+    "$GNGSA,A,3,23,29,07,08,09,18,26,28,,,,,1.94,1.18,1.54*0D\r\n",
+    "$GPGSV,3,1,11,03,03,111,00,04,15,270,00,06,01,010,00,13,06,292,00*74\r\n",
+    "$GNVTG,77.52,T,,M,0.004,N,0.008,K,A*3C\r\n",
+};
+static const size_t numSentences = sizeof(sentences) / sizeof(sentences[0]);
+
+/// Feed 'data' to the buffer in blocks of at most 'blockSize', like whileActive(), returning the sentences it found
+static std::vector<std::string> splitAll(NMEASentenceBuffer &buffer, const std::string &data, size_t blockSize,
+                                         std::vector<std::string> *frames = nullptr)
+{
+    std::vector<std::string> found;
+    size_t pos = 0;
+    while (pos < data.size()) {
+        size_t space;
+        uint8_t *dest = buffer.reserve(space);
+        size_t n = std::min(std::min(blockSize, space), data.size() - pos);
+        memcpy(dest, data.data() + pos, n);
+        buffer.commit(n);
+        pos += n;
+
+        const uint8_t *message;
+        size_t len;
+        NMEASentenceBuffer::Message type;
+        while ((type = buffer.next(message, len)) != NMEASentenceBuffer::NO_MESSAGE) {
+            if (type == NMEASentenceBuffer::NMEA_SENTENCE)
+                found.emplace_back((const char *)message, len);
+            else if (frames)
+                frames->emplace_back((const char *)message, len);
+        }
+    }
+    return found;
+}
+
+void test_any_block_size(void)
+{
+    std::string stream;
+    for (int i = 0; i < 20; i++)
+        stream += sentences[i % numSentences];
+
+    for (size_t blockSize = 1; blockSize <= NMEASentenceBuffer::BUFFER_SIZE; blockSize += 7) {
+        NMEASentenceBuffer buffer;
+        std::vector<std::string> found = splitAll(buffer, stream, blockSize);
+        TEST_ASSERT_EQUAL(20, found.size());
+        for (int i = 0; i < 20; i++)
+            TEST_ASSERT_EQUAL_STRING(sentences[i % numSentences], found[i].c_str());
+        TEST_ASSERT_EQUAL_UINT32(0, buffer.takeDroppedBytes());
+    }
+}
+
+void test_noise_and_truncated(void)
+{
+    // Joined half way through a sentence, a binary message, and a sentence cut short by the next one
+    std::string stream = "00833.91590,E,0.004*57\r\n";
+    stream += std::string("\xb5\x62\x01\x07\x05\x00\x01\x02\x03\x04\x05\x10\x20", 13);
+    stream += sentences[0];
+    stream += "$GNRMC,092725.00,A,47";
+    stream += sentences[2];
+
+    NMEASentenceBuffer buffer;
+    std::vector<std::string> found = splitAll(buffer, stream, 16);
+    TEST_ASSERT_EQUAL(2, found.size());
+    TEST_ASSERT_EQUAL_STRING(sentences[0], found[0].c_str());
+    TEST_ASSERT_EQUAL_STRING(sentences[2], found[1].c_str());
+    TEST_ASSERT_EQUAL_UINT32(stream.size() - strlen(sentences[0]) - strlen(sentences[2]), buffer.takeDroppedBytes());
+}
+
+/// A UBX frame with a correct checksum
+static std::string ubxFrame(uint8_t cls, uint8_t id, size_t payloadLen)
+{
+    std::string frame = "\xb5\x62";
+    frame += (char)cls;
+    frame += (char)id;
+    frame += (char)(payloadLen & 0xff);
+    frame += (char)(payloadLen >> 8);
+    for (size_t i = 0; i < payloadLen; i++)
+        frame += (char)(i * 37); // plenty of '$', '\n' and sync chars
+    uint8_t ckA = 0, ckB = 0;
+    for (size_t i = 2; i < frame.size(); i++) {
+        ckA += (uint8_t)frame[i];
+        ckB += ckA;
+    }
+    frame += (char)ckA;
+    frame += (char)ckB;
+    return frame;
+}
+
+void test_ubx_frames(void)
+{
+    std::string pvt = ubxFrame(0x01, 0x07, 92);
+    std::string ack = ubxFrame(0x05, 0x01, 2);
+    std::string corrupt = ubxFrame(0x01, 0x07, 92);
+    corrupt[50] ^= 0x01;
+
+    std::string stream = sentences[0];
+    stream += pvt;
+    stream += corrupt;
+    stream += sentences[1];
+    stream += ack;
+    stream += "$GNGSA,A,3,23"; // cut short by a frame
+    stream += pvt;
+    stream += sentences[2];
+
+    for (size_t blockSize = 1; blockSize <= NMEASentenceBuffer::BUFFER_SIZE; blockSize += 13) {
+        NMEASentenceBuffer buffer;
+        std::vector<std::string> frames;
+        std::vector<std::string> found = splitAll(buffer, stream, blockSize, &frames);
+        TEST_ASSERT_EQUAL(3, found.size());
+        TEST_ASSERT_EQUAL_STRING(sentences[0], found[0].c_str());
+        TEST_ASSERT_EQUAL_STRING(sentences[1], found[1].c_str());
+        TEST_ASSERT_EQUAL_STRING(sentences[2], found[2].c_str());
+        TEST_ASSERT_EQUAL(3, frames.size());
+        TEST_ASSERT_TRUE(frames[0] == pvt);
+        TEST_ASSERT_TRUE(frames[1] == ack);
+        TEST_ASSERT_TRUE(frames[2] == pvt);
+        TEST_ASSERT_EQUAL_UINT32(corrupt.size() + 13, buffer.takeDroppedBytes());
+    }
+}
+
+void test_overflow(void)
+{
+    // Far longer than any sentence, and no end in sight
+    std::string stream = "$GPTXT,";
+    stream += std::string(3 * NMEASentenceBuffer::BUFFER_SIZE, 'x');
+    stream += sentences[1];
+
+    NMEASentenceBuffer buffer;
+    std::vector<std::string> found = splitAll(buffer, stream, 64);
+    TEST_ASSERT_EQUAL(1, found.size());
+    TEST_ASSERT_EQUAL_STRING(sentences[1], found[0].c_str());
+    TEST_ASSERT_EQUAL_UINT32(stream.size() - strlen(sentences[1]), buffer.takeDroppedBytes());
+}
+
+void test_is_type(void)
+{
+    TEST_ASSERT_TRUE(NMEASentenceBuffer::isType(sentences[0], strlen(sentences[0]), "GGA"));
+    TEST_ASSERT_TRUE(NMEASentenceBuffer::isType(sentences[1], strlen(sentences[1]), "RMC"));
+    TEST_ASSERT_TRUE(NMEASentenceBuffer::isType("$BDGSA,A,1*00\r\n", 15, "GSA"));
+    TEST_ASSERT_FALSE(NMEASentenceBuffer::isType(sentences[3], strlen(sentences[3]), "GSA"));
+    TEST_ASSERT_FALSE(NMEASentenceBuffer::isType("$GPGGAX,1*00\r\n", 14, "GGA"));
+    TEST_ASSERT_FALSE(NMEASentenceBuffer::isType("$GPGG\n", 6, "GGA"));
+}
+
+/// How long splitting a second of 115200 baud (11.5KB) takes
+void test_benchmark(void)
+{
+    std::string stream;
+    while (stream.size() < 11520)
+        stream += sentences[stream.size() % numSentences];
+
+    const int rounds = 100;
+    uint32_t start = micros();
+    size_t found = 0;
+    for (int i = 0; i < rounds; i++) {
+        NMEASentenceBuffer buffer;
+        found += splitAll(buffer, stream, 128).size();
+    }
+    uint32_t elapsed = micros() - start;
+    TEST_ASSERT_TRUE(found > 0);
+
+    char msg[100];
+    snprintf(msg, sizeof(msg), "%u bytes split into sentences in %u us", (uint32_t)stream.size(), elapsed / rounds);
+    TEST_MESSAGE(msg);
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs
+    // if board doesn't support software reset via Serial.DTR/RTS
+    delay(2000);
+
+    UNITY_BEGIN(); // IMPORTANT LINE!
+    RUN_TEST(test_any_block_size);
+    RUN_TEST(test_noise_and_truncated);
+    RUN_TEST(test_ubx_frames);
+    RUN_TEST(test_overflow);
+    RUN_TEST(test_is_type);
+    RUN_TEST(test_benchmark);
+}
+
+void loop()
+{
+    UNITY_END(); // stop unit testing
+}
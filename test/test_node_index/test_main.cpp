@@ -0,0 +1,124 @@
+#include "NodeIndex.h"
+#include "mesh/generated/meshtastic/deviceonly.pb.h"
+
+#include <map>
+#include <unity.h>
+#include <vector>
+
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+void test_insert_find_erase(void)
+{
+    NodeIndex index;
+    std::map<NodeNum, uint16_t> expected;
+
+    index.reset(250);
+    randomSeed(42);
+
+    // Random inserts, moves and erases, checked against a std::map after every step
+    for (int step = 0; step < 20000; step++) {
+        NodeNum n = random(1, 400); // small range so we hit plenty of existing entries
+        auto it = expected.find(n);
+        if (it == expected.end()) {
+            if (expected.size() < 250) {
+                uint16_t pos = random(0, 250);
+                index.insert(n, pos);
+                expected[n] = pos;
+            }
+        } else if (random(0, 2)) {
+            uint16_t pos = random(0, 250);
+            index.move(n, pos);
+            it->second = pos;
+        } else {
+            index.erase(n);
+            expected.erase(it);
+        }
+
+        NodeNum probe = random(1, 400);
+        auto e = expected.find(probe);
+        TEST_ASSERT_EQUAL_UINT16(e == expected.end() ? NodeIndex::NOT_FOUND : e->second, index.find(probe));
+    }
+
+    for (auto &e : expected)
+        TEST_ASSERT_EQUAL_UINT16(e.second, index.find(e.first));
+
+    index.clear();
+    for (auto &e : expected)
+        TEST_ASSERT_EQUAL_UINT16(NodeIndex::NOT_FOUND, index.find(e.first));
+}
+
+static void benchmark(size_t numNodes)
+{
+    const uint32_t numLookups = 100000;
+    std::vector<meshtastic_NodeInfoLite> nodes(numNodes);
+    NodeIndex index;
+    index.reset(numNodes);
+
+    randomSeed(numNodes);
+    for (size_t i = 0; i < numNodes; i++) {
+        nodes[i].num = random(1, LONG_MAX);
+        index.insert(nodes[i].num, i);
+    }
+
+    // Mostly known senders, with some strangers we don't have yet
+    std::vector<NodeNum> lookups(numLookups);
+    for (auto &n : lookups)
+        n = random(0, 10) ? nodes[random(0, numNodes)].num : (NodeNum)random(1, LONG_MAX);
+
+    uint32_t found = 0;
+    uint32_t start = micros();
+    for (auto n : lookups) {
+        for (size_t i = 0; i < numNodes; i++) {
+            if (nodes[i].num == n) {
+                found++;
+                break;
+            }
+        }
+    }
+    uint32_t linear = micros() - start;
+
+    uint32_t foundIndexed = 0;
+    start = micros();
+    for (auto n : lookups) {
+        if (index.find(n) != NodeIndex::NOT_FOUND)
+            foundIndexed++;
+    }
+    uint32_t indexed = micros() - start;
+
+    char msg[120];
+    snprintf(msg, sizeof(msg), "%u nodes: linear scan %u ns/lookup, indexed %u ns/lookup", (unsigned)numNodes,
+             (uint32_t)((uint64_t)linear * 1000 / numLookups), (uint32_t)((uint64_t)indexed * 1000 / numLookups));
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_EQUAL_UINT32(found, foundIndexed);
+}
+
+void test_benchmark(void)
+{
+    benchmark(80);
+    benchmark(250);
+    benchmark(1000);
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs
+    // if board doesn't support software reset via Serial.DTR/RTS
+    delay(2000);
+
+    UNITY_BEGIN(); // IMPORTANT LINE!
+    RUN_TEST(test_insert_find_erase);
+    RUN_TEST(test_benchmark);
+}
+
+void loop()
+{
+    UNITY_END(); // stop unit testing
+}
@@ -0,0 +1,268 @@
+#include "FSCommon.h"
+#include "mesh/NodeJournal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+#include <vector>
+
+#define JOURNAL "/nodejournaltest"
+#define NUM_NODES 100
+
+static void removeJournal()
+{
+    if (FSCom.exists(JOURNAL))
+        FSCom.remove(JOURNAL);
+    if (FSCom.exists(JOURNAL ".tmp"))
+        FSCom.remove(JOURNAL ".tmp");
+}
+
+void setUp(void)
+{
+    removeJournal();
+}
+
+void tearDown(void)
+{
+    removeJournal();
+}
+
+/// A node as we'd have it after hearing its NodeInfo, position and telemetry
+static meshtastic_NodeInfoLite makeNode(NodeNum num)
+{
+    meshtastic_NodeInfoLite n;
+    memset(&n, 0, sizeof(n));
+    n.num = num;
+    n.has_user = true;
+    snprintf(n.user.long_name, sizeof(n.user.long_name), "Meshtastic %04x", num & 0xffff);
+    snprintf(n.user.short_name, sizeof(n.user.short_name), "%04x", num & 0xffff);
+    n.user.public_key.size = 32;
+    memset(n.user.public_key.bytes, num & 0xff, 32);
+    n.has_position = true;
+    n.position.latitude_i = 520000000 + num;
+    n.position.longitude_i = 210000000 + num;
+    n.position.altitude = 100;
+    n.position.time = 1700000000;
+    n.has_device_metrics = true;
+    n.device_metrics.has_battery_level = true;
+    n.device_metrics.battery_level = 80;
+    n.device_metrics.has_voltage = true;
+    n.device_metrics.voltage = 3.9;
+    n.last_heard = 1700000000;
+    n.snr = 5.5;
+    n.hops_away = num % 4;
+    return n;
+}
+
+/// Remove like NodeDB does, by moving the last node into the hole
+static void removeAt(std::vector<meshtastic_NodeInfoLite> &nodes, pb_size_t &numNodes, pb_size_t pos)
+{
+    nodes[pos] = nodes[numNodes - 1];
+    memset(&nodes[--numNodes], 0, sizeof(nodes[0]));
+}
+
+/// Same nodes, in any order
+static void assertSameNodes(const std::vector<meshtastic_NodeInfoLite> &a, pb_size_t numA,
+                            const std::vector<meshtastic_NodeInfoLite> &b, pb_size_t numB)
+{
+    TEST_ASSERT_EQUAL_UINT32(numA, numB);
+    for (pb_size_t i = 0; i < numA; i++) {
+        bool found = false;
+        for (pb_size_t j = 0; j < numB && !found; j++)
+            if (a[i].num == b[j].num) {
+                TEST_ASSERT_EQUAL_UINT32(a[i].last_heard, b[j].last_heard);
+                TEST_ASSERT_EQUAL_STRING(a[i].user.long_name, b[j].user.long_name);
+                TEST_ASSERT_EQUAL_INT(a[i].position.latitude_i, b[j].position.latitude_i);
+                found = true;
+            }
+        TEST_ASSERT_TRUE(found);
+    }
+}
+
+void test_incremental(void)
+{
+    std::vector<meshtastic_NodeInfoLite> nodes(NUM_NODES);
+    pb_size_t numNodes = 0;
+    for (; numNodes < 30; numNodes++)
+        nodes[numNodes] = makeNode(1000 + numNodes);
+
+    NodeJournal journal(JOURNAL);
+    TEST_ASSERT_TRUE(journal.save(nodes, numNodes));
+    uint32_t full = journal.getBytesWritten();
+    TEST_ASSERT_EQUAL_UINT32(full, journal.getSize());
+
+    // Nothing changed, nothing written
+    TEST_ASSERT_TRUE(journal.save(nodes, numNodes));
+    TEST_ASSERT_EQUAL_UINT32(full, journal.getBytesWritten());
+
+    // Only heard from again, which can wait
+    nodes[3].last_heard += 60;
+    nodes[7].last_heard += 60;
+    TEST_ASSERT_TRUE(journal.save(nodes, numNodes, false));
+    TEST_ASSERT_EQUAL_UINT32(full, journal.getBytesWritten());
+
+    // One removed and one new, with the two heard from: only those get written
+    removeAt(nodes, numNodes, 12);
+    nodes[numNodes++] = makeNode(5000);
+    TEST_ASSERT_TRUE(journal.save(nodes, numNodes));
+    uint32_t delta = journal.getBytesWritten() - full;
+    TEST_ASSERT_TRUE(delta > 0);
+    TEST_ASSERT_TRUE(delta < full / 5);
+
+    // A node removed and heard from again between saves is still there
+    nodes[numNodes] = nodes[20];
+    removeAt(nodes, numNodes, 20);
+    numNodes++;
+    TEST_ASSERT_TRUE(journal.save(nodes, numNodes));
+
+    std::vector<meshtastic_NodeInfoLite> loaded(NUM_NODES);
+    pb_size_t numLoaded = 0;
+    NodeJournal reader(JOURNAL);
+    TEST_ASSERT_TRUE(reader.load(loaded, numLoaded));
+    assertSameNodes(nodes, numNodes, loaded, numLoaded);
+
+    // And the reader carries on appending to it
+    loaded[0].last_heard += 60;
+    uint32_t size = reader.getSize();
+    TEST_ASSERT_TRUE(reader.save(loaded, numLoaded));
+    TEST_ASSERT_TRUE(reader.getSize() > size);
+    TEST_ASSERT_TRUE(reader.getBytesWritten() < full / 10);
+}
+
+void test_damaged_tail(void)
+{
+    std::vector<meshtastic_NodeInfoLite> nodes(NUM_NODES);
+    pb_size_t numNodes = 0;
+    for (; numNodes < 20; numNodes++)
+        nodes[numNodes] = makeNode(1000 + numNodes);
+
+    NodeJournal journal(JOURNAL);
+    TEST_ASSERT_TRUE(journal.save(nodes, numNodes));
+    nodes[5].last_heard += 60;
+    TEST_ASSERT_TRUE(journal.save(nodes, numNodes));
+
+    // Power went while appending the next batch
+    File f = FSCom.open(JOURNAL, FILE_O_APPEND);
+    const uint8_t partial[] = {0x4e, 1, 100, 0, 1, 2};
+    f.write(partial, sizeof(partial));
+    f.close();
+
+    std::vector<meshtastic_NodeInfoLite> loaded(NUM_NODES);
+    pb_size_t numLoaded = 0;
+    NodeJournal reader(JOURNAL);
+    TEST_ASSERT_TRUE(reader.load(loaded, numLoaded));
+    assertSameNodes(nodes, numNodes, loaded, numLoaded);
+
+    // The next save rewrites the journal rather than appending after the damage
+    TEST_ASSERT_TRUE(reader.save(loaded, numLoaded));
+    numLoaded = 0;
+    NodeJournal again(JOURNAL);
+    TEST_ASSERT_TRUE(again.load(loaded, numLoaded));
+    assertSameNodes(nodes, numNodes, loaded, numLoaded);
+
+    // Stopped while compacting, after the old journal was removed but before the new one was renamed into place
+    renameFile(JOURNAL, JOURNAL ".tmp");
+    numLoaded = 0;
+    NodeJournal fromTmp(JOURNAL);
+    TEST_ASSERT_TRUE(fromTmp.load(loaded, numLoaded));
+    assertSameNodes(nodes, numNodes, loaded, numLoaded);
+}
+
+void test_compaction(void)
+{
+    std::vector<meshtastic_NodeInfoLite> nodes(NUM_NODES);
+    pb_size_t numNodes = 0;
+    for (; numNodes < 50; numNodes++)
+        nodes[numNodes] = makeNode(1000 + numNodes);
+
+    NodeJournal journal(JOURNAL);
+    TEST_ASSERT_TRUE(journal.save(nodes, numNodes));
+    uint32_t full = journal.getSize();
+
+    srand(7);
+    for (int i = 0; i < 500; i++) {
+        nodes[rand() % numNodes].last_heard += 60;
+        if (i % 10 == 0) {
+            removeAt(nodes, numNodes, 1 + rand() % (numNodes - 1));
+            nodes[numNodes++] = makeNode(2000 + i);
+        }
+        TEST_ASSERT_TRUE(journal.save(nodes, numNodes));
+        TEST_ASSERT_TRUE(journal.getSize() <= NODE_JOURNAL_MAX_GROWTH * full + 1024);
+    }
+
+    std::vector<meshtastic_NodeInfoLite> loaded(NUM_NODES);
+    pb_size_t numLoaded = 0;
+    NodeJournal reader(JOURNAL);
+    TEST_ASSERT_TRUE(reader.load(loaded, numLoaded));
+    assertSameNodes(nodes, numNodes, loaded, numLoaded);
+}
+
+/**
+ * An hour on a busy mesh with a full DB: every node is heard from every few minutes, and a new node turns up (pushing out
+ * the oldest) every 6 minutes.  The old code rewrote the whole DeviceState whenever a NodeInfo changed something (at most
+ * once a minute); now that writes just the nodes whose user changed, and the rest are written every NODE_JOURNAL_SAVE_MSEC.
+ */
+void test_bytes_per_hour(void)
+{
+    std::vector<meshtastic_NodeInfoLite> nodes(NUM_NODES);
+    pb_size_t numNodes = 0;
+    for (; numNodes < NUM_NODES; numNodes++)
+        nodes[numNodes] = makeNode(1000 + numNodes);
+
+    NodeJournal journal(JOURNAL);
+    TEST_ASSERT_TRUE(journal.save(nodes, numNodes));
+    uint32_t initial = journal.getBytesWritten();
+
+    uint8_t buf[meshtastic_NodeInfoLite_size];
+    uint32_t wholeDB = 0;
+    for (pb_size_t i = 0; i < numNodes; i++)
+        wholeDB += pb_encode_to_bytes(buf, sizeof(buf), &meshtastic_NodeInfoLite_msg, &nodes[i]);
+
+    srand(3);
+    uint32_t oldBytes = 0, start = micros();
+    for (uint32_t minute = 1; minute <= 60; minute++) {
+        for (int heard = 0; heard < 30; heard++) {
+            meshtastic_NodeInfoLite &n = nodes[1 + rand() % (numNodes - 1)];
+            n.last_heard = 1700000000 + minute * 60;
+            n.snr = rand() % 20;
+        }
+        bool userChanged = minute % 6 == 0;
+        if (userChanged) {
+            removeAt(nodes, numNodes, 1 + rand() % (numNodes - 1));
+            nodes[numNodes++] = makeNode(10000 + minute);
+            oldBytes += wholeDB;
+        }
+        if (minute % (NODE_JOURNAL_SAVE_MSEC / 60000) == 0)
+            TEST_ASSERT_TRUE(journal.save(nodes, numNodes, true));
+        else if (userChanged)
+            TEST_ASSERT_TRUE(journal.save(nodes, numNodes, false));
+    }
+    uint32_t elapsed = micros() - start;
+    uint32_t newBytes = journal.getBytesWritten() - initial;
+
+    char msg[200];
+    snprintf(msg, sizeof(msg), "%u nodes, busy hour: whole DB rewrites %u bytes, journal %u bytes (%u us spent saving)",
+             NUM_NODES, oldBytes, newBytes, elapsed);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_TRUE(newBytes < oldBytes);
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs
+    // if board doesn't support software reset via Serial.DTR/RTS
+    delay(2000);
+
+    FSBegin();
+    UNITY_BEGIN(); // IMPORTANT LINE!
+    RUN_TEST(test_incremental);
+    RUN_TEST(test_damaged_tail);
+    RUN_TEST(test_compaction);
+    RUN_TEST(test_bytes_per_hour);
+}
+
+void loop()
+{
+    UNITY_END(); // stop unit testing
+}
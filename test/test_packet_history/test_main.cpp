@@ -0,0 +1,137 @@
+#include "PacketHistory.h"
+
+#include <unity.h>
+
+/// Lets the tests drive the history with their own clock
+class TestPacketHistory : public PacketHistory
+{
+  public:
+    using PacketHistory::wasSeenRecently;
+};
+
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+void test_duplicate_detection(void)
+{
+    TestPacketHistory h;
+
+    TEST_ASSERT_FALSE(h.wasSeenRecently(0x1234, 1, 1000, true));
+    TEST_ASSERT_TRUE(h.wasSeenRecently(0x1234, 1, 2000, true));
+    TEST_ASSERT_FALSE(h.wasSeenRecently(0x1234, 2, 2000, true)); // same sender, different id
+    TEST_ASSERT_FALSE(h.wasSeenRecently(0x4321, 1, 2000, true)); // same id, different sender
+
+    // Without update we must not add a record
+    TEST_ASSERT_FALSE(h.wasSeenRecently(0x5555, 7, 3000, false));
+    TEST_ASSERT_FALSE(h.wasSeenRecently(0x5555, 7, 3000, false));
+
+    TEST_ASSERT_EQUAL_UINT32(1, h.getPacketHistoryStats().hits);
+}
+
+void test_expiry(void)
+{
+    TestPacketHistory h;
+
+    h.wasSeenRecently(0x1234, 1, 0, true);
+    TEST_ASSERT_TRUE(h.wasSeenRecently(0x1234, 1, FLOOD_EXPIRE_TIME - 1, false));
+    TEST_ASSERT_FALSE(h.wasSeenRecently(0x1234, 1, FLOOD_EXPIRE_TIME, false));
+    TEST_ASSERT_EQUAL_UINT32(1, h.getPacketHistoryStats().expirations);
+
+    // Seeing a packet again refreshes its timestamp
+    h.wasSeenRecently(0x1234, 2, 0, true);
+    h.wasSeenRecently(0x1234, 2, FLOOD_EXPIRE_TIME / 2, true);
+    TEST_ASSERT_TRUE(h.wasSeenRecently(0x1234, 2, FLOOD_EXPIRE_TIME + 1, false));
+
+    // millis() wraps, the history must not care
+    h.wasSeenRecently(0x1234, 3, UINT32_MAX - 10, true);
+    TEST_ASSERT_TRUE(h.wasSeenRecently(0x1234, 3, 10, false));
+}
+
+void test_growth(void)
+{
+    TestPacketHistory h;
+
+    // Refresh one packet so the buffer holds a leftover copy of it, then hear far more than the initial size in one go
+    h.wasSeenRecently(0x1234, 1, 0, true);
+    h.wasSeenRecently(0x1234, 1, 1000, true);
+    const uint32_t numPackets = 5000;
+    for (uint32_t i = 0; i < numPackets; i++)
+        h.wasSeenRecently(0x1000 + (i % 37), i + 100, 2000, true);
+
+    // Nothing unexpired may be forgotten
+    TEST_ASSERT_EQUAL_UINT32(0, h.getPacketHistoryStats().evictions);
+    for (uint32_t i = 0; i < numPackets; i++)
+        TEST_ASSERT_TRUE(h.wasSeenRecently(0x1000 + (i % 37), i + 100, 2000, false));
+
+    // The refreshed packet keeps its newer timestamp across the move
+    TEST_ASSERT_TRUE(h.wasSeenRecently(0x1234, 1, FLOOD_EXPIRE_TIME + 500, false));
+    TEST_ASSERT_FALSE(h.wasSeenRecently(0x1234, 1, FLOOD_EXPIRE_TIME + 1000, false));
+    TEST_ASSERT_FALSE(h.wasSeenRecently(0x1000, 100, FLOOD_EXPIRE_TIME + 2000, false));
+}
+
+void test_eviction(void)
+{
+    TestPacketHistory h;
+
+    // Flood the history with more packets than it can ever grow to hold, the newest must still be found
+    const uint32_t numPackets = 100000;
+    for (uint32_t i = 0; i < numPackets; i++)
+        h.wasSeenRecently(0x1000 + (i % 37), i, 0, true);
+
+    const PacketHistoryStats &stats = h.getPacketHistoryStats();
+    TEST_ASSERT_TRUE(stats.evictions > 0);
+    TEST_ASSERT_TRUE(h.wasSeenRecently(0x1000 + ((numPackets - 1) % 37), numPackets - 1, 0, false));
+    TEST_ASSERT_FALSE(h.wasSeenRecently(0x1000, 0, 0, false));
+}
+
+void test_benchmark(void)
+{
+    TestPacketHistory h;
+
+    // Replay a million packets from 150 nodes with sequential ids, each heard three times (original + two rebroadcasts)
+    const uint32_t numPackets = 1000000;
+    uint32_t now = 0, seen = 0;
+    uint32_t start = micros();
+    for (uint32_t i = 0; i < numPackets; i++) {
+        now += 5;
+        uint32_t n = i / 3;
+        if (h.wasSeenRecently(0x1000 + (n % 150), n / 150, now, true))
+            seen++;
+    }
+    uint32_t elapsed = micros() - start;
+
+    const PacketHistoryStats &stats = h.getPacketHistoryStats();
+    char msg[160];
+    snprintf(msg, sizeof(msg), "%u packets in %u us (%u ns/packet), hits %u misses %u evictions %u expirations %u", numPackets,
+             elapsed, (uint32_t)((uint64_t)elapsed * 1000 / numPackets), stats.hits, stats.misses, stats.evictions,
+             stats.expirations);
+    TEST_MESSAGE(msg);
+
+    TEST_ASSERT_EQUAL_UINT32(numPackets / 3 * 2, seen);
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs
+    // if board doesn't support software reset via Serial.DTR/RTS
+    delay(2000);
+
+    UNITY_BEGIN(); // IMPORTANT LINE!
+    RUN_TEST(test_duplicate_detection);
+    RUN_TEST(test_expiry);
+    RUN_TEST(test_growth);
+    RUN_TEST(test_eviction);
+    RUN_TEST(test_benchmark);
+}
+
+void loop()
+{
+    UNITY_END(); // stop unit testing
+}
@@ -0,0 +1,179 @@
+#include "FSCommon.h"
+#include "SafeFile.h"
+#include "mesh/NodeJournal.h"
+#include "mesh/mesh-pb-constants.h"
+
+#include <pb_encode.h>
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+#include <vector>
+
+#define SAFEFILE "/safefiletest"
+#define JOURNAL "/safefilejournaltest"
+#define NUM_NODES 1000
+
+static void removeFiles()
+{
+    const char *files[] = {SAFEFILE, SAFEFILE ".tmp", JOURNAL, JOURNAL ".tmp"};
+    for (const char *file : files)
+        if (FSCom.exists(file))
+            FSCom.remove(file);
+}
+
+void setUp(void)
+{
+    removeFiles();
+}
+
+void tearDown(void)
+{
+    removeFiles();
+}
+
+/// A node as we'd have it after hearing its NodeInfo, position and telemetry
+static meshtastic_NodeInfoLite makeNode(NodeNum num)
+{
+    meshtastic_NodeInfoLite n;
+    memset(&n, 0, sizeof(n));
+    n.num = num;
+    n.has_user = true;
+    snprintf(n.user.long_name, sizeof(n.user.long_name), "Meshtastic %04x", num & 0xffff);
+    snprintf(n.user.short_name, sizeof(n.user.short_name), "%04x", num & 0xffff);
+    n.user.public_key.size = 32;
+    memset(n.user.public_key.bytes, num & 0xff, 32);
+    n.has_position = true;
+    n.position.latitude_i = 520000000 + num;
+    n.position.longitude_i = 210000000 + num;
+    n.position.altitude = 100;
+    n.position.time = 1700000000;
+    n.has_device_metrics = true;
+    n.device_metrics.has_battery_level = true;
+    n.device_metrics.battery_level = 80;
+    n.device_metrics.has_voltage = true;
+    n.device_metrics.voltage = 3.9;
+    n.last_heard = 1700000000;
+    n.snr = 5.5;
+    n.hops_away = num % 4;
+    return n;
+}
+
+/// Counts the writes SafeFile is given, each of which used to be a filesystem write
+class CountingPrint : public Print
+{
+  public:
+    explicit CountingPrint(Print &_out) : out(_out) {}
+
+    virtual size_t write(uint8_t ch) { return write(&ch, 1); }
+    virtual size_t write(const uint8_t *buffer, size_t size)
+    {
+        writes++;
+        return out.write(buffer, size);
+    }
+
+    uint32_t writes = 0;
+
+  private:
+    Print &out;
+};
+
+/// Mostly tiny writes, with a few bigger than the buffer, must come back exactly as written
+void test_roundtrip(void)
+{
+    std::vector<uint8_t> data(3 * SAFEFILE_BUFFER_SIZE + 123);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = i * 7 + (i >> 8);
+
+    uint32_t fsWrites = SafeFile::getStats().fsWrites;
+    {
+        SafeFile f(SAFEFILE);
+        size_t pos = 0, step = 1;
+        while (pos < data.size()) {
+            size_t n = std::min(step, data.size() - pos);
+            if (n == 1)
+                TEST_ASSERT_EQUAL_UINT32(1, f.write(data[pos]));
+            else
+                TEST_ASSERT_EQUAL_UINT32(n, f.write(data.data() + pos, n));
+            pos += n;
+            step = step < SAFEFILE_BUFFER_SIZE ? step * 3 : 1;
+        }
+        TEST_ASSERT_TRUE(f.close());
+    }
+    TEST_ASSERT_TRUE(SafeFile::getStats().fsWrites - fsWrites <= data.size() / SAFEFILE_BUFFER_SIZE + 2);
+
+    TEST_ASSERT_FALSE(FSCom.exists(SAFEFILE ".tmp"));
+    auto f = FSCom.open(SAFEFILE, FILE_O_READ);
+    TEST_ASSERT_TRUE(f);
+    std::vector<uint8_t> readBack(data.size() + 1);
+    size_t got = 0;
+    int n;
+    while ((n = f.read(readBack.data() + got, readBack.size() - got)) > 0)
+        got += n;
+    f.close();
+    TEST_ASSERT_EQUAL_UINT32(data.size(), got);
+    TEST_ASSERT_EQUAL_MEMORY(data.data(), readBack.data(), data.size());
+}
+
+/**
+ * Saving a 1000 node DB, both the way saveProto() used to (nanopb streaming every node through writecb) and by compacting
+ * the node journal (a write per node).
+ */
+void test_benchmark(void)
+{
+    std::vector<meshtastic_NodeInfoLite> nodes(NUM_NODES);
+    for (pb_size_t i = 0; i < NUM_NODES; i++)
+        nodes[i] = makeNode(1000 + i);
+
+    SafeFileStats before = SafeFile::getStats();
+    uint32_t start = micros();
+    uint32_t callerWrites; // what used to reach the filesystem
+    {
+        SafeFile f(SAFEFILE, true);
+        CountingPrint counting(f);
+        pb_ostream_t stream = {&writecb, static_cast<Print *>(&counting), SIZE_MAX};
+        for (pb_size_t i = 0; i < NUM_NODES; i++)
+            TEST_ASSERT_TRUE(pb_encode(&stream, &meshtastic_NodeInfoLite_msg, &nodes[i]));
+        TEST_ASSERT_TRUE(f.close());
+        callerWrites = counting.writes;
+    }
+    uint32_t protoMicros = micros() - start;
+    SafeFileStats afterProto = SafeFile::getStats();
+
+    NodeJournal journal(JOURNAL);
+    journal.clear(); // so save() writes it all, via SafeFile
+    start = micros();
+    TEST_ASSERT_TRUE(journal.save(nodes, NUM_NODES));
+    uint32_t journalMicros = micros() - start;
+    SafeFileStats after = SafeFile::getStats();
+
+    uint32_t protoWrites = afterProto.fsWrites - before.fsWrites;
+    TEST_ASSERT_TRUE(protoWrites <= (afterProto.bytes - before.bytes) / SAFEFILE_BUFFER_SIZE + 1);
+    TEST_ASSERT_TRUE(after.fsWrites - afterProto.fsWrites < NUM_NODES / 10);
+
+    char msg[250];
+    snprintf(msg, sizeof(msg), "%u nodes as protobuf: %u bytes, %u writes became %u, %u us (%u us readback)", NUM_NODES,
+             afterProto.bytes - before.bytes, callerWrites, protoWrites, protoMicros,
+             afterProto.readbackMicros - before.readbackMicros);
+    TEST_MESSAGE(msg);
+    snprintf(msg, sizeof(msg), "%u nodes journal compaction: %u bytes, %u writes became %u, %u us (%u us readback)", NUM_NODES,
+             after.bytes - afterProto.bytes, NUM_NODES, after.fsWrites - afterProto.fsWrites, journalMicros,
+             after.readbackMicros - afterProto.readbackMicros);
+    TEST_MESSAGE(msg);
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs
+    // if board doesn't support software reset via Serial.DTR/RTS
+    delay(2000);
+
+    FSBegin();
+    UNITY_BEGIN(); // IMPORTANT LINE!
+    RUN_TEST(test_roundtrip);
+    RUN_TEST(test_benchmark);
+}
+
+void loop()
+{
+    UNITY_END(); // stop unit testing
+}
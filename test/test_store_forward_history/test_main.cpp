@@ -0,0 +1,258 @@
+#include "modules/StoreForwardHistory.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+#include <vector>
+
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+static uint32_t addText(StoreForwardHistory &h, uint32_t time, NodeNum to, NodeNum from, const char *text)
+{
+    return h.add(time, to, from, 0, (const uint8_t *)text, strlen(text));
+}
+
+void test_filtering(void)
+{
+    StoreForwardHistory h;
+    TEST_ASSERT_TRUE(h.init(64 * 1024, 1000));
+
+    addText(h, 100, NODENUM_BROADCAST, 1, "from 1 to all");  // 0
+    addText(h, 110, 2, 1, "from 1 to 2");                    // 1
+    addText(h, 120, NODENUM_BROADCAST, 2, "from 2 to all");  // 2
+    addText(h, 130, 3, 1, "from 1 to 3");                    // 3
+    addText(h, 140, 2, 3, "from 3 to 2");                    // 4
+    addText(h, 90, NODENUM_BROADCAST, 3, "clock went back"); // 5, keeps time 140
+
+    uint32_t seq;
+    TEST_ASSERT_EQUAL_UINT32(4, h.count(2, 0, 0));
+    TEST_ASSERT_EQUAL_UINT32(3, h.count(3, 0, 0)); // not its own broadcast
+    TEST_ASSERT_EQUAL_UINT32(2, h.count(1, 0, 0));
+    TEST_ASSERT_EQUAL_UINT32(2, h.count(2, 0, 0, 2));
+
+    // Node 2 gets broadcasts from others and its direct messages, in order
+    const uint32_t expected2[] = {0, 1, 4, 5};
+    uint32_t cursor = 0;
+    for (uint32_t e : expected2) {
+        TEST_ASSERT_TRUE(h.next(2, cursor, 0, seq));
+        TEST_ASSERT_EQUAL_UINT32(e, seq);
+        cursor = seq + 1;
+    }
+    TEST_ASSERT_FALSE(h.next(2, cursor, 0, seq));
+
+    // Time window
+    TEST_ASSERT_TRUE(h.next(2, 0, 115, seq));
+    TEST_ASSERT_EQUAL_UINT32(4, seq);
+    TEST_ASSERT_EQUAL_UINT32(2, h.count(2, 0, 115));
+    TEST_ASSERT_EQUAL_UINT32(0, h.count(2, 0, 140));
+
+    PacketHistoryStruct r;
+    TEST_ASSERT_TRUE(h.get(3, r));
+    TEST_ASSERT_EQUAL_UINT32(3, r.to);
+    TEST_ASSERT_EQUAL_UINT32(1, r.from);
+    TEST_ASSERT_EQUAL_UINT32(130, r.time);
+    TEST_ASSERT_EQUAL_UINT32(strlen("from 1 to 3"), r.payload_size);
+    TEST_ASSERT_EQUAL_MEMORY("from 1 to 3", r.payload, r.payload_size);
+    TEST_ASSERT_TRUE(h.get(5, r));
+    TEST_ASSERT_EQUAL_UINT32(140, r.time);
+    TEST_ASSERT_FALSE(h.get(6, r));
+}
+
+/// Check next() and count() against a brute force walk over every record still held, for random clients and cursors
+static void checkAgainstScan(const StoreForwardHistory &h, uint32_t clients)
+{
+    uint32_t first = h.getNextSeq() - h.getCount();
+    PacketHistoryStruct r;
+    for (int trial = 0; trial < 20; trial++) {
+        NodeNum dest = 1 + rand() % clients;
+        uint32_t cursor = rand() % (h.getNextSeq() + 1);
+        uint32_t since = (rand() % 2) ? 0 : rand() % (h.getNextSeq() + 1);
+
+        uint32_t expectedCount = 0, expectedFirst = StoreForwardHistory::NONE;
+        for (uint32_t s = first; s < h.getNextSeq(); s++) {
+            TEST_ASSERT_TRUE(h.get(s, r));
+            if (s >= cursor && r.time > since && r.from != dest && (r.to == NODENUM_BROADCAST || r.to == dest)) {
+                if (!expectedCount)
+                    expectedFirst = s;
+                expectedCount++;
+            }
+        }
+
+        uint32_t seq;
+        TEST_ASSERT_EQUAL_UINT32(expectedCount, h.count(dest, cursor, since));
+        TEST_ASSERT_EQUAL(expectedCount != 0, h.next(dest, cursor, since, seq));
+        if (expectedCount)
+            TEST_ASSERT_EQUAL_UINT32(expectedFirst, seq);
+    }
+}
+
+void test_wraparound(void)
+{
+    // Small enough to wrap many times, with both the byte space and the record index running out
+    StoreForwardHistory h;
+    TEST_ASSERT_TRUE(h.init(4096, 60));
+    const uint32_t clients = 8;
+    uint8_t payload[meshtastic_Constants_DATA_PAYLOAD_LEN];
+
+    srand(1234);
+    for (uint32_t i = 0; i < 5000; i++) {
+        pb_size_t size = (rand() % 4) ? rand() % 40 : rand() % sizeof(payload);
+        memset(payload, i & 0xff, size);
+        NodeNum to = (rand() % 4) ? NODENUM_BROADCAST : 1 + rand() % clients;
+        uint32_t seq = h.add(i, to, 1 + rand() % clients, i & 7, payload, size);
+        TEST_ASSERT_EQUAL_UINT32(i, seq);
+        TEST_ASSERT_TRUE(h.getCount() <= 60);
+        TEST_ASSERT_TRUE(h.getCount() >= 1);
+
+        // The newest record is always intact
+        PacketHistoryStruct r;
+        TEST_ASSERT_TRUE(h.get(seq, r));
+        TEST_ASSERT_EQUAL_UINT32(size, r.payload_size);
+        TEST_ASSERT_EQUAL_UINT8(i & 7, r.channel);
+        for (pb_size_t b = 0; b < size; b++)
+            TEST_ASSERT_EQUAL_UINT8(i & 0xff, r.payload[b]);
+
+        if (i % 97 == 0)
+            checkAgainstScan(h, clients);
+    }
+    checkAgainstScan(h, clients);
+
+    // A client whose cursor points at a dropped record just picks up from the oldest one we still have
+    uint32_t seq;
+    TEST_ASSERT_TRUE(h.next(NODENUM_BROADCAST - 1, 0, 0, seq));
+    TEST_ASSERT_TRUE(seq >= h.getNextSeq() - h.getCount());
+}
+
+/// The old flat array history, and the two scans StoreForwardModule used to serve a client from it
+struct FlatHistory {
+    std::vector<PacketHistoryStruct> records;
+    uint32_t total = 0;
+
+    uint32_t count(NodeNum dest, uint32_t cursor, uint32_t since)
+    {
+        uint32_t n = 0;
+        for (uint32_t i = cursor; i < total; i++)
+            if (records[i].time && records[i].time > since && records[i].from != dest &&
+                (records[i].to == NODENUM_BROADCAST || records[i].to == dest))
+                n++;
+        return n;
+    }
+
+    bool next(NodeNum dest, uint32_t &cursor, uint32_t since, PacketHistoryStruct &out)
+    {
+        for (uint32_t i = cursor; i < total; i++)
+            if (records[i].time && records[i].time > since && records[i].from != dest &&
+                (records[i].to == NODENUM_BROADCAST || records[i].to == dest)) {
+                memcpy(&out, &records[i], sizeof(out));
+                cursor = i + 1;
+                return true;
+            }
+        return false;
+    }
+};
+
+void test_benchmark(void)
+{
+    const uint32_t numRecords = 20000, numClients = 200, returnMax = 25;
+    uint8_t payload[meshtastic_Constants_DATA_PAYLOAD_LEN];
+    memset(payload, 'x', sizeof(payload));
+
+    FlatHistory flat;
+    flat.records.resize(numRecords);
+    StoreForwardHistory h;
+    TEST_ASSERT_TRUE(h.init(numRecords * 96, numRecords));
+
+    // Mostly short broadcasts, some direct messages, a few long ones
+    struct Traffic {
+        NodeNum to, from;
+        pb_size_t size;
+    };
+    std::vector<Traffic> traffic(numRecords);
+    srand(42);
+    for (uint32_t i = 0; i < numRecords; i++) {
+        traffic[i].size = (i % 10) ? 20 + rand() % 40 : 200;
+        traffic[i].to = (i % 5) ? NODENUM_BROADCAST : 1 + rand() % numClients;
+        traffic[i].from = 1 + rand() % numClients;
+    }
+
+    uint32_t start = micros();
+    for (uint32_t i = 0; i < numRecords; i++) {
+        PacketHistoryStruct &r = flat.records[flat.total++];
+        r.time = 1000 + i;
+        r.to = traffic[i].to;
+        r.from = traffic[i].from;
+        r.channel = 0;
+        r.payload_size = traffic[i].size;
+        memcpy(r.payload, payload, sizeof(r.payload)); // the old code always copied the whole buffer
+    }
+    uint32_t addFlat = micros() - start;
+
+    start = micros();
+    for (uint32_t i = 0; i < numRecords; i++)
+        h.add(1000 + i, traffic[i].to, traffic[i].from, 0, payload, traffic[i].size);
+    uint32_t addRing = micros() - start;
+    TEST_ASSERT_EQUAL_UINT32(numRecords, h.getCount());
+
+    // Every client asks for the last hour, then gets up to returnMax messages
+    const uint32_t since = 1000 + numRecords - 3600;
+    PacketHistoryStruct out;
+    uint32_t sentFlat = 0, sentRing = 0;
+
+    start = micros();
+    for (NodeNum c = 1; c <= numClients; c++) {
+        uint32_t cursor = 0;
+        uint32_t n = flat.count(c, cursor, since);
+        for (uint32_t i = 0; i < n && i < returnMax && flat.next(c, cursor, since, out); i++)
+            sentFlat++;
+    }
+    uint32_t serveFlat = micros() - start;
+
+    start = micros();
+    for (NodeNum c = 1; c <= numClients; c++) {
+        uint32_t cursor = 0, seq;
+        uint32_t n = h.count(c, cursor, since, returnMax);
+        for (uint32_t i = 0; i < n && h.next(c, cursor, since, seq) && h.get(seq, out); i++) {
+            cursor = seq + 1;
+            sentRing++;
+        }
+    }
+    uint32_t serveRing = micros() - start;
+
+    TEST_ASSERT_EQUAL_UINT32(sentFlat, sentRing);
+
+    char msg[240];
+    snprintf(msg, sizeof(msg),
+             "%u records: add flat %u ns, ring %u ns; serve %u clients x %u flat %u us/client, ring %u us/client; "
+             "memory flat %u KB, ring %u KB",
+             numRecords, (uint32_t)((uint64_t)addFlat * 1000 / numRecords), (uint32_t)((uint64_t)addRing * 1000 / numRecords),
+             numClients, returnMax, serveFlat / numClients, serveRing / numClients,
+             (uint32_t)(numRecords * sizeof(PacketHistoryStruct) / 1024),
+             (uint32_t)(numRecords * (96 + StoreForwardHistory::INDEX_BYTES_PER_RECORD) / 1024));
+    TEST_MESSAGE(msg);
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs
+    // if board doesn't support software reset via Serial.DTR/RTS
+    delay(2000);
+
+    UNITY_BEGIN(); // IMPORTANT LINE!
+    RUN_TEST(test_filtering);
+    RUN_TEST(test_wraparound);
+    RUN_TEST(test_benchmark);
+}
+
+void loop()
+{
+    UNITY_END(); // stop unit testing
+}
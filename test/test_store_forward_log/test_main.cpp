@@ -0,0 +1,224 @@
+#include "FSCommon.h"
+#include "modules/StoreForwardLog.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+
+#define LOG_DIR "/sflogtest"
+
+static void removeLog()
+{
+    char path[40];
+    for (int slot = 0; slot < 64; slot++) {
+        snprintf(path, sizeof(path), LOG_DIR "/seg%d", slot);
+        if (FSCom.exists(path))
+            FSCom.remove(path);
+    }
+}
+
+void setUp(void)
+{
+    removeLog();
+}
+
+void tearDown(void)
+{
+    removeLog();
+}
+
+static void makeText(char *text, uint32_t i)
+{
+    snprintf(text, 64, "message number %u", i);
+}
+
+/// Check record seq is message i from addMessages()
+static void checkRecord(const StoreForwardLog &log, uint32_t seq, uint32_t i)
+{
+    char text[64];
+    makeText(text, i);
+    PacketHistoryStruct r;
+    TEST_ASSERT_TRUE(log.get(seq, r));
+    TEST_ASSERT_EQUAL_UINT32(1000 + i, r.time);
+    TEST_ASSERT_EQUAL_UINT32((i % 3) ? NODENUM_BROADCAST : i % 7, r.to);
+    TEST_ASSERT_EQUAL_UINT32(100 + i % 5, r.from);
+    TEST_ASSERT_EQUAL_UINT8(i & 7, r.channel);
+    TEST_ASSERT_EQUAL_UINT32(strlen(text), r.payload_size);
+    TEST_ASSERT_EQUAL_MEMORY(text, r.payload, r.payload_size);
+}
+
+static void addMessages(StoreForwardLog &log, uint32_t first, uint32_t n)
+{
+    char text[64];
+    for (uint32_t i = first; i < first + n; i++) {
+        makeText(text, i);
+        log.add(1000 + i, (i % 3) ? NODENUM_BROADCAST : i % 7, 100 + i % 5, i & 7, (const uint8_t *)text, strlen(text));
+    }
+}
+
+void test_reopen(void)
+{
+    {
+        StoreForwardHistory index;
+        TEST_ASSERT_TRUE(index.init(1000 * StoreForwardLog::indexRecordLen(), 1000));
+        StoreForwardLog log(index);
+        TEST_ASSERT_TRUE(log.begin(LOG_DIR, 4, 8192));
+        addMessages(log, 0, 100);
+
+        // Readable before and after they are written out
+        checkRecord(log, 99, 99);
+        TEST_ASSERT_TRUE(log.getPendingBytes() > 0);
+        TEST_ASSERT_TRUE(log.flush());
+        TEST_ASSERT_EQUAL_UINT32(0, log.getPendingBytes());
+        checkRecord(log, 99, 99);
+
+        // Never written, so lost after the "reboot"
+        addMessages(log, 100, 5);
+    }
+
+    StoreForwardHistory index;
+    TEST_ASSERT_TRUE(index.init(1000 * StoreForwardLog::indexRecordLen(), 1000));
+    StoreForwardLog log(index);
+    TEST_ASSERT_TRUE(log.begin(LOG_DIR, 4, 8192));
+    TEST_ASSERT_EQUAL_UINT32(100, index.getCount());
+    for (uint32_t i = 0; i < 100; i++)
+        checkRecord(log, i, i);
+
+    // The index answers for clients as before
+    uint32_t seq;
+    TEST_ASSERT_TRUE(index.next(0, 0, 0, seq)); // first message to node 0 is number 0, from 100
+    TEST_ASSERT_EQUAL_UINT32(0, seq);
+
+    // Carries on after the old records
+    addMessages(log, 100, 10);
+    TEST_ASSERT_TRUE(log.flush());
+    checkRecord(log, 105, 105);
+}
+
+void test_torn_tail(void)
+{
+    {
+        StoreForwardHistory index;
+        TEST_ASSERT_TRUE(index.init(1000 * StoreForwardLog::indexRecordLen(), 1000));
+        StoreForwardLog log(index);
+        TEST_ASSERT_TRUE(log.begin(LOG_DIR, 4, 8192));
+        addMessages(log, 0, 20);
+        TEST_ASSERT_TRUE(log.flush());
+    }
+
+    // Power went while writing the next record
+    File f = FSCom.open(LOG_DIR "/seg0", FILE_O_APPEND);
+    const uint8_t partial[] = {0xa5, 0, 200, 0, 1, 2, 3};
+    f.write(partial, sizeof(partial));
+    f.close();
+
+    StoreForwardHistory index;
+    TEST_ASSERT_TRUE(index.init(1000 * StoreForwardLog::indexRecordLen(), 1000));
+    StoreForwardLog log(index);
+    TEST_ASSERT_TRUE(log.begin(LOG_DIR, 4, 8192));
+    TEST_ASSERT_EQUAL_UINT32(20, index.getCount());
+
+    // New records go into a fresh segment rather than after the damage
+    addMessages(log, 20, 5);
+    TEST_ASSERT_TRUE(log.flush());
+    TEST_ASSERT_TRUE(FSCom.exists(LOG_DIR "/seg1"));
+    for (uint32_t i = 0; i < 25; i++)
+        checkRecord(log, i, i);
+}
+
+void test_wraparound(void)
+{
+    const uint32_t total = 3000;
+    uint32_t kept;
+    {
+        StoreForwardHistory index;
+        TEST_ASSERT_TRUE(index.init(total * StoreForwardLog::indexRecordLen(), total));
+        StoreForwardLog log(index);
+        TEST_ASSERT_TRUE(log.begin(LOG_DIR, 3, 2048));
+        for (uint32_t i = 0; i < total; i++) {
+            addMessages(log, i, 1);
+            checkRecord(log, i, i);
+            TEST_ASSERT_TRUE(index.getCount() <= 3 * 2048 / 32);
+        }
+        TEST_ASSERT_TRUE(log.flush());
+        kept = index.getCount();
+        TEST_ASSERT_TRUE(kept > 2 * 2048 / 64); // at least two full segments
+        for (uint32_t s = total - kept; s < total; s++)
+            checkRecord(log, s, s);
+    }
+
+    StoreForwardHistory index;
+    TEST_ASSERT_TRUE(index.init(total * StoreForwardLog::indexRecordLen(), total));
+    StoreForwardLog log(index);
+    TEST_ASSERT_TRUE(log.begin(LOG_DIR, 3, 2048));
+    TEST_ASSERT_EQUAL_UINT32(kept, index.getCount());
+    // Sequence numbers start again from 0, but the records are the same ones in the same order
+    for (uint32_t s = 0; s < kept; s++)
+        checkRecord(log, s, total - kept + s);
+}
+
+void test_benchmark(void)
+{
+    const uint32_t numRecords = 20000;
+    StoreForwardHistory index;
+    TEST_ASSERT_TRUE(index.init(numRecords * StoreForwardLog::indexRecordLen(), numRecords));
+
+    uint32_t start = micros();
+    {
+        StoreForwardLog log(index);
+        TEST_ASSERT_TRUE(log.begin(LOG_DIR, 8, 256 * 1024));
+        addMessages(log, 0, numRecords);
+        TEST_ASSERT_TRUE(log.flush());
+    }
+    uint32_t grouped = micros() - start;
+
+    // The same records with a write for every one of them
+    removeLog();
+    TEST_ASSERT_TRUE(index.init(numRecords * StoreForwardLog::indexRecordLen(), numRecords));
+    start = micros();
+    {
+        StoreForwardLog log(index);
+        TEST_ASSERT_TRUE(log.begin(LOG_DIR, 8, 256 * 1024));
+        char text[64];
+        for (uint32_t i = 0; i < numRecords; i++) {
+            makeText(text, i);
+            log.add(1000 + i, NODENUM_BROADCAST, 100, 0, (const uint8_t *)text, strlen(text));
+            log.flush();
+        }
+    }
+    uint32_t single = micros() - start;
+
+    TEST_ASSERT_TRUE(index.init(numRecords * StoreForwardLog::indexRecordLen(), numRecords));
+    start = micros();
+    StoreForwardLog log(index);
+    TEST_ASSERT_TRUE(log.begin(LOG_DIR, 8, 256 * 1024));
+    uint32_t scan = micros() - start;
+    TEST_ASSERT_EQUAL_UINT32(numRecords, index.getCount());
+
+    char msg[200];
+    snprintf(msg, sizeof(msg),
+             "%u records: add %u ns grouped, %u ns writing each one; startup scan %u ms; index %u KB in RAM", numRecords,
+             (uint32_t)((uint64_t)grouped * 1000 / numRecords), (uint32_t)((uint64_t)single * 1000 / numRecords), scan / 1000,
+             (uint32_t)(numRecords * (StoreForwardLog::indexRecordLen() + StoreForwardHistory::INDEX_BYTES_PER_RECORD) / 1024));
+    TEST_MESSAGE(msg);
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs
+    // if board doesn't support software reset via Serial.DTR/RTS
+    delay(2000);
+
+    FSBegin();
+    UNITY_BEGIN(); // IMPORTANT LINE!
+    RUN_TEST(test_reopen);
+    RUN_TEST(test_torn_tail);
+    RUN_TEST(test_wraparound);
+    RUN_TEST(test_benchmark);
+}
+
+void loop()
+{
+    UNITY_END(); // stop unit testing
+}
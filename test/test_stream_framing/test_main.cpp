@@ -0,0 +1,215 @@
+#include "StreamFrameParser.h"
+
+#include <unity.h>
+#include <vector>
+
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+static void appendFrame(std::vector<uint8_t> &out, const uint8_t *payload, size_t len)
+{
+    out.push_back(StreamFrameParser::START1);
+    out.push_back(StreamFrameParser::START2);
+    out.push_back((len >> 8) & 0xff);
+    out.push_back(len & 0xff);
+    out.insert(out.end(), payload, payload + len);
+}
+
+/// Feed 'data' to the parser in blocks of 'blockSize', returning the payloads it found
+static std::vector<std::vector<uint8_t>> parseAll(StreamFrameParser &parser, const std::vector<uint8_t> &data, size_t blockSize)
+{
+    std::vector<std::vector<uint8_t>> frames;
+    for (size_t start = 0; start < data.size(); start += blockSize) {
+        size_t n = std::min(blockSize, data.size() - start);
+        size_t used = 0;
+        while (used < n) {
+            bool gotFrame;
+            used += parser.parse(data.data() + start + used, n - used, gotFrame);
+            if (gotFrame)
+                frames.emplace_back(parser.getPayload(), parser.getPayload() + parser.getPayloadLen());
+        }
+    }
+    return frames;
+}
+
+void test_frames_any_block_size(void)
+{
+    std::vector<uint8_t> stream;
+    std::vector<std::vector<uint8_t>> expected;
+    uint8_t payload[MAX_TO_FROM_RADIO_SIZE];
+
+    randomSeed(42);
+    for (int i = 0; i < 50; i++) {
+        size_t len = random(0, 3) ? random(0, 40) : random(0, MAX_TO_FROM_RADIO_SIZE + 1);
+        for (size_t j = 0; j < len; j++)
+            payload[j] = random(0, 256); // payloads may contain framing bytes too
+        appendFrame(stream, payload, len);
+        expected.emplace_back(payload, payload + len);
+    }
+
+    size_t blockSizes[] = {1, 2, 3, 7, 64, 512, stream.size()};
+    for (size_t blockSize : blockSizes) {
+        StreamFrameParser parser;
+        auto frames = parseAll(parser, stream, blockSize);
+        TEST_ASSERT_EQUAL_UINT32(expected.size(), frames.size());
+        for (size_t i = 0; i < frames.size(); i++) {
+            TEST_ASSERT_EQUAL_UINT32(expected[i].size(), frames[i].size());
+            if (frames[i].size())
+                TEST_ASSERT_EQUAL_MEMORY(expected[i].data(), frames[i].data(), frames[i].size());
+        }
+    }
+}
+
+void test_resync(void)
+{
+    const uint8_t payload[] = {0x18, 0x01};
+    std::vector<uint8_t> stream;
+
+    // Debug text, a repeated START1 and a frame with a bogus length must not stop us finding the next good frame
+    const char *text = "hello\r\n";
+    stream.insert(stream.end(), text, text + strlen(text));
+    stream.push_back(StreamFrameParser::START1);
+    appendFrame(stream, payload, sizeof(payload));
+    const uint8_t bogus[] = {StreamFrameParser::START1, StreamFrameParser::START2, 0xff, 0xff};
+    stream.insert(stream.end(), bogus, bogus + sizeof(bogus));
+    appendFrame(stream, payload, sizeof(payload));
+
+    StreamFrameParser parser;
+    auto frames = parseAll(parser, stream, 5);
+    TEST_ASSERT_EQUAL_UINT32(2, frames.size());
+    TEST_ASSERT_EQUAL_MEMORY(payload, frames[1].data(), sizeof(payload));
+}
+
+/// Stands in for a UART/TCP Stream: virtual calls into a receive buffer, like the real drivers
+class MemoryStream
+{
+    const std::vector<uint8_t> &data;
+    size_t pos = 0;
+
+  public:
+    explicit MemoryStream(const std::vector<uint8_t> &_data) : data(_data) {}
+    virtual ~MemoryStream() {}
+    virtual int available() { return data.size() - pos; }
+    virtual int read() { return pos < data.size() ? data[pos++] : -1; }
+    virtual size_t readBytes(uint8_t *buf, size_t len)
+    {
+        len = std::min(len, data.size() - pos);
+        memcpy(buf, data.data() + pos, len);
+        pos += len;
+        return len;
+    }
+};
+
+/// The read loop StreamAPI used before: available() and read() for every byte, then a byte at a time state machine
+static size_t readBytewise(MemoryStream &stream)
+{
+    uint8_t rxBuf[MAX_TO_FROM_RADIO_SIZE + StreamFrameParser::HEADER_LEN];
+    size_t rxPtr = 0, frames = 0;
+    while (stream.available()) {
+        int cInt = stream.read();
+        if (cInt < 0)
+            break;
+        uint8_t c = (uint8_t)cInt;
+        size_t ptr = rxPtr;
+        rxPtr++;
+        rxBuf[ptr] = c;
+        if (ptr == 0) {
+            if (c != StreamFrameParser::START1)
+                rxPtr = 0;
+        } else if (ptr == 1) {
+            if (c != StreamFrameParser::START2)
+                rxPtr = 0;
+        } else if (ptr >= StreamFrameParser::HEADER_LEN - 1) {
+            uint32_t len = (rxBuf[2] << 8) + rxBuf[3];
+            if (ptr == StreamFrameParser::HEADER_LEN - 1 && len > MAX_TO_FROM_RADIO_SIZE)
+                rxPtr = 0;
+            if (rxPtr != 0 && ptr + 1 >= len + StreamFrameParser::HEADER_LEN) {
+                rxPtr = 0;
+                frames++;
+            }
+        }
+    }
+    return frames;
+}
+
+/// The read loop StreamAPI uses now
+static size_t readBlocks(MemoryStream &stream)
+{
+    StreamFrameParser parser;
+    size_t frames = 0;
+    uint8_t block[128];
+    int avail;
+    while ((avail = stream.available()) > 0) {
+        size_t n = stream.readBytes(block, std::min((size_t)avail, sizeof(block)));
+        size_t used = 0;
+        while (used < n) {
+            bool gotFrame;
+            used += parser.parse(block + used, n - used, gotFrame);
+            if (gotFrame)
+                frames++;
+        }
+    }
+    return frames;
+}
+
+void test_benchmark(void)
+{
+    // Typical ToRadio traffic: mostly small packets with the odd large one
+    std::vector<uint8_t> stream;
+    uint8_t payload[MAX_TO_FROM_RADIO_SIZE];
+    const size_t numFrames = 20000;
+    randomSeed(1);
+    for (size_t i = 0; i < numFrames; i++) {
+        size_t len = (i % 10) ? random(10, 80) : random(200, MAX_TO_FROM_RADIO_SIZE + 1);
+        for (size_t j = 0; j < len; j++)
+            payload[j] = random(0, 256);
+        appendFrame(stream, payload, len);
+    }
+
+    MemoryStream before(stream);
+    uint32_t start = micros();
+    size_t found = readBytewise(before);
+    uint32_t bytewise = micros() - start;
+    TEST_ASSERT_EQUAL_UINT32(numFrames, found);
+
+    MemoryStream after(stream);
+    start = micros();
+    found = readBlocks(after);
+    uint32_t block = micros() - start;
+    TEST_ASSERT_EQUAL_UINT32(numFrames, found);
+
+    char msg[200];
+    snprintf(msg, sizeof(msg), "%u frames (%u bytes): bytewise %u frames/sec (%u ns/frame), block %u frames/sec (%u ns/frame)",
+             (unsigned)numFrames, (unsigned)stream.size(), (uint32_t)((uint64_t)numFrames * 1000000 / (bytewise ? bytewise : 1)),
+             (uint32_t)((uint64_t)bytewise * 1000 / numFrames), (uint32_t)((uint64_t)numFrames * 1000000 / (block ? block : 1)),
+             (uint32_t)((uint64_t)block * 1000 / numFrames));
+    TEST_MESSAGE(msg);
+
+    // Latency added by the old polling: a request arriving on an idle link waited for the next 250 ms poll, on average half
+    // of that.  With a data-ready wakeup (or onNowHasData for outbound packets) that becomes the parse time above.
+    TEST_MESSAGE("idle link poll latency before: up to 250 ms (mean 125 ms), after: next main loop iteration");
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs
+    // if board doesn't support software reset via Serial.DTR/RTS
+    delay(2000);
+
+    UNITY_BEGIN(); // IMPORTANT LINE!
+    RUN_TEST(test_frames_any_block_size);
+    RUN_TEST(test_resync);
+    RUN_TEST(test_benchmark);
+}
+
+void loop()
+{
+    UNITY_END(); // stop unit testing
+}
@@ -0,0 +1,168 @@
+#include "gps/UBXNavPvt.h"
+
+#include <string.h>
+#include <unity.h>
+
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+static void put2(uint8_t *b, uint16_t v)
+{
+    b[0] = v;
+    b[1] = v >> 8;
+}
+
+static void put4(uint8_t *b, int32_t v)
+{
+    for (int i = 0; i < 4; i++)
+        b[i] = (uint32_t)v >> (8 * i);
+}
+
+/// The fix of the GGA/RMC/GSA sentences below, as a u-blox M8 would send it
+static void makePayload(uint8_t *payload)
+{
+    memset(payload, 0, UBX_NAV_PVT_LEN);
+    put2(payload + 4, 2002);
+    payload[6] = 12;
+    payload[7] = 9;
+    payload[8] = 9;
+    payload[9] = 27;
+    payload[10] = 25;
+    payload[11] = 0x07; // validDate, validTime, fullyResolved
+    payload[20] = 3;    // 3D
+    payload[21] = 0x01; // gnssFixOK
+    payload[23] = 8;
+    put4(payload + 24, 85651983);  // lon
+    put4(payload + 28, 472852332); // lat
+    put4(payload + 32, 547600);    // height above ellipsoid
+    put4(payload + 36, 499600);    // height above mean sea level
+    put4(payload + 60, 2000);      // ground speed, mm/s
+    put4(payload + 64, 7752000);   // heading of motion
+    put2(payload + 76, 194);       // pDOP
+}
+
+void test_decode(void)
+{
+    uint8_t payload[UBX_NAV_PVT_LEN];
+    makePayload(payload);
+
+    meshtastic_Position p = meshtastic_Position_init_default;
+    TEST_ASSERT_TRUE(decodeNavPvt(payload, sizeof(payload), p));
+    TEST_ASSERT_EQUAL_INT32(472852332, p.latitude_i);
+    TEST_ASSERT_EQUAL_INT32(85651983, p.longitude_i);
+    TEST_ASSERT_EQUAL_INT32(499, p.altitude);
+    TEST_ASSERT_EQUAL_INT32(547, p.altitude_hae);
+    TEST_ASSERT_EQUAL_INT32(48, p.altitude_geoidal_separation);
+    TEST_ASSERT_EQUAL_UINT32(194, p.PDOP);
+    TEST_ASSERT_EQUAL_UINT32(137, p.HDOP);
+    TEST_ASSERT_EQUAL_UINT32(1, p.fix_quality);
+    TEST_ASSERT_EQUAL_UINT32(3, p.fix_type);
+    TEST_ASSERT_EQUAL_UINT32(8, p.sats_in_view);
+    TEST_ASSERT_EQUAL_UINT32(7, p.ground_speed);
+    TEST_ASSERT_EQUAL_UINT32(7752000, p.ground_track);
+    TEST_ASSERT_EQUAL_UINT32(1039426045, p.timestamp); // 2002-12-09 09:27:25 UTC
+}
+
+void test_no_fix(void)
+{
+    uint8_t payload[UBX_NAV_PVT_LEN];
+    makePayload(payload);
+    meshtastic_Position p = meshtastic_Position_init_default;
+
+    // Time only, no position
+    payload[20] = 5;
+    TEST_ASSERT_TRUE(decodeNavPvt(payload, sizeof(payload), p));
+    TEST_ASSERT_EQUAL_UINT32(0, p.fix_quality);
+    TEST_ASSERT_EQUAL_UINT32(1, p.fix_type);
+    TEST_ASSERT_EQUAL_UINT32(1039426045, p.timestamp);
+
+    // A 2D fix the receiver doesn't trust
+    payload[20] = 2;
+    payload[21] = 0;
+    TEST_ASSERT_TRUE(decodeNavPvt(payload, sizeof(payload), p));
+    TEST_ASSERT_EQUAL_UINT32(0, p.fix_quality);
+
+    // Trusted, but lat/lon flagged invalid
+    payload[21] = 0x01;
+    payload[78] = 0x01;
+    TEST_ASSERT_TRUE(decodeNavPvt(payload, sizeof(payload), p));
+    TEST_ASSERT_EQUAL_UINT32(0, p.fix_quality);
+
+    // u-blox 7 has no flags3, and a differential 2D fix
+    payload[21] = 0x03;
+    TEST_ASSERT_TRUE(decodeNavPvt(payload, UBX_NAV_PVT_MIN_LEN, p));
+    TEST_ASSERT_EQUAL_UINT32(2, p.fix_quality);
+    TEST_ASSERT_EQUAL_UINT32(2, p.fix_type);
+
+    // No valid time yet
+    payload[11] = 0x01;
+    TEST_ASSERT_TRUE(decodeNavPvt(payload, sizeof(payload), p));
+    TEST_ASSERT_EQUAL_UINT32(0, p.timestamp);
+}
+
+void test_too_short(void)
+{
+    uint8_t payload[UBX_NAV_PVT_LEN];
+    makePayload(payload);
+    meshtastic_Position p = meshtastic_Position_init_default;
+    TEST_ASSERT_FALSE(decodeNavPvt(payload, UBX_NAV_PVT_MIN_LEN - 1, p));
+    TEST_ASSERT_EQUAL_INT32(0, p.latitude_i);
+}
+
+/// UART bytes and decode time per fix, against the NMEA sentences that carry the same solution
+void test_benchmark(void)
+{
+    static const char *nmea[] = {
+        "$GNGGA,092725.00,4717.11399,N,00833.91590,E,1,08,1.01,499.6,M,48.0,M,,*5B\r\n",
+        "$GNRMC,092725.00,A,4717.11399,N,00833.91590,E,0.004,77.52,091202,,,A*57\r\n",
+        "$GNGSA,A,3,23,29,07,08,09,18,26,28,,,,,1.94,1.18,1.54*0D\r\n",
+    };
+    size_t nmeaBytes = 0;
+    for (size_t i = 0; i < sizeof(nmea) / sizeof(nmea[0]); i++)
+        nmeaBytes += strlen(nmea[i]);
+    size_t pvtBytes = 6 + UBX_NAV_PVT_LEN + 2; // header and checksum
+    TEST_ASSERT_TRUE(pvtBytes < nmeaBytes);
+
+    uint8_t payload[UBX_NAV_PVT_LEN];
+    makePayload(payload);
+    meshtastic_Position p = meshtastic_Position_init_default;
+
+    const int rounds = 10000;
+    uint32_t start = micros();
+    for (int i = 0; i < rounds; i++) {
+        payload[10] = i % 60;
+        decodeNavPvt(payload, sizeof(payload), p);
+    }
+    uint32_t elapsed = micros() - start;
+    TEST_ASSERT_TRUE(p.timestamp != 0);
+
+    char msg[120];
+    snprintf(msg, sizeof(msg), "NAV-PVT %u bytes per fix vs %u of GGA+RMC+GSA, decoded in %u ns", (uint32_t)pvtBytes,
+             (uint32_t)nmeaBytes, (uint32_t)((uint64_t)elapsed * 1000 / rounds));
+    TEST_MESSAGE(msg);
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs
+    // if board doesn't support software reset via Serial.DTR/RTS
+    delay(2000);
+
+    UNITY_BEGIN(); // IMPORTANT LINE!
+    RUN_TEST(test_decode);
+    RUN_TEST(test_no_fix);
+    RUN_TEST(test_too_short);
+    RUN_TEST(test_benchmark);
+}
+
+void loop()
+{
+    UNITY_END(); // stop unit testing
+}